@@ -0,0 +1,99 @@
+//======================================================================
+//
+// Translation context keeps all of the mutable state that libasmir
+// needs to translate binary code into VEX IR and BAP IR. Each thread
+// must select its own context with asmir_ctx_set() before calling
+// translation functions, so, different threads can translate code in
+// parallel using different contexts.
+//
+// Single context must not be used by several threads at the same time.
+//
+//======================================================================
+
+#ifndef __CONTEXT_H
+#define __CONTEXT_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "libvex.h"
+#include "vexmem.h"
+
+#define ASMIR_TMPBUF_SIZE 2000
+
+// VEX optimization level for each instruction
+#define ASMIR_IROPT_LEVEL 2
+
+// VEX limit for guest_max_insns
+#define ASMIR_BLOCK_MAX_INSNS 100
+
+// called by instrument1() while VEX IR is still valid
+typedef void (* asmir_irsb_cb_t)(IRSB *irbb, void *param);
+
+typedef struct _asmir_ctx_t
+{
+    // some info required for translation (vexir.c)
+    VexArchInfo vai;
+    VexGuestExtents vge;
+    VexTranslateArgs vta;
+
+    // temp buffer to hold the translated bytes, not needed with patched VEX
+    UChar tmpbuf[ASMIR_TMPBUF_SIZE];
+    Int tmpbuf_used;
+
+    // intermediate results of translation saved from within instrument1()
+    IRSB *irbb_current;
+    int size_current;
+
+    // optional callback for VEX IR and it's arguments (see translate_insn_cb)
+    asmir_irsb_cb_t irsb_cb;
+    void *irsb_cb_param;
+    int irsb_keep;
+
+    // superblock translation mode state (see translate_block_cb)
+    int block_max;
+    int block_insns;
+
+    // memory for IRSB copies (vexmem.c)
+    vx_arena_t arena;
+
+    // disassembler handle and the last decoded instruction (disasm-*.cpp)
+    void *disasm;
+
+    // guest architecture we are translating from (set in generate_bap_ir)
+    VexArch guest_arch;
+
+    // special Exp to record the AST for shl, shr
+    struct Exp *count_opnd;
+
+    // counters for unique temp and label names
+    int temp_counter;
+    int label_counter;
+
+    // next IR address for the generate_bap_ir_block()
+    unsigned int ir_addr;
+
+} asmir_ctx_t;
+
+// vexir.c
+asmir_ctx_t *asmir_ctx_new(void);
+void asmir_ctx_free(asmir_ctx_t *ctx);
+
+//
+// Select context for the current thread, NULL means default one.
+// Default context is shared between all of the threads that didn't
+// select their own context, it exists for backward compatibility only.
+//
+void asmir_ctx_set(asmir_ctx_t *ctx);
+asmir_ctx_t *asmir_ctx_get(void);
+
+// disasm-*.cpp
+void disasm_ctx_free(asmir_ctx_t *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
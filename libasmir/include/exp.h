@@ -78,6 +78,8 @@ typedef struct Exp Exp;
 #include <sstream>
 #include <vector>
 
+#include "symbol.h"
+
 using namespace std;
 
 /// Exp are pure expressions, i.e., side-effect free.
@@ -246,6 +248,7 @@ class Temp : public Exp
 public:
 
     Temp(reg_t typ, string n);
+    Temp(reg_t typ, sym_t s);
     Temp(const Temp &other);
     virtual Temp *clone() const;
     virtual ~Temp() {};
@@ -257,8 +260,13 @@ public:
         v->visitTemp(this);
     }
 
+    string name() const
+    {
+        return sym_to_string(sym);
+    }
+
     reg_t typ;
-    string name;
+    sym_t sym;
 };
 
 class Unknown : public Exp
@@ -312,6 +320,7 @@ class Name : public Exp
 public:
     
     Name(string n);
+    Name(sym_t s);
     Name(const Name &copy);
     virtual ~Name() {};
     virtual Name *clone() const;
@@ -322,8 +331,13 @@ public:
     {
         v->visitName(this);
     }
+
+    string name() const
+    {
+        return sym_to_string(sym);
+    }
     
-    string name;
+    sym_t sym;
 };
 
 class Let : public Exp
@@ -355,6 +369,7 @@ Exp *ecl(Exp *exp);
 Constant *ex_const(uint32_t value);
 Constant *ex_const(reg_t t, const_val_t value);
 Name *ex_name(string name);
+Name *ex_name(sym_t sym);
 UnOp *_ex_not(Exp *arg);
 UnOp *ex_not(Exp *arg);
 BinOp *_ex_add(Exp *arg1, Exp *arg2);
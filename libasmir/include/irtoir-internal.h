@@ -32,6 +32,7 @@
 // functions internal to irtoir.cpp and irtoir-*.cpp
 void panic(string msg);
 
+Temp *mk_reg(const char *name, reg_t width);
 Temp *mk_reg(string name, reg_t width);
 reg_t IRType_to_reg_type(IRType type);
 reg_t regt_of_irexpr(IRSB *irbb, IRExpr *e);
@@ -43,7 +44,7 @@ inline int get_type_size(reg_t typ)
     return Exp::reg_to_bits(typ);
 }
 
-Temp *mk_temp(string name, IRType ty);
+Temp *mk_temp(IRTemp tmp, IRType ty);
 Temp *mk_temp(reg_t type, vector<Stmt *> *stmts);
 Temp *mk_temp(IRType ty, vector<Stmt *> *stmts);
 
@@ -53,7 +54,6 @@ int match_mux0x(vector<Stmt *> *ir, unsigned int i, Exp **cond, Exp **exp0,	Exp
 
 extern bool use_eflags_thunks;
 extern bool use_simple_segments;
-extern Exp *count_opnd;
 
 //
 // arch specific functions used in irtoir.cpp
@@ -13,6 +13,7 @@ typedef struct bap_block_s bap_block_t;
 // VEX headers (inside Valgrind/VEX/pub)
 //
 #include "vexmem.h"
+#include "context.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -73,6 +74,24 @@ void translate_init();
 // vexir.c
 IRSB *translate_insn(VexArch guest, unsigned char *insn_start, unsigned int insn_addr, int *insn_size);
 
+//
+// Same as translate_insn, but also passes VEX IR to the callback that is
+// called while VEX memory is still valid. VEX IR is copied and returned only
+// when keep is set. Note, that callback is called while VEX is locked, so,
+// it also blocks other threads translation.
+// vexir.c
+IRSB *translate_insn_cb(VexArch guest, unsigned char *insn_start, unsigned int insn_addr, int *insn_size, 
+                        asmir_irsb_cb_t cb, void *param, int keep);
+
+//
+// Translates up to max_insns instructions with one VEX call, VEX IR of the
+// superblock is split back into IRSB for each instruction that are passed
+// to the callback. Each IRSB is the same as translate_insn returns for this 
+// instruction. Note, that VEX may read all of the max_insns instructions.
+// vexir.c
+int translate_block_cb(VexArch guest, unsigned char *insn_start, unsigned int insn_addr, int max_insns, 
+                       asmir_irsb_cb_t cb, void *param);
+
 //
 // Translate an IRSB into a vector of Stmts in our IR
 vector<Stmt *> *translate_irbb(IRSB *irbb);
@@ -99,6 +118,20 @@ vector<bap_block_t *> generate_vex_ir(VexArch guest, uint8_t *data, address_t st
 // to Vine IR.
 void generate_bap_ir_block(VexArch guest, bap_block_t *block);
 
+// Take an instrs and translate it into VEX IR and then into Vine IR in a
+// single pass without copying of VEX IR, block->vex_ir is filled only when
+// keep_vex_ir is set.
+bap_block_t *generate_bap_ir_direct(VexArch guest, uint8_t *data, address_t inst, bool keep_vex_ir);
+
+// Take up to max_insns instrs starting from the start and translate them 
+// into VEX IR and Vine IR using superblock translation mode, translation
+// stops at the end of the basic block. When direct is set Vine IR is 
+// generated without copying of VEX IR and block->vex_ir is not filled.
+vector<bap_block_t *> generate_bap_ir_insns(VexArch guest, uint8_t *data, address_t start, int max_insns, bool direct);
+
+// Free bap blocks with their Vine IR, VEX IR is freed with the rest of VEX memory.
+void free_bap_blocks(vector<bap_block_t *> &blocks);
+
 //
 // Take a vector of bap blocks that have gone through VEX translation
 // and translate them to Vine IR
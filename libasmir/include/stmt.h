@@ -110,6 +110,7 @@ class VarDecl : public Stmt
 public:
 
     VarDecl(string name, reg_t typ, address_t asm_ad = 0x0, address_t ir_ad = 0x0);
+    VarDecl(sym_t sym, reg_t typ, address_t asm_ad = 0x0, address_t ir_ad = 0x0);
     VarDecl(Temp *t);
     VarDecl(const VarDecl &other);
     virtual ~VarDecl() {};    
@@ -121,7 +122,12 @@ public:
         v->visitVarDecl(this);
     };
 
-    string name;
+    string name() const
+    {
+        return sym_to_string(sym);
+    }
+
+    sym_t sym;
     reg_t typ;
 };
 
@@ -149,6 +155,7 @@ class Label : public Stmt
 public:
 
     Label(string l, address_t asm_ad = 0x0, address_t ir_ad = 0x0);
+    Label(sym_t s, address_t asm_ad = 0x0, address_t ir_ad = 0x0);
     Label(const Label &other);
     virtual ~Label() {};    
     virtual string tostring();
@@ -159,7 +166,12 @@ public:
         v->visitLabel(this);
     };
 
-    string label;
+    string label() const
+    {
+        return sym_to_string(sym);
+    }
+
+    sym_t sym;
 };
 
 class Jmp : public Stmt
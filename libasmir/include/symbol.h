@@ -0,0 +1,99 @@
+//======================================================================
+//
+// Symbols are integer IDs of registers, temps and labels that are used
+// in BAP IR instead of strings. Kind of the symbol is kept in the high
+// byte, for the most of the names their numeric part is encoded right
+// in the symbol value. Register names and all of the other strings are
+// interned in the global table which is shared between all threads, names
+// of the known guest registers are interned once at init and looked up
+// without locking.
+//
+// Symbol names are materialized only when somebody asks for them.
+//
+//======================================================================
+
+#ifndef _SYMBOL_H
+#define _SYMBOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+using namespace std;
+
+typedef uint64_t sym_t;
+
+enum sym_kind_t
+{
+    SYM_NONE = 0,
+    SYM_STR,        // interned string
+    SYM_REG,        // "R_<name>" architecture register, <name> is interned
+    SYM_TEMP,       // "T_<n>" temp from mk_temp()
+    SYM_VEX_TEMP,   // "T_<size>t<n>" VEX IR temp
+    SYM_REIL_TEMP,  // "V_<nn>" REIL temp
+    SYM_REIL_TMP,   // "V_REIL_TMP_<n>" internal REIL translator temp
+    SYM_PC,         // "pc_0x<addr>" machine instruction address
+    SYM_LABEL       // "L_<n>" label from mk_label()
+};
+
+#define SYM_KIND_SHIFT 56
+#define SYM_VAL_MASK ((1ULL << SYM_KIND_SHIFT) - 1)
+
+#define SYM_MAKE(_kind_, _val_) (((sym_t)(_kind_) << SYM_KIND_SHIFT) | ((sym_t)(_val_) & SYM_VAL_MASK))
+
+#define SYM_KIND(_sym_) ((sym_kind_t)((_sym_) >> SYM_KIND_SHIFT))
+#define SYM_VAL(_sym_) ((_sym_) & SYM_VAL_MASK)
+
+#define SYM_NULL SYM_MAKE(SYM_NONE, 0)
+
+// max. number of interned strings
+#define SYM_TABLE_MAX 0x10000
+
+inline sym_t sym_temp(int num)
+{
+    return SYM_MAKE(SYM_TEMP, (uint32_t)num);
+}
+
+inline sym_t sym_vex_temp(int size, int num)
+{
+    return SYM_MAKE(SYM_VEX_TEMP, ((uint64_t)size << 32) | (uint32_t)num);
+}
+
+inline sym_t sym_reil_temp(int num)
+{
+    return SYM_MAKE(SYM_REIL_TEMP, (uint32_t)num);
+}
+
+inline sym_t sym_reil_tmp(int num)
+{
+    return SYM_MAKE(SYM_REIL_TMP, (uint32_t)num);
+}
+
+inline sym_t sym_pc(uint64_t addr)
+{
+    // labels of machine instructions were always 32-bit
+    return SYM_MAKE(SYM_PC, (uint32_t)addr);
+}
+
+inline sym_t sym_label(int num)
+{
+    return SYM_MAKE(SYM_LABEL, (uint32_t)num);
+}
+
+// register by it's name without "R_" prefix
+sym_t sym_reg(const char *name);
+
+// parse any symbol name, unknown names are interned as SYM_STR
+sym_t sym_from_string(const char *name);
+
+inline sym_t sym_from_string(const string &name)
+{
+    return sym_from_string(name.c_str());
+}
+
+// write symbol name into the buffer, returns snprintf() compatible value
+int sym_snprint(char *buff, size_t size, sym_t sym);
+
+string sym_to_string(sym_t sym);
+
+#endif
@@ -19,8 +19,42 @@ extern "C"
 {
 #endif
 
+#include <stddef.h>
+
 #include "libvex.h"
 
+typedef struct _vx_chunk_t
+{
+    struct _vx_chunk_t *next;
+    size_t size;
+
+    // chunk data follows the header
+
+} vx_chunk_t;
+
+//
+// Arena for IRSB copies, each translation context has its own one.
+//
+typedef struct _vx_arena_t
+{
+    vx_chunk_t *chunks;         // list of allocated chunks
+    vx_chunk_t *current;        // chunk that is used for allocations
+    unsigned char *next_free;
+    unsigned char *end;
+
+    size_t size;                // total size of allocated chunks
+    size_t release_size;        // high-water mark to free chunks in vx_FreeAll(), 0 means never
+
+    size_t used;                // bytes allocated since the last vx_FreeAll()
+    size_t peak_last;           // .. and the same value of the last translation
+    size_t peak;                // max. value of used
+
+} vx_arena_t;
+
+void vx_arena_init(vx_arena_t *arena);
+void vx_arena_free(vx_arena_t *arena);
+
+// allocate memory from the arena of current context
 void *vx_Alloc(Int nbytes);
 void vx_FreeAll();
 IRSB* vx_dopyIRSB(IRSB* bb);
@@ -1,3 +1,6 @@
+#include <stdio.h>
+#include <string.h>
+
 #include <string>
 #include <vector>
 
@@ -315,30 +318,106 @@ void disasm_open(VexArch guest, csh *handle)
     }    
 }
 
-int disasm_insn(VexArch guest, uint8_t *data, string &mnemonic, string &op)
+//----------------------------------------------------------------------
+// Each translation context keeps its own detail-enabled capstone handle
+// and the last decoded instruction, so, generate_vex_ir() and the
+// unknown instructions handler don't need to decode it again.
+//----------------------------------------------------------------------
+typedef struct _disasm_ctx
 {
-    int ret = -1;
-    
+    VexArch guest;
     csh handle;
     cs_insn *insn;
 
-    disasm_open(guest, &handle);
+} disasm_ctx;
+
+extern "C" void disasm_ctx_free(asmir_ctx_t *ctx)
+{
+    disasm_ctx *disasm = (disasm_ctx *)ctx->disasm;
+
+    if (disasm)
+    {
+        if (disasm->insn)
+        {
+            cs_free(disasm->insn, 1);
+        }
+
+        cs_close(&disasm->handle);
+
+        delete disasm;
+        ctx->disasm = NULL;
+    }
+}
+
+disasm_ctx *disasm_ctx_get(VexArch guest)
+{
+    asmir_ctx_t *ctx = asmir_ctx_get();
+    disasm_ctx *disasm = (disasm_ctx *)ctx->disasm;
+
+    if (disasm && disasm->guest != guest)
+    {
+        disasm_ctx_free(ctx);
+        disasm = NULL;
+    }
 
-    size_t count = cs_disasm_ex(handle, data, DISASM_MAX_INST_LEN, 0, 1, &insn);    
-    if (count > 0) 
+    if (disasm == NULL)
     {
-        ret = (int)insn[0].size;
-        mnemonic = string(insn[0].mnemonic);
-        op = string(insn[0].op_str);
-        cs_free(insn, count);
-    } 
-    else
+        csh handle;
+
+        disasm_open(guest, &handle);
+        cs_option(handle, CS_OPT_DETAIL, CS_OPT_ON);
+
+        disasm = new disasm_ctx;
+        disasm->guest = guest;
+        disasm->handle = handle;
+        disasm->insn = NULL;
+
+        ctx->disasm = disasm;
+    }
+
+    return disasm;
+}
+
+cs_insn *disasm_decode(VexArch guest, uint8_t *data)
+{
+    disasm_ctx *disasm = disasm_ctx_get(guest);
+    cs_insn *insn = disasm->insn;
+
+    // instruction decoding depends only on its own bytes
+    if (insn && memcmp(insn->bytes, data, insn->size) == 0)
+    {
+        return insn;
+    }
+
+    if (insn)
+    {
+        cs_free(insn, 1);
+        disasm->insn = NULL;
+    }
+
+    size_t count = cs_disasm_ex(disasm->handle, data, DISASM_MAX_INST_LEN, 0, 1, &insn);    
+    if (count == 0)
     {
         fprintf(stderr, "ERROR: Failed to disassemble\n");
+        return NULL;
     }
 
-    cs_close(&handle);
-    return ret;
+    disasm->insn = insn;
+    return insn;
+}
+
+int disasm_insn(VexArch guest, uint8_t *data, string &mnemonic, string &op)
+{
+    cs_insn *insn = disasm_decode(guest, data);
+    if (insn == NULL)
+    {
+        return -1;
+    }
+
+    mnemonic = string(insn->mnemonic);
+    op = string(insn->op_str);
+
+    return (int)insn->size;
 }
 
 #define I386_MODRM_RM(_modrm_) ((_modrm_) & 7)
@@ -559,56 +638,45 @@ int disasm_arg(VexArch guest, uint8_t *data, vector<Temp *> &args, dsiasm_arg_t
 {
     int ret = -1;
     
-    csh handle;
-    cs_insn *insn;
+    cs_insn *insn = disasm_decode(guest, data);
+    if (insn == NULL)
+    {
+        return ret;
+    }
 
-    disasm_open(guest, &handle);
-    cs_option(handle, CS_OPT_DETAIL, CS_OPT_ON);
+    cs_detail *detail = insn->detail;
+    uint8_t *regs = NULL;
 
-    size_t count = cs_disasm_ex(handle, data, DISASM_MAX_INST_LEN, 0, 1, &insn);    
-    if (count > 0) 
+    // get arguments that capstone fails to recognise properly
+    ret = disasm_arg_special(guest, insn, args, type);
+    if (ret >= 0)
     {
-        cs_detail *detail = insn[0].detail;
-        uint8_t *data = NULL;
-
-        // get arguments that capstone fails to recognise properly
-        ret = disasm_arg_special(guest, &insn[0], args, type);
-        if (ret >= 0)
-        {
-            return ret;
-        }
+        return ret;
+    }
 
-        if (detail && type == disasm_arg_t_src)
-        {
-            ret = detail->regs_read_count;
-            data = detail->regs_read;
-        }
-        else if (detail && type == disasm_arg_t_dst)
-        {
-            ret = detail->regs_write_count;
-            data = detail->regs_write;
-        }
+    if (detail && type == disasm_arg_t_src)
+    {
+        ret = detail->regs_read_count;
+        regs = detail->regs_read;
+    }
+    else if (detail && type == disasm_arg_t_dst)
+    {
+        ret = detail->regs_write_count;
+        regs = detail->regs_write;
+    }
 
-        if (ret > 0) 
+    if (ret > 0) 
+    {
+        for (int i = 0; i < ret; i++) 
         {
-            for (int i = 0; i < ret; i++) 
+            Temp *temp = disasm_arg_to_temp(guest, regs[i]);
+            if (temp)
             {
-                Temp *temp = disasm_arg_to_temp(guest, data[i]);
-                if (temp)
-                {
-                    args.push_back(temp);
-                }                
-            }
-        }    
-
-        cs_free(insn, count);
-    } 
-    else
-    {
-        fprintf(stderr, "ERROR: Failed to disassemble\n");
-    }
+                args.push_back(temp);
+            }                
+        }
+    }    
 
-    cs_close(&handle);
     return ret;
 }
 
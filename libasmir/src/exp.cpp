@@ -559,12 +559,17 @@ void Phi::destroy(Phi *expr)
     delete expr;
 }
 
-Temp::Temp(reg_t t, string n) : Exp(TEMP), typ(t), name(n)
+Temp::Temp(reg_t t, string n) : Exp(TEMP), typ(t), sym(sym_from_string(n))
 { 
 
 }
 
-Temp::Temp(const Temp &other) : Exp(TEMP), typ(other.typ), name(other.name)
+Temp::Temp(reg_t t, sym_t s) : Exp(TEMP), typ(t), sym(s)
+{ 
+
+}
+
+Temp::Temp(const Temp &other) : Exp(TEMP), typ(other.typ), sym(other.sym)
 {
 
 }
@@ -578,7 +583,7 @@ string Temp::tostring() const
 {
     // Argh! Stop removing useful error checking and debugging information.
     // It doesn't hurt anyone.
-    return name + ":" + Exp::string_type(typ);
+    return name() + ":" + Exp::string_type(typ);
 }
 
 void Temp::destroy(Temp *expr)
@@ -610,12 +615,17 @@ void Unknown::destroy(Unknown *expr)
     delete expr;
 }
 
-Name::Name(string s) : Exp(NAME), name(s)
+Name::Name(string s) : Exp(NAME), sym(sym_from_string(s))
 {
     
 }
 
-Name::Name(const Name &other) : Exp(NAME), name(other.name)
+Name::Name(sym_t s) : Exp(NAME), sym(s)
+{
+    
+}
+
+Name::Name(const Name &other) : Exp(NAME), sym(other.sym)
 {
     
 }
@@ -627,7 +637,7 @@ Name *Name::clone() const
 
 string Name::tostring() const
 {
-    return "name(" + name + ")";
+    return "name(" + name() + ")";
 }
 
 void Name::destroy(Name *expr)
@@ -843,6 +853,11 @@ Name *ex_name(string name)
     return new Name(name);
 }
 
+Name *ex_name(sym_t sym)
+{
+    return new Name(sym);
+}
+
 UnOp *_ex_not(Exp *arg)
 {
     return new UnOp(NOT, arg);
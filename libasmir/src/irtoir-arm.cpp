@@ -68,7 +68,7 @@ vector<VarDecl *> arm_get_reg_decls()
 // Translate VEX IR offset into ARM register name
 // This is only called for 32-bit registers.
 //----------------------------------------------------------------------
-static string reg_offset_to_name(int offset)
+static const char *reg_offset_to_name(int offset)
 {
     assert(offset >= 0);
 
@@ -2,6 +2,7 @@
 #include <vector>
 #include <iostream>
 #include <assert.h>
+#include <stdio.h>
 #include <stddef.h>
 
 #include "irtoir-internal.h"
@@ -320,11 +321,11 @@ vector<VarDecl *> i386_get_reg_decls()
 // Translate VEX IR offset into x86 register name
 // This is only called for 32-bit registers.
 //----------------------------------------------------------------------
-static string reg_offset_to_name(int offset)
+static const char *reg_offset_to_name(int offset)
 {
     assert(offset >= 0);
 
-    static string name = "";
+    const char *name = "";
 
     switch (offset)
     {
@@ -529,7 +530,7 @@ static string reg_offset_to_name(int offset)
 static Exp *translate_get_reg_8(int offset)
 {
     bool low;
-    string name;
+    const char *name = "";
 
     // Determine which 32 bit register this 8 bit sub
     // register is a part of
@@ -604,7 +605,7 @@ static Exp *translate_get_reg_8(int offset)
 
 static Exp *translate_get_segreg_base(int offset)
 {
-    string name = "";
+    const char *name = "";
     bool usebase = false;
     Exp *value = NULL;
 
@@ -652,7 +653,7 @@ static Exp *translate_get_segreg_base(int offset)
 
 static Exp *translate_get_reg_16(int offset)
 {
-    string name;
+    const char *name = "";
     bool sub;
 
     switch (offset)
@@ -1130,10 +1131,10 @@ Exp *i386_translate_ccall(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
             Label *b2 = mk_label();
             Label *b3 = mk_label();
             Temp *desc = mk_temp(REG_32, irout);
-            irout->push_back(new CJmp(cond, ex_name(b1->label), ex_name(b2->label)));
+            irout->push_back(new CJmp(cond, ex_name(b1->sym), ex_name(b2->sym)));
             irout->push_back(b1);
             irout->push_back(new Move(new Temp(*desc), gdt_ptr));
-            irout->push_back(new Jmp(new Name(b3->label)));
+            irout->push_back(new Jmp(new Name(b3->sym)));
             irout->push_back(b2);
             irout->push_back(new Move(new Temp(*desc), ldt_ptr));
             irout->push_back(b3);
@@ -1187,8 +1188,8 @@ Exp *i386_translate_ccall(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
         Label *zero = mk_label();
         Label *out = mk_label();
         irout->push_back(new CJmp(_ex_eq(rot_amt->clone(), ex_const(REG_32, 0)),
-                                  ex_name(zero->label),
-                                  ex_name(non_zero->label)));
+                                  ex_name(zero->sym),
+                                  ex_name(non_zero->sym)));
 
         // normal handling
         {
@@ -1236,7 +1237,7 @@ Exp *i386_translate_ccall(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
             of = NULL;
             new_cf = NULL;
 
-            irout->push_back(new Jmp(ex_name(out->label)));
+            irout->push_back(new Jmp(ex_name(out->sym)));
         }
 
         // rot by zero
@@ -1278,7 +1279,7 @@ static Stmt *translate_put_reg_8(int offset, Exp *data, IRSB *irbb)
     assert(data);
 
     bool low;
-    string name;
+    const char *name = "";
     Temp *reg;
 
     // Determine which 32 bit register this 8 bit sub
@@ -1372,7 +1373,7 @@ static Stmt *translate_put_reg_16(int offset, Exp *data, IRSB *irbb)
 {
     assert(data);
 
-    string name;
+    const char *name = "";
     bool sub;
     Temp *reg;
 
@@ -1558,6 +1559,35 @@ Stmt *i386_translate_put(IRStmt *stmt, IRSB *irbb, vector<Stmt *> *irout)
 //
 //----------------------------------------------------------------------
 
+#define THUNK_CC_OP     0
+#define THUNK_CC_DEP1   1
+#define THUNK_CC_DEP2   2
+#define THUNK_CC_NDEP   3
+
+//
+// Returns THUNK_CC_* index of EFLAGS thunk register or -1.
+//
+static int thunk_reg_index(Temp *temp)
+{
+    static const sym_t thunk_regs[] = 
+    {
+        sym_reg("CC_OP"), sym_reg("CC_DEP1"), sym_reg("CC_DEP2"), sym_reg("CC_NDEP")
+    };
+
+    if (SYM_KIND(temp->sym) == SYM_REG)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            if (temp->sym == thunk_regs[i])
+            {
+                return i;
+            }
+        }
+    }
+
+    return -1;
+}
+
 void del_get_thunk(bap_block_t *block)
 {
     assert(block);
@@ -1586,10 +1616,7 @@ void del_get_thunk(bap_block_t *block)
             {
                 Temp *temp = (Temp *)(move->rhs);
 
-                if (temp->name.find("CC_OP") != string::npos || 
-                    temp->name.find("CC_DEP1") != string::npos || 
-                    temp->name.find("CC_DEP2") != string::npos || 
-                    temp->name.find("CC_NDEP") != string::npos)
+                if (thunk_reg_index(temp) != -1)
                 {
                     // remove and Free the Stmt
                     Stmt::destroy(rv.back());
@@ -1621,8 +1648,9 @@ void get_thunk_index(vector<Stmt *> *ir, int *op, int *dep1, int *dep2, int *nde
         }
 
         Temp *temp = (Temp *)((Move *)stmt)->lhs;
+        int thunk = thunk_reg_index(temp);
 
-        if (temp->name.find("CC_OP") != string::npos)
+        if (thunk == THUNK_CC_OP)
         {
             *op = i;
 
@@ -1631,15 +1659,15 @@ void get_thunk_index(vector<Stmt *> *ir, int *op, int *dep1, int *dep2, int *nde
                 *mux0x = (i - MUX_SUB);
             }
         }
-        else if (temp->name.find("CC_DEP1") != string::npos)
+        else if (thunk == THUNK_CC_DEP1)
         {
             *dep1 = i;
         }
-        else if (temp->name.find("CC_DEP2") != string::npos)
+        else if (thunk == THUNK_CC_DEP2)
         {
             *dep2 = i;
         }
-        else if (temp->name.find("CC_NDEP") != string::npos)
+        else if (thunk == THUNK_CC_NDEP)
         {
             *ndep = i;
         }
@@ -2273,11 +2301,13 @@ vector<Stmt *> mod_eflags_shl(reg_t type, Exp *arg1, Exp *arg2)
 
     if (!use_eflags_thunks)
     {
+        Exp *count_opnd = asmir_ctx_get()->count_opnd;
+
         if (count_opnd)
         {
             Constant c0(REG_8, 0);
             Exp *cond = ex_eq(count_opnd, &c0);
-            irout.push_back(new CJmp(cond, ex_name(ifcountn0->label), ex_name(ifcount0->label)));
+            irout.push_back(new CJmp(cond, ex_name(ifcountn0->sym), ex_name(ifcount0->sym)));
             irout.push_back(ifcount0);
         }
         else
@@ -2342,11 +2372,13 @@ vector<Stmt *> mod_eflags_shr(reg_t type, Exp *arg1, Exp *arg2)
 
     if (!use_eflags_thunks)
     {
+        Exp *count_opnd = asmir_ctx_get()->count_opnd;
+
         if (count_opnd)
         {
             Constant c0(REG_8, 0);
             Exp *cond = ex_eq(count_opnd, &c0);
-            irout.push_back(new CJmp(cond, ex_name(ifcount0->label), ex_name(ifcountn0->label)));
+            irout.push_back(new CJmp(cond, ex_name(ifcount0->sym), ex_name(ifcountn0->sym)));
             irout.push_back(ifcountn0);
         }
         else
@@ -2355,7 +2387,7 @@ vector<Stmt *> mod_eflags_shr(reg_t type, Exp *arg1, Exp *arg2)
                VEX never performs a binop, and thus never sets
                count_opnd.  I am assuming that if this happens the count
                is 0. */
-            irout.push_back(new Jmp(ex_name(ifcount0->label)));
+            irout.push_back(new Jmp(ex_name(ifcount0->sym)));
         }
     }
 
@@ -2637,10 +2669,7 @@ int del_put_thunk(vector<Stmt *> *ir, string mnemonic, int opi, int dep1, int de
                 {
                     Temp *temp = (Temp *)(move->lhs);
 
-                    if (temp->name.find("CC_OP") != string::npos || 
-                        temp->name.find("CC_DEP1") != string::npos || 
-                        temp->name.find("CC_DEP2") != string::npos || 
-                        temp->name.find("CC_NDEP") != string::npos)
+                    if (thunk_reg_index(temp) != -1)
                     {
                         //// XXX: don't delete for now.
                         //// remove and Free the Stmt
@@ -3021,10 +3050,11 @@ void i386_modify_flags(bap_block_t *block)
         }
         else 
         {
-            cerr << "Warning! Flags not handled for " << op 
-                 << hex 
-                 << " at " << block->inst
-                 << endl;
+            // don't touch cerr format flags, they are shared between threads
+            fprintf(
+                stderr, "Warning! Flags not handled for %s at %llx\n", 
+                op.c_str(), (unsigned long long)block->inst
+            );
         }
     }
 }
@@ -22,12 +22,6 @@ bool use_eflags_thunks = 0;
 bool use_simple_segments = 1;
 bool translate_calls_and_returns = 0;
 
-// Guest architecture we are translating from.
-// Set in generate_bap_ir, accessed all over...
-// It might be cleaner to pass this around, but that would require a lot of
-// refactoring.
-VexArch guest_arch = VexArch_INVALID;
-
 using namespace std;
 
 #include "disasm.h"
@@ -38,11 +32,6 @@ using namespace std;
 string uTag = "Unknown: ";
 string sTag = "Skipped: ";
 
-//
-// Special Exp to record the AST for shl, shr
-//
-Exp *count_opnd = NULL;
-
 //======================================================================
 // Forward declarations
 //======================================================================
@@ -134,7 +123,7 @@ vector<VarDecl *> get_reg_decls(VexArch arch)
 
 vector<VarDecl *> get_reg_decls(void)
 {
-    return get_reg_decls(guest_arch);
+    return get_reg_decls(asmir_ctx_get()->guest_arch);
 }
 
 Exp *translate_get(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
@@ -143,7 +132,7 @@ Exp *translate_get(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
     assert(irbb);
     assert(irout);
 
-    switch (guest_arch)
+    switch (asmir_ctx_get()->guest_arch)
     {
     case VexArchX86:
     
@@ -161,7 +150,7 @@ Exp *translate_get(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
 
 Stmt *translate_put(IRStmt *stmt, IRSB *irbb, vector<Stmt *> *irout)
 {
-    switch (guest_arch)
+    switch (asmir_ctx_get()->guest_arch)
     {
     case VexArchX86:
     
@@ -182,7 +171,7 @@ Exp *translate_ccall(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
     assert(irbb);
     assert(irout);
 
-    switch (guest_arch)
+    switch (asmir_ctx_get()->guest_arch)
     {
     case VexArchX86:
     
@@ -202,7 +191,7 @@ void modify_flags(bap_block_t *block)
 {
     assert(block);
 
-    switch (guest_arch)
+    switch (asmir_ctx_get()->guest_arch)
     {
     case VexArchX86:
     
@@ -220,9 +209,14 @@ void modify_flags(bap_block_t *block)
     }
 }
 
+Temp *mk_reg(const char *name, reg_t width)
+{
+    return new Temp(width, sym_reg(name));
+}
+
 Temp *mk_reg(string name, reg_t width)
 {
-    return new Temp(width, "R_" + name);
+    return mk_reg(name.c_str(), width);
 }
 
 // Note:
@@ -294,17 +288,17 @@ reg_t regt_of_irexpr(IRSB *irbb, IRExpr *e)
     return IRType_to_reg_type(typeOfIRExpr(irbb->tyenv, e));
 }
 
-Temp *mk_temp(string name, IRType ty)
+Temp *mk_temp(IRTemp tmp, IRType ty)
 {
     reg_t typ = IRType_to_reg_type(ty);
-    Temp *ret = new Temp(typ, "T_" + name);
+    Temp *ret = new Temp(typ, sym_vex_temp(get_type_size(typ), tmp));
     return ret;
 }
 
 Temp *mk_temp(reg_t type, vector<Stmt *> *stmts)
 {
-    static int temp_counter = 0;
-    Temp *ret =  new Temp(type, "T_" + int_to_str(temp_counter++));
+    asmir_ctx_t *ctx = asmir_ctx_get();
+    Temp *ret =  new Temp(type, sym_temp(ctx->temp_counter++));
     stmts->push_back(new VarDecl(ret));
     return ret;
 }
@@ -318,21 +312,21 @@ Temp *mk_temp(IRType ty, vector<Stmt *> *stmts)
 //----------------------------------------------------------------------
 // Takes a destination address and makes a Label out of it.
 // Note that this function and mk_dest_name must produce the same
-// string for the same given address!
+// symbol for the same given address!
 //----------------------------------------------------------------------
 Label *mk_dest_label(Addr64 dest)
 {
-    return new Label("pc_0x" + int_to_hex(dest));
+    return new Label(sym_pc(dest));
 }
 
 //----------------------------------------------------------------------
 // Takes a destination address and makes a Name out of it.
 // Note that this function and mk_dest_label must produce the same
-// string for the same given address!
+// symbol for the same given address!
 //----------------------------------------------------------------------
 Name *mk_dest_name(Addr64 dest)
 {
-    return new Name("pc_0x" + int_to_hex(dest));
+    return new Name(sym_pc(dest));
 }
 
 //======================================================================
@@ -446,11 +440,11 @@ Exp *translate_Clz32(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
     irout->push_back(new Move(new Temp(*counter), ex_const(32)));
     irout->push_back(new Move(new Temp(*temp), arg));
     irout->push_back(loop);
-    irout->push_back(new CJmp(cond, new Name(label0->label), new Name(label1->label)));
+    irout->push_back(new CJmp(cond, new Name(label0->sym), new Name(label1->sym)));
     irout->push_back(label0);
     irout->push_back(new Move(new Temp(*temp), new BinOp(RSHIFT, new Temp(*temp), ex_const(1))));
     irout->push_back(new Move(new Temp(*counter), new BinOp(MINUS, new Temp(*counter), ex_const(1))));
-    irout->push_back(new Jmp(new Name(loop->label)));
+    irout->push_back(new Jmp(new Name(loop->sym)));
     irout->push_back(label1);
 
     return counter;
@@ -476,11 +470,11 @@ Exp *translate_Ctz32(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
     irout->push_back(new Move(new Temp(*counter), ex_const(32)));
     irout->push_back(new Move(new Temp(*temp), arg));
     irout->push_back(loop);
-    irout->push_back(new CJmp(cond, new Name(label0->label), new Name(label1->label)));
+    irout->push_back(new CJmp(cond, new Name(label0->sym), new Name(label1->sym)));
     irout->push_back(label0);
     irout->push_back(new Move(new Temp(*temp), new BinOp(LSHIFT, new Temp(*temp), ex_const(1))));
     irout->push_back(new Move(new Temp(*counter), new BinOp(MINUS, new Temp(*counter), ex_const(1))));
-    irout->push_back(new Jmp(new Name(loop->label)));
+    irout->push_back(new Jmp(new Name(loop->sym)));
     irout->push_back(label1);
 
     return counter;
@@ -509,20 +503,20 @@ Exp *translate_CmpF64(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
 
     Temp *temp = mk_temp(Ity_I32, irout);
 
-    irout->push_back(new CJmp(condEQ, new Name(labelEQ->label), new Name(labelNext0->label)));
+    irout->push_back(new CJmp(condEQ, new Name(labelEQ->sym), new Name(labelNext0->sym)));
     irout->push_back(labelNext0);
-    irout->push_back(new CJmp(condGT, new Name(labelGT->label), new Name(labelNext1->label)));
+    irout->push_back(new CJmp(condGT, new Name(labelGT->sym), new Name(labelNext1->sym)));
     irout->push_back(labelNext1);
-    irout->push_back(new CJmp(condLT, new Name(labelLT->label), new Name(labelUN->label)));
+    irout->push_back(new CJmp(condLT, new Name(labelLT->sym), new Name(labelUN->sym)));
     irout->push_back(labelUN);
     irout->push_back(new Move(new Temp(*temp), ex_const(0x45)));
-    irout->push_back(new Jmp(new Name(done->label)));
+    irout->push_back(new Jmp(new Name(done->sym)));
     irout->push_back(labelEQ);
     irout->push_back(new Move(new Temp(*temp), ex_const(0x40)));
-    irout->push_back(new Jmp(new Name(done->label)));
+    irout->push_back(new Jmp(new Name(done->sym)));
     irout->push_back(labelGT);
     irout->push_back(new Move(new Temp(*temp), ex_const(0x00)));
-    irout->push_back(new Jmp(new Name(done->label)));
+    irout->push_back(new Jmp(new Name(done->sym)));
     irout->push_back(labelLT);
     irout->push_back(new Move(new Temp(*temp), ex_const(0x01)));
     irout->push_back(done);
@@ -807,6 +801,8 @@ Exp *translate_unop(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
 
 Exp *translate_simple_binop(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
 {
+    asmir_ctx_t *ctx = asmir_ctx_get();
+
     Exp *arg1 = translate_expr(expr->Iex.Binop.arg1, irbb, irout);
     Exp *arg2 = translate_expr(expr->Iex.Binop.arg2, irbb, irout);
 
@@ -856,108 +852,108 @@ Exp *translate_simple_binop(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
     
     case Iop_Shl8:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(LSHIFT, arg1, new Cast(arg2, REG_8, CAST_UNSIGNED));
     
     case Iop_Shl16:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(LSHIFT, arg1, new Cast(arg2, REG_16, CAST_UNSIGNED));
     
     case Iop_Shl32:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(LSHIFT, arg1, new Cast(arg2, REG_32, CAST_UNSIGNED));
     
     case Iop_Shl64:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(LSHIFT, arg1, new Cast(arg2, REG_64, CAST_UNSIGNED));
     
     case Iop_Shr8:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(RSHIFT, arg1, new Cast(arg2, REG_8, CAST_UNSIGNED));
     
     case Iop_Shr16:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(RSHIFT, arg1, new Cast(arg2, REG_16, CAST_UNSIGNED));
     
     case Iop_Shr32:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(RSHIFT, arg1, new Cast(arg2, REG_32, CAST_UNSIGNED));
     
     case Iop_Shr64:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(RSHIFT, arg1, new Cast(arg2, REG_64, CAST_UNSIGNED));
     
     case Iop_Sar8:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(ARSHIFT, arg1, new Cast(arg2, REG_8, CAST_UNSIGNED));
     
     case Iop_Sar16:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(ARSHIFT, arg1, new Cast(arg2, REG_16, CAST_UNSIGNED));
     
     case Iop_Sar32:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(ARSHIFT, arg1, new Cast(arg2, REG_32, CAST_UNSIGNED));
     
     case Iop_Sar64:
 
-        if (!count_opnd && !use_eflags_thunks)
+        if (!ctx->count_opnd && !use_eflags_thunks)
         {
-            count_opnd = arg2;
+            ctx->count_opnd = arg2;
         }
 
         return new BinOp(ARSHIFT, arg1, new Cast(arg2, REG_64, CAST_UNSIGNED));
@@ -1266,7 +1262,7 @@ Exp *emit_mux0x(vector<Stmt *> *irout, reg_t type,
     // match_mux0x depends on the order/types of these statements
     // if changing them here, make sure to make the corresponding changes there
     irout->push_back(new Move(new Temp(*temp), exp0));
-    irout->push_back(new CJmp(cond, new Name(done->label), new Name(labelX->label)));
+    irout->push_back(new CJmp(cond, new Name(done->sym), new Name(labelX->sym)));
     irout->push_back(labelX);
     irout->push_back(new Move(new Temp(*temp), expX));
     irout->push_back(done);
@@ -1333,12 +1329,10 @@ Exp *translate_tmp_ex(IRExpr *expr, IRSB *irbb, vector<Stmt *> *irout)
     assert(irout);
 
     IRType type;
-    string name;
 
     type = typeOfIRExpr(irbb->tyenv, expr);
 
-    name = int_to_str(get_type_size(IRType_to_reg_type(type))) + "t" + int_to_str(expr->Iex.RdTmp.tmp);
-    return mk_temp(name, type);
+    return mk_temp(expr->Iex.RdTmp.tmp, type);
 
 }
 
@@ -1424,13 +1418,11 @@ Stmt *translate_tmp_st(IRStmt *stmt, IRSB *irbb, vector<Stmt *> *irout)
 
     IRType type;
     Exp *data;
-    string name;
 
     type = typeOfIRExpr(irbb->tyenv, stmt->Ist.WrTmp.data);
     data = translate_expr(stmt->Ist.WrTmp.data, irbb, irout);
-    name = int_to_str(get_type_size(IRType_to_reg_type(type))) + "t" + int_to_str(stmt->Ist.WrTmp.tmp);
 
-    return new Move(mk_temp(name, type), data);
+    return new Move(mk_temp(stmt->Ist.WrTmp.tmp, type), data);
 }
 
 Stmt *translate_store(IRStmt *stmt, IRSB *irbb, vector<Stmt *> *irout)
@@ -1483,7 +1475,7 @@ Stmt *translate_exit(IRStmt *stmt, IRSB *irbb, vector<Stmt *> *irout)
     Name *dest = mk_dest_name(stmt->Ist.Exit.dst->Ico.U32);
     Label *next = mk_label();
 
-    irout->push_back(new CJmp(cond, dest, new Name(next->label)));
+    irout->push_back(new CJmp(cond, dest, new Name(next->sym)));
 
     return next;
 }
@@ -1712,8 +1704,7 @@ vector<Stmt *> *translate_irbb(IRSB *irbb)
         reg_t typ = IRType_to_reg_type(ty);
 
         // FIXME: Can we safely remove the T_n prefix? No need to specify the type twice...
-        string name = "T_" + int_to_str(get_type_size(typ)) + "t" + int_to_str(i);
-        irout->push_back(new VarDecl(name, typ));
+        irout->push_back(new VarDecl(sym_vex_temp(get_type_size(typ), i), typ));
     }
 
     for (i = 1; i < irbb->stmts_used; i++)
@@ -1859,12 +1850,12 @@ void insert_specials(bap_block_t *block)
 
 void generate_bap_ir_block(VexArch guest, bap_block_t *block)
 {
-    static unsigned int ir_addr = 100; // Argh, this is dumb
+    asmir_ctx_t *ctx = asmir_ctx_get();
 
     assert(block);
 
-    // Set the global everyone else will look at.
-    guest_arch = guest;
+    // Set the guest architecture everyone else will look at.
+    ctx->guest_arch = guest;
 
     // Translate the block
     if (is_special(block->inst))
@@ -1899,8 +1890,216 @@ void generate_bap_ir_block(VexArch guest, bap_block_t *block)
             vir->at(j)->asm_address = block->inst;
         }
 
-        vir->at(j)->ir_address = ir_addr++;
+        vir->at(j)->ir_address = ctx->ir_addr++;
+    }
+}
+
+typedef struct _bap_direct_param
+{
+    VexArch guest;
+    bap_block_t *block;
+    const char *error;
+
+} bap_direct_param;
+
+static void generate_bap_ir_direct_cb(IRSB *irbb, void *param)
+{
+    bap_direct_param *direct = (bap_direct_param *)param;
+
+    // use VEX IR that lives in VEX temp memory
+    direct->block->vex_ir = irbb;
+
+    // exceptions must not be thrown through the VEX code
+    try
+    {
+        generate_bap_ir_block(direct->guest, direct->block);
+    }
+    catch (const char *e)
+    {
+        direct->error = e;
+    }
+    catch (...)
+    {
+        direct->error = "Unknown exception in generate_bap_ir_block()";
+    }
+
+    direct->block->vex_ir = NULL;
+}
+
+bap_block_t *generate_bap_ir_direct(VexArch guest, uint8_t *data, address_t inst, bool keep_vex_ir)
+{
+    bap_block_t *vblock = new bap_block_t;
+    bap_direct_param param;
+
+    vblock->inst = inst;
+    vblock->inst_size = disasm_insn(guest, data, vblock->str_mnem, vblock->str_op);
+    assert(vblock->inst_size != 0 && vblock->inst_size != -1);
+
+    vblock->vex_ir = NULL;
+    vblock->bap_ir = NULL;
+
+    if (is_special(inst))
+    {
+        generate_bap_ir_block(guest, vblock);
+        return vblock;
+    }
+
+    param.guest = guest;
+    param.block = vblock;
+    param.error = NULL;
+
+    // translate_irbb() and modify_flags() are called from instrument1()
+    IRSB *irbb = translate_insn_cb(
+        guest, data, inst, NULL, generate_bap_ir_direct_cb, &param, keep_vex_ir
+    );
+
+    if (param.error)
+    {
+        throw param.error;
+    }
+
+    assert(vblock->bap_ir);
+
+    vblock->vex_ir = irbb;
+
+    return vblock;
+}
+
+typedef struct _bap_insns_param
+{
+    VexArch guest;
+    uint8_t *data;
+    address_t start;
+    address_t next;
+    bool direct;
+    bool stop;
+    const char *error;
+    vector<bap_block_t *> *blocks;
+
+} bap_insns_param;
+
+static void generate_bap_ir_insns_cb(IRSB *irbb, void *param)
+{
+    bap_insns_param *insns = (bap_insns_param *)param;
+    IRStmt *imark = irbb->stmts[0];
+
+    assert(imark->tag == Ist_IMark);
+
+    if (insns->stop || insns->error)
+    {
+        return;
+    }
+
+    if (imark->Ist.IMark.addr + imark->Ist.IMark.delta != insns->next)
+    {
+        // VEX and disassembler has different opinion on instruction length
+        insns->stop = true;
+        return;
+    }
+
+    bap_block_t *vblock = new bap_block_t;
+
+    vblock->inst = insns->next;
+    vblock->bap_ir = NULL;
+    vblock->vex_ir = NULL;
+
+    // exceptions must not be thrown through the VEX code
+    try
+    {
+        vblock->inst_size = disasm_insn(
+            insns->guest, insns->data + (insns->next - insns->start), 
+            vblock->str_mnem, vblock->str_op
+        );
+
+        assert(vblock->inst_size != 0 && vblock->inst_size != -1);
+
+        if (insns->direct)
+        {
+            vblock->vex_ir = irbb;
+            generate_bap_ir_block(insns->guest, vblock);
+            vblock->vex_ir = NULL;
+        }
+        else
+        {
+            vblock->vex_ir = vx_dopyIRSB(irbb);
+        }
+    }
+    catch (const char *e)
+    {
+        insns->error = e;
+    }
+    catch (...)
+    {
+        insns->error = "Unknown exception in generate_bap_ir_insns()";
+    }
+
+    insns->blocks->push_back(vblock);
+    insns->next += vblock->inst_size;
+}
+
+void free_bap_blocks(vector<bap_block_t *> &blocks)
+{
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        bap_block_t *block = blocks.at(i);
+
+        if (block->bap_ir)
+        {
+            // free BIL code
+            for (size_t n = 0; n < block->bap_ir->size(); n++)
+            {
+                Stmt::destroy(block->bap_ir->at(n));
+            }
+
+            delete block->bap_ir;
+        }
+
+        // VEX IR is freed with the rest of VEX memory
+        delete block;
+    }
+
+    blocks.clear();
+}
+
+vector<bap_block_t *> generate_bap_ir_insns(VexArch guest, uint8_t *data, address_t start, int max_insns, bool direct)
+{
+    vector<bap_block_t *> results;
+    bap_insns_param param;
+
+    param.guest = guest;
+    param.data = data;
+    param.start = param.next = start;
+    param.direct = direct;
+    param.stop = false;
+    param.error = NULL;
+    param.blocks = &results;
+
+    translate_block_cb(guest, data, start, max_insns, generate_bap_ir_insns_cb, &param);
+
+    if (param.error)
+    {
+        // free instructions that were translated before the failed one
+        free_bap_blocks(results);
+
+        throw param.error;
+    }
+
+    if (!direct)
+    {
+        try
+        {
+            // translate to BAP outside of the VEX callback
+            results = generate_bap_ir(guest, results);
+        }
+        catch (...)
+        {
+            free_bap_blocks(results);
+
+            throw;
+        }
     }
+
+    return results;
 }
 
 vector<bap_block_t *> generate_bap_ir(VexArch guest, vector<bap_block_t *> vblocks)
@@ -2013,15 +2212,15 @@ int match_mux0x(vector<Stmt *> *ir, unsigned int i, Exp **cond, Exp **exp0,	Exp
 
     if (s0->lhs->exp_type != TEMP || 
         s3->lhs->exp_type != TEMP || 
-        ((Temp *)s0->lhs)->name != ((Temp *)s3->lhs)->name)
+        ((Temp *)s0->lhs)->sym != ((Temp *)s3->lhs)->sym)
     {
         return -1;
     }
 
     if (s1->t_target->exp_type != NAME || 
         s1->f_target->exp_type != NAME || 
-        ((Name *)s1->f_target)->name != s2->label || 
-        ((Name *)s1->t_target)->name != s4->label)
+        ((Name *)s1->f_target)->sym != s2->sym || 
+        ((Name *)s1->t_target)->sym != s4->sym)
     {
         return -1;
     }
@@ -2083,9 +2282,11 @@ reg_t get_exp_type(Exp *exp)
 
 void do_cleanups_before_processing()
 {
-    if (count_opnd)
+    asmir_ctx_t *ctx = asmir_ctx_get();
+
+    if (ctx->count_opnd)
     {
-        count_opnd = NULL;
+        ctx->count_opnd = NULL;
     }
 }
 
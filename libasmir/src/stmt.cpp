@@ -4,6 +4,7 @@
  permission.
 */
 #include "stmt.h"
+#include "context.h"
 #include <iostream>
 #include <fstream>
 #include <assert.h>
@@ -109,25 +110,31 @@ void Stmt::destroy(Stmt *s)
 }
 
 VarDecl::VarDecl(string n, reg_t t, address_t asm_ad, address_t ir_ad)
-    : Stmt(VARDECL, asm_ad, ir_ad), name(n), typ(t)
+    : Stmt(VARDECL, asm_ad, ir_ad), sym(sym_from_string(n)), typ(t)
+{
+
+}
+
+VarDecl::VarDecl(sym_t s, reg_t t, address_t asm_ad, address_t ir_ad)
+    : Stmt(VARDECL, asm_ad, ir_ad), sym(s), typ(t)
 {
 
 }
 
 VarDecl::VarDecl(const VarDecl &other) :
-    Stmt(VARDECL, other.asm_address, other.ir_address), name(other.name), typ(other.typ)
+    Stmt(VARDECL, other.asm_address, other.ir_address), sym(other.sym), typ(other.typ)
 {
 
 }
 
-VarDecl::VarDecl(Temp *t) : Stmt(VARDECL, 0x0, 0x0), name(t->name), typ(t->typ)
+VarDecl::VarDecl(Temp *t) : Stmt(VARDECL, 0x0, 0x0), sym(t->sym), typ(t->typ)
 {
 
 }
 
 string VarDecl::tostring()
 {
-    string ret = "var " + name + ":" + Exp::string_type(this->typ) + ";";
+    string ret = "var " + name() + ":" + Exp::string_type(this->typ) + ";";
 
     return ret;
 }
@@ -161,12 +168,17 @@ Move *Move::clone() const
 
 Label::Label(const Label &other) : Stmt(LABEL, other.asm_address, other.ir_address)
 {
-    this->label = string(other.label);
+    this->sym = other.sym;
 }
 
 Label::Label(string l, address_t asm_addr, address_t ir_addr) : Stmt(LABEL, asm_addr, ir_addr)
 {
-    label = l;
+    sym = sym_from_string(l);
+}
+
+Label::Label(sym_t s, address_t asm_addr, address_t ir_addr) : Stmt(LABEL, asm_addr, ir_addr)
+{
+    sym = s;
 }
 
 Label *Label::clone() const
@@ -176,7 +188,7 @@ Label *Label::clone() const
 
 string Label::tostring()
 {
-    return "label " + label + ":";
+    return "label " + label() + ":";
 }
 
 Jmp::Jmp(Exp *e, address_t asm_addr, address_t ir_addr) : Stmt(JMP, asm_addr, ir_addr), target(e)
@@ -337,7 +349,7 @@ string Call::tostring()
     if (this->callee->exp_type == NAME)
     {
         name = (Name *) this->callee;
-        ostr << name->name;
+        ostr << name->name();
     }
     else
     {
@@ -529,14 +541,14 @@ string int_to_hex(int i)
 }
 
 //----------------------------------------------------------------------
-// Generate a unique label, this is done using a static counter
-// internal to the function.
+// Generate a unique label, this is done using a counter from the
+// current translation context.
 //----------------------------------------------------------------------
 Label *mk_label()
 {
-    static int label_counter = 0;
+    asmir_ctx_t *ctx = asmir_ctx_get();
  
-    return new Label("L_" + int_to_str(label_counter++));
+    return new Label(sym_label(ctx->label_counter++));
 }
 
 
@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#include <string>
+#include <map>
+
+#include "symbol.h"
+
+using namespace std;
+
+// max. length of the encoded symbol name
+#define SYM_NAME_MAX 0x40
+
+struct sym_str_less
+{
+    bool operator()(const char *a, const char *b) const
+    {
+        return strcmp(a, b) < 0;
+    }
+};
+
+typedef map<const char *, uint32_t, sym_str_less> sym_map_t;
+
+// interned strings, entries are never removed or changed once added
+static const char *sym_table[SYM_TABLE_MAX];
+static uint32_t sym_table_used = 0;
+
+// lookup maps for register names and other strings
+static sym_map_t *sym_map_reg = NULL;
+static sym_map_t *sym_map_str = NULL;
+
+static pthread_rwlock_t sym_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// guest registers that are known in advance, they are interned once at init
+static const char *sym_reg_names[] =
+{
+    // x86 general purpose registers and their parts
+    "EAX", "EBX", "ECX", "EDX", "ESI", "EDI", "EBP", "ESP", "EIP",
+    "AX", "BX", "CX", "DX", "SI", "DI", "BP", "SP",
+    "AL", "BL", "CL", "DL", "AH", "BH", "CH", "DH",
+
+    // x86 flags and EFLAGS thunk
+    "EFLAGS", "CF", "PF", "AF", "ZF", "SF", "OF", "DFLAG", "IDFLAG", "ACFLAG",
+    "CC_OP", "CC_DEP1", "CC_DEP2", "CC_NDEP", "EMWARN",
+
+    // x86 segment and system registers
+    "CS", "DS", "ES", "FS", "GS", "SS", "LDT", "GDT", "IDT",
+    "CS_BASE", "DS_BASE", "ES_BASE", "FS_BASE", "GS_BASE", "SS_BASE",
+    "CR0", "CR1", "CR2", "CR3", "CR4", "CR5", "CR6", "CR7",
+    "CR8", "CR9", "CR10", "CR11", "CR12", "CR13", "CR14", "CR15",
+    "DR0", "DR1", "DR2", "DR3", "DR4", "DR5", "DR6", "DR7",
+
+    // x86 FPU and SSE state
+    "FPREGS", "FPTAGS", "FTOP", "FPROUND", "FC3210", "SSEROUND",
+    "XMM0", "XMM1", "XMM2", "XMM3", "XMM4", "XMM5", "XMM6", "XMM7",
+    "TISTART", "TILEN", "NRADDR", "IP_AT_SYSCALL",
+
+    // ARM registers
+    "R0", "R1", "R2", "R3", "R4", "R5", "R6", "R7",
+    "R8", "R9", "R10", "R11", "R12", "R13", "R14", "R15T",
+
+    NULL
+};
+
+// open addressing hash of sym_reg_names, holds table index + 1, 0 is empty slot
+#define SYM_REG_HASH_SIZE 0x200
+
+static uint32_t sym_reg_hash[SYM_REG_HASH_SIZE];
+
+static pthread_once_t sym_reg_once = PTHREAD_ONCE_INIT;
+
+static sym_t sym_intern(sym_kind_t kind, const char *name)
+{
+    sym_map_t **lookup = kind == SYM_REG ? &sym_map_reg : &sym_map_str;
+    sym_map_t::iterator it;
+
+    pthread_rwlock_rdlock(&sym_lock);
+
+    if (*lookup && (it = (*lookup)->find(name)) != (*lookup)->end())
+    {
+        uint32_t index = it->second;
+
+        pthread_rwlock_unlock(&sym_lock);
+        return SYM_MAKE(kind, index);
+    }
+
+    pthread_rwlock_unlock(&sym_lock);
+    pthread_rwlock_wrlock(&sym_lock);
+
+    if (*lookup == NULL)
+    {
+        *lookup = new sym_map_t;
+    }
+
+    // other thread might add the same string while we were waiting for the lock
+    if ((it = (*lookup)->find(name)) != (*lookup)->end())
+    {
+        uint32_t index = it->second;
+
+        pthread_rwlock_unlock(&sym_lock);
+        return SYM_MAKE(kind, index);
+    }
+
+    if (sym_table_used >= SYM_TABLE_MAX)
+    {
+        pthread_rwlock_unlock(&sym_lock);
+        throw "sym_intern(): symbol table overflow";
+    }
+
+    size_t prefix = kind == SYM_REG ? 2 : 0;
+    char *str = (char *)malloc(prefix + strlen(name) + 1);
+    if (str == NULL)
+    {
+        pthread_rwlock_unlock(&sym_lock);
+        throw "sym_intern(): malloc() fails";
+    }
+
+    // registers are stored with "R_" prefix to materialize them without copying
+    strcpy(str, prefix ? "R_" : "");
+    strcat(str, name);
+
+    uint32_t index = sym_table_used;
+
+    sym_table[index] = str;
+    sym_table_used += 1;
+
+    (**lookup)[str + prefix] = index;
+
+    pthread_rwlock_unlock(&sym_lock);
+
+    return SYM_MAKE(kind, index);
+}
+
+static const char *parse_num(const char *str, int base, uint32_t *val)
+{
+    char *end = NULL;
+
+    if (!isxdigit(*str))
+    {
+        return NULL;
+    }
+
+    *val = strtoul(str, &end, base);
+
+    return end;
+}
+
+static uint32_t sym_reg_hash_name(const char *name)
+{
+    uint32_t hash = 2166136261U;
+
+    // FNV-1a
+    for (; *name != '\0'; name++)
+    {
+        hash = (hash ^ (uint8_t)*name) * 16777619U;
+    }
+
+    return hash;
+}
+
+static void sym_reg_init(void)
+{
+    for (int i = 0; sym_reg_names[i] != NULL; i++)
+    {
+        uint32_t index = SYM_VAL(sym_intern(SYM_REG, sym_reg_names[i]));
+        uint32_t slot = sym_reg_hash_name(sym_reg_names[i]) & (SYM_REG_HASH_SIZE - 1);
+
+        while (sym_reg_hash[slot] != 0)
+        {
+            slot = (slot + 1) & (SYM_REG_HASH_SIZE - 1);
+        }
+
+        sym_reg_hash[slot] = index + 1;
+    }
+}
+
+sym_t sym_reg(const char *name)
+{
+    // table of known registers is never changed after init, read it without locking
+    pthread_once(&sym_reg_once, sym_reg_init);
+
+    uint32_t slot = sym_reg_hash_name(name) & (SYM_REG_HASH_SIZE - 1);
+
+    while (sym_reg_hash[slot] != 0)
+    {
+        uint32_t index = sym_reg_hash[slot] - 1;
+
+        // skip "R_" prefix of the interned name
+        if (!strcmp(sym_table[index] + 2, name))
+        {
+            return SYM_MAKE(SYM_REG, index);
+        }
+
+        slot = (slot + 1) & (SYM_REG_HASH_SIZE - 1);
+    }
+
+    // unknown register
+    return sym_intern(SYM_REG, name);
+}
+
+sym_t sym_from_string(const char *name)
+{
+    sym_t sym = SYM_NULL;
+    const char *p = NULL;
+    uint32_t a = 0, b = 0;
+
+    if (!strncmp(name, "R_", 2))
+    {
+        return sym_reg(name + 2);
+    }
+    else if (!strncmp(name, "T_", 2) && (p = parse_num(name + 2, 10, &a)))
+    {
+        if (*p == '\0')
+        {
+            sym = sym_temp(a);
+        }
+        else if (*p == 't' && (p = parse_num(p + 1, 10, &b)) && *p == '\0')
+        {
+            sym = sym_vex_temp(a, b);
+        }
+    }
+    else if (!strncmp(name, "V_REIL_TMP_", 11))
+    {
+        if ((p = parse_num(name + 11, 10, &a)) && *p == '\0')
+        {
+            sym = sym_reil_tmp(a);
+        }
+    }
+    else if (!strncmp(name, "V_", 2))
+    {
+        if ((p = parse_num(name + 2, 10, &a)) && *p == '\0')
+        {
+            sym = sym_reil_temp(a);
+        }
+    }
+    else if (!strncmp(name, "pc_0x", 5))
+    {
+        if ((p = parse_num(name + 5, 16, &a)) && *p == '\0')
+        {
+            sym = sym_pc(a);
+        }
+    }
+    else if (!strncmp(name, "L_", 2))
+    {
+        if ((p = parse_num(name + 2, 10, &a)) && *p == '\0')
+        {
+            sym = sym_label(a);
+        }
+    }
+
+    if (sym != SYM_NULL)
+    {
+        char buff[SYM_NAME_MAX];
+
+        // accept only canonical names that can be materialized back as is
+        if (sym_snprint(buff, sizeof(buff), sym) < (int)sizeof(buff) && !strcmp(buff, name))
+        {
+            return sym;
+        }
+    }
+
+    return sym_intern(SYM_STR, name);
+}
+
+int sym_snprint(char *buff, size_t size, sym_t sym)
+{
+    uint64_t val = SYM_VAL(sym);
+
+    switch (SYM_KIND(sym))
+    {
+    case SYM_STR:
+    case SYM_REG:
+
+        return snprintf(buff, size, "%s", sym_table[val]);
+
+    case SYM_TEMP:
+
+        return snprintf(buff, size, "T_%d", (int)val);
+
+    case SYM_VEX_TEMP:
+
+        return snprintf(buff, size, "T_%dt%d", (int)(val >> 32), (int)(val & 0xffffffff));
+
+    case SYM_REIL_TEMP:
+
+        return snprintf(buff, size, "V_%.2d", (int)val);
+
+    case SYM_REIL_TMP:
+
+        return snprintf(buff, size, "V_REIL_TMP_%d", (int)val);
+
+    case SYM_PC:
+
+        return snprintf(buff, size, "pc_0x%x", (uint32_t)val);
+
+    case SYM_LABEL:
+
+        return snprintf(buff, size, "L_%d", (int)val);
+
+    default:
+
+        return snprintf(buff, size, "%s", "");
+    }
+}
+
+string sym_to_string(sym_t sym)
+{
+    char buff[SYM_NAME_MAX];
+
+    if (SYM_KIND(sym) == SYM_STR || SYM_KIND(sym) == SYM_REG)
+    {
+        return string(sym_table[SYM_VAL(sym)]);
+    }
+
+    sym_snprint(buff, sizeof(buff), sym);
+
+    return string(buff);
+}
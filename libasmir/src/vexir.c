@@ -9,9 +9,31 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "libvex.h"
+#include "libvex_guest_x86.h"
+#include "libvex_guest_arm.h"
 #include "vexmem.h"
+#include "context.h"
+
+// VEX internals that are needed to optimize IR of each instruction 
+// of the superblock separately (see priv/main_globals.h and priv/ir_opt.h)
+extern VexControl vex_control;
+
+extern IRSB *do_iropt_BB(IRSB *bb0,
+                         IRExpr *(* specHelper)(HChar *, IRExpr **, IRStmt **, Int),
+                         Bool (* preciseMemExnsFn)(Int, Int),
+                         Addr64 guest_addr,
+                         VexArch guest_arch);
+
+// priv/guest_x86_defs.h
+extern IRExpr *guest_x86_spechelper(HChar *, IRExpr **, IRStmt **, Int);
+extern Bool guest_x86_state_requires_precise_mem_exns(Int, Int);
+
+// priv/guest_arm_defs.h
+extern IRExpr *guest_arm_spechelper(HChar *, IRExpr **, IRStmt **, Int);
+extern Bool guest_arm_state_requires_precise_mem_exns(Int, Int);
 
 
 //======================================================================
@@ -20,27 +42,17 @@
 //
 //======================================================================
 
-// Some info required for translation
-static VexArchInfo vai;
-static VexGuestExtents vge;
-static VexTranslateArgs vta;
-static VexTranslateResult vtr;
-
-// Define a temp buffer to hold the translated bytes
-// Not needed with patched VEX
-#ifndef AMD64
+// VEX itself is not reentrant, so, only one thread can run
+// LibVEX_Translate() at the same time
+static pthread_mutex_t vex_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t vex_init_once = PTHREAD_ONCE_INIT;
 
-#define TMPBUF_SIZE 2000
+// context that was selected by the current thread
+static __thread asmir_ctx_t *ctx_current = NULL;
 
-static UChar tmpbuf[TMPBUF_SIZE];
-static Int tmpbuf_used;
-
-#endif
-
-// Global for saving the intermediate results of translation from
-// within the callback (instrument1)
-static IRSB *irbb_current = NULL;
-static int size_current = 0;
+// context for threads that didn't select their own one
+static asmir_ctx_t *ctx_default = NULL;
+static pthread_once_t ctx_default_once = PTHREAD_ONCE_INIT;
 
 //======================================================================
 //
@@ -84,6 +96,367 @@ static UInt needs_self_check(void *opaque, VexGuestExtents *vge)
     return 0;
 }
 
+//======================================================================
+//
+// Superblock splitting
+//
+//======================================================================
+
+typedef void (* vx_temp_fn)(IRTemp *tmp, IRTemp *map);
+
+static void temp_mark(IRTemp *tmp, IRTemp *map)
+{
+    if (*tmp != IRTemp_INVALID)
+    {
+        map[*tmp] = 0;
+    }
+}
+
+static void temp_rename(IRTemp *tmp, IRTemp *map)
+{
+    if (*tmp != IRTemp_INVALID)
+    {
+        *tmp = map[*tmp];
+    }
+}
+
+static void temps_expr(IRExpr *e, vx_temp_fn fn, IRTemp *map)
+{
+    int i;
+
+    if (e == NULL)
+    {
+        return;
+    }
+
+    switch (e->tag)
+    {
+    case Iex_RdTmp:
+
+        fn(&e->Iex.RdTmp.tmp, map);
+        break;
+
+    case Iex_GetI:
+
+        temps_expr(e->Iex.GetI.ix, fn, map);
+        break;
+
+    case Iex_Qop:
+
+        temps_expr(e->Iex.Qop.arg1, fn, map);
+        temps_expr(e->Iex.Qop.arg2, fn, map);
+        temps_expr(e->Iex.Qop.arg3, fn, map);
+        temps_expr(e->Iex.Qop.arg4, fn, map);
+        break;
+
+    case Iex_Triop:
+
+        temps_expr(e->Iex.Triop.arg1, fn, map);
+        temps_expr(e->Iex.Triop.arg2, fn, map);
+        temps_expr(e->Iex.Triop.arg3, fn, map);
+        break;
+
+    case Iex_Binop:
+
+        temps_expr(e->Iex.Binop.arg1, fn, map);
+        temps_expr(e->Iex.Binop.arg2, fn, map);
+        break;
+
+    case Iex_Unop:
+
+        temps_expr(e->Iex.Unop.arg, fn, map);
+        break;
+
+    case Iex_Load:
+
+        temps_expr(e->Iex.Load.addr, fn, map);
+        break;
+
+    case Iex_Mux0X:
+
+        temps_expr(e->Iex.Mux0X.cond, fn, map);
+        temps_expr(e->Iex.Mux0X.expr0, fn, map);
+        temps_expr(e->Iex.Mux0X.exprX, fn, map);
+        break;
+
+    case Iex_CCall:
+
+        for (i = 0; e->Iex.CCall.args[i]; i++)
+        {
+            temps_expr(e->Iex.CCall.args[i], fn, map);
+        }
+
+        break;
+
+    default:
+
+        // Iex_Binder, Iex_Get, Iex_Const
+        break;
+    }
+}
+
+static void temps_stmt(IRStmt *st, vx_temp_fn fn, IRTemp *map)
+{
+    int i;
+
+    switch (st->tag)
+    {
+    case Ist_AbiHint:
+
+        temps_expr(st->Ist.AbiHint.base, fn, map);
+        temps_expr(st->Ist.AbiHint.nia, fn, map);
+        break;
+
+    case Ist_Put:
+
+        temps_expr(st->Ist.Put.data, fn, map);
+        break;
+
+    case Ist_PutI:
+
+        temps_expr(st->Ist.PutI.ix, fn, map);
+        temps_expr(st->Ist.PutI.data, fn, map);
+        break;
+
+    case Ist_WrTmp:
+
+        fn(&st->Ist.WrTmp.tmp, map);
+        temps_expr(st->Ist.WrTmp.data, fn, map);
+        break;
+
+    case Ist_Store:
+
+        temps_expr(st->Ist.Store.addr, fn, map);
+        temps_expr(st->Ist.Store.data, fn, map);
+        break;
+
+    case Ist_CAS:
+
+        fn(&st->Ist.CAS.details->oldHi, map);
+        fn(&st->Ist.CAS.details->oldLo, map);
+        temps_expr(st->Ist.CAS.details->addr, fn, map);
+        temps_expr(st->Ist.CAS.details->expdHi, fn, map);
+        temps_expr(st->Ist.CAS.details->expdLo, fn, map);
+        temps_expr(st->Ist.CAS.details->dataHi, fn, map);
+        temps_expr(st->Ist.CAS.details->dataLo, fn, map);
+        break;
+
+    case Ist_LLSC:
+
+        fn(&st->Ist.LLSC.result, map);
+        temps_expr(st->Ist.LLSC.addr, fn, map);
+        temps_expr(st->Ist.LLSC.storedata, fn, map);
+        break;
+
+    case Ist_Dirty:
+
+        fn(&st->Ist.Dirty.details->tmp, map);
+        temps_expr(st->Ist.Dirty.details->guard, fn, map);
+        temps_expr(st->Ist.Dirty.details->mAddr, fn, map);
+
+        for (i = 0; st->Ist.Dirty.details->args[i]; i++)
+        {
+            temps_expr(st->Ist.Dirty.details->args[i], fn, map);
+        }
+
+        break;
+
+    case Ist_Exit:
+
+        temps_expr(st->Ist.Exit.guard, fn, map);
+        break;
+
+    default:
+
+        // Ist_NoOp, Ist_IMark, Ist_MBE
+        break;
+    }
+}
+
+static IRExpr *mk_guest_word(IRType ty, Addr64 val)
+{
+    return IRExpr_Const(ty == Ity_I32 ? IRConst_U32((UInt)val) : IRConst_U64(val));
+}
+
+//----------------------------------------------------------------------
+// Check for the instruction pointer update that VEX puts at the
+// beginning of each instruction except the first one of the superblock
+//----------------------------------------------------------------------
+static int is_ip_put(VexArch guest, IRStmt *st, IRStmt *imark)
+{
+    Int offset = -1;
+    Addr64 val = 0;
+
+    if (st->tag != Ist_Put || st->Ist.Put.data->tag != Iex_Const)
+    {
+        return 0;
+    }
+
+    switch (guest)
+    {
+    case VexArchX86:
+
+        offset = offsetof(VexGuestX86State, guest_EIP);
+        break;
+
+    case VexArchARM:
+
+        offset = offsetof(VexGuestARMState, guest_R15T);
+        break;
+
+    default:
+
+        return 0;
+    }
+
+    switch (st->Ist.Put.data->Iex.Const.con->tag)
+    {
+    case Ico_U32:
+
+        val = st->Ist.Put.data->Iex.Const.con->Ico.U32;
+        break;
+
+    case Ico_U64:
+
+        val = st->Ist.Put.data->Iex.Const.con->Ico.U64;
+        break;
+
+    default:
+
+        return 0;
+    }
+
+    return st->Ist.Put.offset == offset && 
+           val == imark->Ist.IMark.addr + imark->Ist.IMark.delta;
+}
+
+//----------------------------------------------------------------------
+// Make IRSB for instruction which statements are first ... last - 1, 
+// it looks exactly like IRSB that we get for this instruction when
+// translating one instruction at a time.
+//----------------------------------------------------------------------
+static IRSB *block_split_insn(asmir_ctx_t *ctx, IRSB *irbb, int first, int last, IRType gWordTy)
+{
+    IRStmt *imark = irbb->stmts[first];
+    IRSB *bb = emptyIRSB();
+    IRTemp *map = NULL;
+    int i, types_used = irbb->tyenv->types_used;
+
+    assert(imark->tag == Ist_IMark);
+
+    for (i = first; i < last; i++)
+    {
+        if (i == first + 1 && ctx->block_insns > 0 && 
+            is_ip_put(ctx->guest_arch, irbb->stmts[i], imark))
+        {
+            continue;
+        }
+
+        addStmtToIRSB(bb, deepCopyIRStmt(irbb->stmts[i]));
+    }
+
+    if (last == irbb->stmts_used)
+    {
+        // the last instruction
+        bb->next = deepCopyIRExpr(irbb->next);
+        bb->jumpkind = irbb->jumpkind;
+    }
+    else
+    {
+        bb->next = mk_guest_word(gWordTy, imark->Ist.IMark.addr + imark->Ist.IMark.len);
+        bb->jumpkind = Ijk_Boring;
+    }
+
+    // collect temps that are used by the instruction
+    map = (IRTemp *)LibVEX_Alloc(sizeof(IRTemp) * (types_used + 1));
+
+    for (i = 0; i < types_used; i++)
+    {
+        map[i] = IRTemp_INVALID;
+    }
+
+    for (i = 0; i < bb->stmts_used; i++)
+    {
+        temps_stmt(bb->stmts[i], temp_mark, map);
+    }
+
+    temps_expr(bb->next, temp_mark, map);
+
+    // allocate them in the same order
+    for (i = 0; i < types_used; i++)
+    {
+        if (map[i] != IRTemp_INVALID)
+        {
+            map[i] = newIRTemp(bb->tyenv, irbb->tyenv->types[i]);
+        }
+    }
+
+    for (i = 0; i < bb->stmts_used; i++)
+    {
+        temps_stmt(bb->stmts[i], temp_rename, map);
+    }
+
+    temps_expr(bb->next, temp_rename, map);
+
+    return bb;
+}
+
+//----------------------------------------------------------------------
+// Split IRSB of the superblock (that was translated with disabled 
+// optimization) at the Ist_IMark boundaries, optimize each instruction
+// and pass it to the callback.
+//----------------------------------------------------------------------
+static void block_split(asmir_ctx_t *ctx, IRSB *irbb, IRType gWordTy)
+{
+    IRExpr *(* specHelper)(HChar *, IRExpr **, IRStmt **, Int) = NULL;
+    Bool (* preciseMemExnsFn)(Int, Int) = NULL;
+    int i, first = -1;
+
+    switch (ctx->guest_arch)
+    {
+    case VexArchX86:
+
+        specHelper = guest_x86_spechelper;
+        preciseMemExnsFn = guest_x86_state_requires_precise_mem_exns;
+        break;
+
+    case VexArchARM:
+
+        specHelper = guest_arm_spechelper;
+        preciseMemExnsFn = guest_arm_state_requires_precise_mem_exns;
+        break;
+
+    default:
+
+        assert(0);
+    }
+
+    for (i = 0; i <= irbb->stmts_used; i++)
+    {
+        if (i < irbb->stmts_used && irbb->stmts[i]->tag != Ist_IMark)
+        {
+            continue;
+        }
+
+        if (first != -1)
+        {
+            IRStmt *imark = irbb->stmts[first];
+            IRSB *bb = block_split_insn(ctx, irbb, first, i, gWordTy);
+
+            // the same optimizations as for the single instruction
+            vex_control.iropt_level = ASMIR_IROPT_LEVEL;
+            bb = do_iropt_BB(bb, specHelper, preciseMemExnsFn, imark->Ist.IMark.addr, ctx->guest_arch);
+            vex_control.iropt_level = 0;
+
+            ctx->irsb_cb(bb, ctx->irsb_cb_param);
+            ctx->block_insns += 1;
+        }
+
+        // IR statements that goes before the first IMark are not needed
+        first = i;
+    }
+}
+
 //----------------------------------------------------------------------
 // This is where we copy out the IRSB
 //----------------------------------------------------------------------
@@ -94,33 +467,49 @@ static IRSB *instrument1(void *callback_opaque,
                          IRType gWordTy, 
                          IRType hWordTy)
 {
+    asmir_ctx_t *ctx = (asmir_ctx_t *)callback_opaque;
+
     assert(irbb);
+    assert(ctx);
 
-    irbb_current = vx_dopyIRSB(irbb);
-    size_current = vge->len[0];
+    if (ctx->block_max > 1)
+    {
+        IRSB *bb = emptyIRSB();
 
-    return irbb;
-}
+        block_split(ctx, irbb, gWordTy);
 
-//----------------------------------------------------------------------
-// Initializes VEX
-// It must be called before using VEX for translation to Valgrind IR
-//----------------------------------------------------------------------
-void translate_init()
-{
-    static int initialized = 0;
+        ctx->size_current = vge->len[0];
+
+        // VEX doesn't need the original IR anymore
+        bb->next = mk_guest_word(gWordTy, vge->base[0]);
+        bb->jumpkind = Ijk_Boring;
 
-    if (initialized)
+        return bb;
+    }
+
+    if (ctx->irsb_cb)
     {
-        return;
+        // process VEX IR in place
+        ctx->irsb_cb(irbb, ctx->irsb_cb_param);
+        ctx->block_insns += 1;
     }
 
-    initialized = 1;
+    if (ctx->irsb_keep)
+    {
+        ctx->irbb_current = vx_dopyIRSB(irbb);
+    }
 
+    ctx->size_current = vge->len[0];
+
+    return irbb;
+}
+
+static void vex_init(void)
+{
     // Initialize VEX
     VexControl vc;
     vc.iropt_verbosity              = 0;
-    vc.iropt_level                  = 2;
+    vc.iropt_level                  = ASMIR_IROPT_LEVEL;
     vc.iropt_precise_memory_exns    = False;
     vc.iropt_unroll_thresh          = 0;
     vc.guest_max_insns              = 1; // By default, we translate 1 instruction at a time
@@ -132,93 +521,250 @@ void translate_init()
                 0,              // Debug level
                 False,          // Valgrind support
                 &vc);
+}
 
-    LibVEX_default_VexArchInfo(&vai);
+//----------------------------------------------------------------------
+// Initializes VEX
+// It must be called before using VEX for translation to Valgrind IR
+//----------------------------------------------------------------------
+void translate_init()
+{
+    pthread_once(&vex_init_once, vex_init);
+}
+
+//----------------------------------------------------------------------
+// Allocates and initializes new translation context
+//----------------------------------------------------------------------
+asmir_ctx_t *asmir_ctx_new(void)
+{
+    asmir_ctx_t *ctx = (asmir_ctx_t *)malloc(sizeof(asmir_ctx_t));
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+
+    memset(ctx, 0, sizeof(asmir_ctx_t));
+
+    translate_init();
+
+    LibVEX_default_VexArchInfo(&ctx->vai);
 /*
     // Enable SSE
-    vai.hwcaps |= VEX_HWCAPS_X86_SSE1;
-    vai.hwcaps |= VEX_HWCAPS_X86_SSE2;
-    vai.hwcaps |= VEX_HWCAPS_X86_SSE3;
-    vai.hwcaps |= VEX_HWCAPS_X86_LZCNT;
+    ctx->vai.hwcaps |= VEX_HWCAPS_X86_SSE1;
+    ctx->vai.hwcaps |= VEX_HWCAPS_X86_SSE2;
+    ctx->vai.hwcaps |= VEX_HWCAPS_X86_SSE3;
+    ctx->vai.hwcaps |= VEX_HWCAPS_X86_LZCNT;
 */
     // Setup the translation args
-    vta.arch_guest          = VexArch_INVALID; // to be assigned later
-    vta.archinfo_guest      = vai;
+    ctx->vta.arch_guest          = VexArch_INVALID; // to be assigned later
+    ctx->vta.archinfo_guest      = ctx->vai;
 
     // FIXME: detect this one automatically
 #ifdef AMD64
     
-    vta.arch_host           = VexArchAMD64;
+    ctx->vta.arch_host           = VexArchAMD64;
 
 #else
     
-    vta.arch_host           = VexArchX86;       // Target arch
+    ctx->vta.arch_host           = VexArchX86;       // Target arch
 
 #endif
     
-    vta.archinfo_host       = vai;
-    vta.guest_bytes         = NULL;             // Set in translate_insns
-    vta.guest_bytes_addr    = 0;                // Set in translate_insns
-    vta.callback_opaque     = NULL;             // Used by chase_into_ok, but never actually called
-    vta.chase_into_ok       = chase_into_ok;    // Always returns false
-    vta.preamble_function   = NULL;
-    vta.guest_extents       = &vge;
+    ctx->vta.archinfo_host       = ctx->vai;
+    ctx->vta.guest_bytes         = NULL;             // Set in translate_insns
+    ctx->vta.guest_bytes_addr    = 0;                // Set in translate_insns
+    ctx->vta.callback_opaque     = ctx;              // Passed to instrument1 and chase_into_ok
+    ctx->vta.chase_into_ok       = chase_into_ok;    // Always returns false
+    ctx->vta.preamble_function   = NULL;
+    ctx->vta.guest_extents       = &ctx->vge;
 
 #ifdef AMD64
     
-    vta.host_bytes          = NULL;             // Buffer for storing the output binary
-    vta.host_bytes_size     = 0;
-    vta.host_bytes_used     = NULL;
+    ctx->vta.host_bytes          = NULL;             // Buffer for storing the output binary
+    ctx->vta.host_bytes_size     = 0;
+    ctx->vta.host_bytes_used     = NULL;
 
 #else
     
-    vta.host_bytes          = tmpbuf;           // Buffer for storing the output binary
-    vta.host_bytes_size     = TMPBUF_SIZE;
-    vta.host_bytes_used     = &tmpbuf_used;
+    ctx->vta.host_bytes          = ctx->tmpbuf;      // Buffer for storing the output binary
+    ctx->vta.host_bytes_size     = ASMIR_TMPBUF_SIZE;
+    ctx->vta.host_bytes_used     = &ctx->tmpbuf_used;
 
 #endif
 
-    vta.instrument1         = instrument1;      // Callback we defined to help us save the IR
-    vta.instrument2         = NULL;
-    vta.traceflags          = 0;                // Debug verbosity
-    vta.dispatch_unassisted = dispatch;         // Not used
-    vta.dispatch_assisted   = dispatch;         // Not used
-    vta.needs_self_check    = needs_self_check; // Not used
+    ctx->vta.instrument1         = instrument1;      // Callback we defined to help us save the IR
+    ctx->vta.instrument2         = NULL;
+    ctx->vta.traceflags          = 0;                // Debug verbosity
+    ctx->vta.dispatch_unassisted = dispatch;         // Not used
+    ctx->vta.dispatch_assisted   = dispatch;         // Not used
+    ctx->vta.needs_self_check    = needs_self_check; // Not used
+
+    vx_arena_init(&ctx->arena);
+
+    ctx->guest_arch = VexArch_INVALID;
+    ctx->count_opnd = NULL;
+    ctx->ir_addr = 100; // Argh, this is dumb
+
+    return ctx;
 }
 
-//----------------------------------------------------------------------
-// Translate 1 instruction to VEX IR.
-//----------------------------------------------------------------------
-IRSB *translate_insn(VexArch guest,
-                     unsigned char *insn_start,
-                     unsigned int insn_addr,
-                     int *insn_size)
+void asmir_ctx_free(asmir_ctx_t *ctx)
 {
-    vta.arch_guest = guest;
+    assert(ctx);
+
+    if (ctx_current == ctx)
+    {
+        ctx_current = NULL;
+    }
+
+    disasm_ctx_free(ctx);
+    vx_arena_free(&ctx->arena);
+    free(ctx);
+}
+
+void asmir_ctx_set(asmir_ctx_t *ctx)
+{
+    ctx_current = ctx;
+}
+
+static void ctx_default_init(void)
+{
+    ctx_default = asmir_ctx_new();
+    assert(ctx_default);
+}
+
+asmir_ctx_t *asmir_ctx_get(void)
+{
+    if (ctx_current)
+    {
+        return ctx_current;
+    }
+
+    pthread_once(&ctx_default_once, ctx_default_init);
+
+    return ctx_default;
+}
+
+static void translate_vex(asmir_ctx_t *ctx,
+                          VexArch guest,
+                          unsigned char *insn_start,
+                          unsigned int insn_addr)
+{
+    ctx->vta.arch_guest = guest;
 
     if (guest == VexArchARM)
     {
         // We must set the ARM version of VEX aborts
-        vta.archinfo_guest.hwcaps |= 5 /* ARMv5 */;
+        ctx->vta.archinfo_guest.hwcaps |= 5 /* ARMv5 */;
     }
 
-    vta.guest_bytes      = (UChar *)(insn_start); // Ptr to actual bytes of start of instruction
-    vta.guest_bytes_addr = (Addr64)(insn_addr);
+    ctx->vta.guest_bytes      = (UChar *)(insn_start); // Ptr to actual bytes of start of instruction
+    ctx->vta.guest_bytes_addr = (Addr64)(insn_addr);
+
+    ctx->irbb_current = NULL;
+    ctx->size_current = 0;
+    ctx->block_insns = 0;
 
-    irbb_current = NULL;
-    size_current = 0;
+    pthread_mutex_lock(&vex_lock);
+
+    if (ctx->block_max > 1)
+    {
+        // instructions will be optimized separately in block_split()
+        vex_control.guest_max_insns = ctx->block_max;
+        vex_control.iropt_level = 0;
+    }
 
     // FIXME: check the result
     // Do the actual translation
-    vtr = LibVEX_Translate(&vta);
+    LibVEX_Translate(&ctx->vta);
+
+    vex_control.guest_max_insns = 1;
+    vex_control.iropt_level = ASMIR_IROPT_LEVEL;
 
-    assert(irbb_current);
+    pthread_mutex_unlock(&vex_lock);
+
+    ctx->irsb_cb = NULL;
+    ctx->irsb_cb_param = NULL;
+    ctx->block_max = 0;
+}
+
+//----------------------------------------------------------------------
+// Translate 1 instruction to VEX IR and pass it to the callback while
+// VEX memory is still valid. VEX IR is copied and returned only when
+// keep is set, otherwise NULL is returned.
+//----------------------------------------------------------------------
+IRSB *translate_insn_cb(VexArch guest,
+                        unsigned char *insn_start,
+                        unsigned int insn_addr,
+                        int *insn_size,
+                        asmir_irsb_cb_t cb,
+                        void *param,
+                        int keep)
+{
+    asmir_ctx_t *ctx = asmir_ctx_get();
+
+    ctx->irsb_cb = cb;
+    ctx->irsb_cb_param = param;
+    ctx->irsb_keep = keep;
+    ctx->block_max = 0;
+
+    translate_vex(ctx, guest, insn_start, insn_addr);
 
     if (insn_size)
     {
-        *insn_size = size_current;
+        *insn_size = ctx->size_current;
+    }
+
+    return ctx->irbb_current;
+}
+
+//----------------------------------------------------------------------
+// Translate up to max_insns instructions with one VEX call and pass
+// VEX IR of each of them to the callback while VEX memory is still
+// valid. Returns number of instructions that was passed to callback.
+//----------------------------------------------------------------------
+int translate_block_cb(VexArch guest,
+                       unsigned char *insn_start,
+                       unsigned int insn_addr,
+                       int max_insns,
+                       asmir_irsb_cb_t cb,
+                       void *param)
+{
+    asmir_ctx_t *ctx = asmir_ctx_get();
+
+    assert(cb);
+    assert(max_insns > 0 && max_insns < ASMIR_BLOCK_MAX_INSNS);
+
+    if (guest != VexArchX86 && guest != VexArchARM)
+    {
+        // we don't know how to optimize IR of other guests
+        max_insns = 1;
     }
 
-    return irbb_current;
+    // guest_arch is also used by block_split()
+    ctx->guest_arch = guest;
+
+    ctx->irsb_cb = cb;
+    ctx->irsb_cb_param = param;
+    ctx->irsb_keep = 0;
+    ctx->block_max = max_insns;
+
+    translate_vex(ctx, guest, insn_start, insn_addr);
+
+    return ctx->block_insns;
 }
 
+//----------------------------------------------------------------------
+// Translate 1 instruction to VEX IR.
+//----------------------------------------------------------------------
+IRSB *translate_insn(VexArch guest,
+                     unsigned char *insn_start,
+                     unsigned int insn_addr,
+                     int *insn_size)
+{
+    IRSB *irbb = translate_insn_cb(guest, insn_start, insn_addr, insn_size, NULL, NULL, 1);
+
+    assert(irbb);
+
+    return irbb;
+}
@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "vexmem.h"
+#include "context.h"
 
 #include "config.h"
 #if VEX_VERSION >= 1793
@@ -69,9 +70,15 @@ void vx_panic(HChar *str)
 //======================================================================
 
 //
-// Currently 256 MB
+// Size of the first arena chunk, next chunks are growing twice up to
+// the maximum size (or to the size of allocation if it's bigger).
 //
-#define HUGE_BLOCK_SIZE (1 << 28)
+#define VX_CHUNK_SIZE_MIN (1 << 16)
+#define VX_CHUNK_SIZE_MAX (1 << 24)
+
+#define VX_ALIGN(_n_) (((_n_) + 7) & ~7)
+
+#define VX_CHUNK_DATA(_chunk_) ((unsigned char *)(_chunk_) + sizeof(vx_chunk_t))
 
 //
 // Note:
@@ -83,31 +90,146 @@ void vx_panic(HChar *str)
 // use it.
 //
 // To avoid having to write matching destructors for every constructor
-// (and there are a lot of them), we use a huge block of static memory
-// for all allocations, and then free the entire block all at once when
-// we're done with the IRSB. (Arena allocation style)
+// (and there are a lot of them), we use an arena for all allocations,
+// and then free the entire arena all at once when we're done with the
+// IRSB. (Arena allocation style)
 //
-// TODO: Allocate this from the heap so that we can grow it at run time
-//       if needed.
-unsigned char huge_block[ HUGE_BLOCK_SIZE ];
-unsigned char *next_free = huge_block;
+// Each translation context has its own arena that consists of the list
+// of chunks allocated from the heap. Arena grows on demand and keeps
+// its chunks after vx_FreeAll(), so, usually there's no heap calls at
+// all once the arena has warmed up.
+//
+void vx_arena_init(vx_arena_t *arena)
+{
+    memset(arena, 0, sizeof(vx_arena_t));
+}
+
+static void vx_arena_release(vx_arena_t *arena, vx_chunk_t *chunk)
+{
+    while (chunk)
+    {
+        vx_chunk_t *next = chunk->next;
+
+        arena->size -= chunk->size;
+        free(chunk);
+
+        chunk = next;
+    }
+}
+
+void vx_arena_free(vx_arena_t *arena)
+{
+    vx_arena_release(arena, arena->chunks);
+    vx_arena_init(arena);
+}
+
+static void vx_arena_use(vx_arena_t *arena, vx_chunk_t *chunk)
+{
+    arena->current = chunk;
+    arena->next_free = VX_CHUNK_DATA(chunk);
+    arena->end = arena->next_free + chunk->size;
+}
+
+static vx_chunk_t *vx_arena_grow(vx_arena_t *arena, size_t nbytes)
+{
+    size_t size = VX_CHUNK_SIZE_MIN;
+
+    if (arena->current)
+    {
+        size = arena->current->size * 2;
+
+        if (size > VX_CHUNK_SIZE_MAX)
+        {
+            size = VX_CHUNK_SIZE_MAX;
+        }
+    }
+
+    if (size < nbytes)
+    {
+        size = nbytes;
+    }
+
+    vx_chunk_t *chunk = (vx_chunk_t *)malloc(sizeof(vx_chunk_t) + size);
+    if (chunk == NULL)
+    {
+        vx_panic("vx_Alloc(): out of memory");
+    }
+
+    chunk->size = size;
+    chunk->next = NULL;
+
+    if (arena->current)
+    {
+        // insert new chunk after the current one
+        chunk->next = arena->current->next;
+        arena->current->next = chunk;
+    }
+    else
+    {
+        arena->chunks = chunk;
+    }
+
+    arena->size += size;
+
+    return chunk;
+}
 
 void *vx_Alloc(Int nbytes)
 {
+    vx_arena_t *arena = &asmir_ctx_get()->arena;
+
     assert(nbytes > 0);
 
-    void *this_block = next_free;
+    size_t size = VX_ALIGN(nbytes);
+
+    if (arena->current == NULL || arena->next_free + size > arena->end)
+    {
+        vx_chunk_t *chunk = arena->current ? arena->current->next : arena->chunks;
+
+        if (chunk == NULL || chunk->size < size)
+        {
+            // there's no free chunk that is big enough
+            chunk = vx_arena_grow(arena, size);
+        }
+
+        vx_arena_use(arena, chunk);
+    }
 
-    next_free += nbytes;
+    void *this_block = arena->next_free;
 
-    assert(next_free < huge_block + HUGE_BLOCK_SIZE);
+    arena->next_free += size;
+    arena->used += size;
 
     return this_block;
 }
 
 void vx_FreeAll()
 {
-    next_free = huge_block;
+    vx_arena_t *arena = &asmir_ctx_get()->arena;
+
+    // remember peak usage of the last translation
+    arena->peak_last = arena->used;
+
+    if (arena->used > arena->peak)
+    {
+        arena->peak = arena->used;
+    }
+
+    arena->used = 0;
+
+    if (arena->chunks == NULL)
+    {
+        return;
+    }
+
+    if (arena->release_size > 0 && arena->size > arena->release_size)
+    {
+        // give the memory back, only the first chunk is kept
+        vx_arena_release(arena, arena->chunks->next);
+        arena->chunks->next = NULL;
+    }
+
+    vx_arena_use(arena, arena->chunks);
 }
 
 //======================================================================
@@ -302,10 +424,8 @@ IRDirty *vx_emptyIRDirty(void)
 /* Constructors -- IRStmt */
 IRStmt *vx_IRStmt_NoOp(void)
 {
-    /* Just use a single static closure. */
-    static IRStmt static_closure;
-
-    static_closure.tag = Ist_NoOp;
+    /* Just use a single static closure, it's never modified. */
+    static IRStmt static_closure = { Ist_NoOp };
 
     return &static_closure;
 }
@@ -393,10 +513,8 @@ IRStmt *vx_IRStmt_Dirty(IRDirty *d)
 
 IRStmt *vx_IRStmt_MFence(void)
 {
-    /* Just use a single static closure. */
-    static IRStmt static_closure;
-
-    static_closure.tag = Ist_MFence;
+    /* Just use a single static closure, it's never modified. */
+    static IRStmt static_closure = { Ist_MFence };
 
     return &static_closure;
 }
@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <string>
+
+#include "libopenreil.h"
+
+using namespace std;
+
+#define DEF_THREADS 4
+#define DEF_ROUNDS 2
+
+#define IMAGE_SCN_MEM_EXECUTE 0x20000000
+
+// code section of the test binary
+static uint8_t *code_data = NULL;
+static int code_size = 0;
+static reil_addr_t code_addr = 0;
+
+// output of the single threaded translation
+static string code_reference;
+static int rounds = DEF_ROUNDS;
+
+typedef struct _test_thread
+{
+    pthread_t thread;
+    int flags;
+    int rounds_ok;
+
+} test_thread;
+
+//======================================================================
+//
+// PE image loading
+//
+//======================================================================
+
+static uint32_t read_dword(uint8_t *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+}
+
+static uint16_t read_word(uint8_t *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+static uint8_t *load_file(const char *path, long *size)
+{
+    FILE *fd = fopen(path, "rb");
+    if (fd == NULL)
+    {
+        return NULL;
+    }
+
+    fseek(fd, 0, SEEK_END);
+    *size = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+
+    if (*size < 0)
+    {
+        fclose(fd);
+        return NULL;
+    }
+
+    uint8_t *data = (uint8_t *)malloc(*size);
+    if (data)
+    {
+        if (fread(data, 1, *size, fd) != (size_t)*size)
+        {
+            free(data);
+            data = NULL;
+        }
+    }
+
+    fclose(fd);
+    return data;
+}
+
+static bool load_code(const char *path)
+{
+    long size = 0;
+    uint8_t *data = load_file(path, &size);
+    if (data == NULL)
+    {
+        printf("ERROR: Unable to read %s\n", path);
+        return false;
+    }
+
+    if (size < 0x40 || read_word(data) != 0x5a4d /* MZ */)
+    {
+        goto _bad_image;
+    }
+
+    {
+        uint32_t pe = read_dword(data + 0x3c);
+        if (pe + 0x18 > size || read_dword(data + pe) != 0x4550 /* PE */)
+        {
+            goto _bad_image;
+        }
+
+        uint16_t sections_num = read_word(data + pe + 0x06);
+        uint16_t optional_size = read_word(data + pe + 0x14);
+        uint32_t image_base = read_dword(data + pe + 0x18 + 0x1c);
+        uint8_t *section = data + pe + 0x18 + optional_size;
+
+        for (int i = 0; i < sections_num; i++, section += 0x28)
+        {
+            if (section + 0x28 > data + size)
+            {
+                break;
+            }
+
+            uint32_t virtual_size = read_dword(section + 0x08);
+            uint32_t virtual_addr = read_dword(section + 0x0c);
+            uint32_t raw_size = read_dword(section + 0x10);
+            uint32_t raw_addr = read_dword(section + 0x14);
+            uint32_t characteristics = read_dword(section + 0x24);
+
+            if (!(characteristics & IMAGE_SCN_MEM_EXECUTE) ||
+                raw_addr + raw_size > size)
+            {
+                continue;
+            }
+
+            // use the first executable section
+            code_size = virtual_size < raw_size ? virtual_size : raw_size;
+            code_addr = image_base + virtual_addr;
+            code_data = (uint8_t *)malloc(code_size);
+            assert(code_data);
+
+            memcpy(code_data, data + raw_addr, code_size);
+            free(data);
+
+            return true;
+        }
+    }
+
+_bad_image:
+
+    printf("ERROR: %s is not a valid PE image\n", path);
+    free(data);
+
+    return false;
+}
+
+//======================================================================
+//
+// Translation
+//
+//======================================================================
+
+static void dump_arg(string &out, reil_arg_t *arg)
+{
+    char buff[0x40];
+
+    switch (arg->type)
+    {
+    case A_NONE:
+
+        snprintf(buff, sizeof(buff), " -");
+        break;
+
+    case A_CONST:
+
+        snprintf(buff, sizeof(buff), " %d:%llx", arg->size, arg->val);
+        break;
+
+    case A_REG:
+
+        // register ID must match register name
+        assert(arg->reg == reil_reg_by_name(ARCH_X86, arg->name));
+
+        snprintf(buff, sizeof(buff), " %d:%d:%s:%d", arg->type, arg->size, arg->name, arg->reg);
+        break;
+
+    default:
+
+        snprintf(buff, sizeof(buff), " %d:%d:%s", arg->type, arg->size, arg->name);
+        break;
+    }
+
+    out += buff;
+}
+
+static int inst_handler(reil_inst_t *inst, void *context)
+{
+    string *out = (string *)context;
+    char buff[0x40];
+
+    snprintf(
+        buff, sizeof(buff), "%llx.%d %d %llx",
+        inst->raw_info.addr, inst->inum, inst->op, inst->flags
+    );
+
+    *out += buff;
+
+    dump_arg(*out, &inst->a);
+    dump_arg(*out, &inst->b);
+    dump_arg(*out, &inst->c);
+
+    if (inst->inum == 0)
+    {
+        *out += " ; ";
+        *out += inst->raw_info.str_mnem;
+        *out += " ";
+        *out += inst->raw_info.str_op;
+    }
+
+    *out += "\n";
+
+    return 0;
+}
+
+static int translate_code(string &out, int flags)
+{
+    reil_t reil = reil_init_ex(ARCH_X86, inst_handler, &out, flags);
+    if (reil == NULL)
+    {
+        return REIL_ERROR;
+    }
+
+    int ret = reil_translate(reil, code_addr, code_data, code_size);
+
+    reil_close(reil);
+
+    return ret;
+}
+
+static int test_parallel(int threads_num)
+{
+    string out;
+    reil_t reil = reil_init(ARCH_X86, inst_handler, &out);
+    if (reil == NULL)
+    {
+        return -1;
+    }
+
+    int ret = reil_translate_parallel(reil, code_addr, code_data, code_size, threads_num, NULL, NULL);
+    if (ret != REIL_ERROR)
+    {
+        reil_worker_stats_t *stats = new reil_worker_stats_t[threads_num];
+        int stats_num = reil_parallel_stats(reil, stats, threads_num);
+
+        for (int i = 0; i < stats_num && i < threads_num; i++)
+        {
+            printf(
+                "Worker %d: %d chunks (%d stolen), %d instructions, %d bytes, %d IR instructions, %llu ms\n",
+                i, stats[i].chunks, stats[i].chunks_stolen, stats[i].insts, stats[i].bytes, 
+                stats[i].reil_insts, stats[i].time / 1000
+            );
+        }
+
+        delete[] stats;
+    }
+
+    reil_close(reil);
+
+    return (ret == REIL_ERROR || out != code_reference) ? -1 : 0;
+}
+
+static void *test_thread_proc(void *param)
+{
+    test_thread *t = (test_thread *)param;
+
+    for (int i = 0; i < rounds; i++)
+    {
+        string out;
+
+        // translation cache is enabled by default
+        if (translate_code(out, t->flags) == REIL_ERROR || out != code_reference)
+        {
+            break;
+        }
+
+        t->rounds_ok += 1;
+    }
+
+    return NULL;
+}
+
+//======================================================================
+//
+// Main
+//
+//======================================================================
+
+int main(int argc, char *argv[])
+{
+    int threads_num = DEF_THREADS, failed = 0;
+
+    if (argc < 2)
+    {
+        printf("USAGE: test-threads file.exe [threads] [rounds]\n");
+        return 0;
+    }
+
+    if (argc >= 3)
+    {
+        threads_num = atoi(argv[2]);
+    }
+
+    if (argc >= 4)
+    {
+        rounds = atoi(argv[3]);
+    }
+
+    if (threads_num <= 0 || rounds <= 0)
+    {
+        printf("ERROR: Invalid arguments\n");
+        return -1;
+    }
+
+    if (!load_code(argv[1]))
+    {
+        return -1;
+    }
+
+    // translate the code in main thread without cache to get reference output
+    if (translate_code(code_reference, REIL_FLAG_NO_CACHE) == REIL_ERROR)
+    {
+        printf("ERROR: Single threaded translation failed\n");
+        return -1;
+    }
+
+    printf(
+        "%s: 0x%x bytes of code at 0x%llx, %d threads, %d rounds\n",
+        argv[1], code_size, code_addr, threads_num, rounds
+    );
+
+    test_thread *threads = new test_thread[threads_num];
+
+    for (int i = 0; i < threads_num; i++)
+    {
+        threads[i].rounds_ok = 0;
+
+        // odd threads are using superblock translation mode
+        threads[i].flags = (i & 1) ? REIL_FLAG_BLOCK : 0;
+
+        if (pthread_create(&threads[i].thread, NULL, test_thread_proc, &threads[i]) != 0)
+        {
+            printf("ERROR: pthread_create() fails\n");
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < threads_num; i++)
+    {
+        pthread_join(threads[i].thread, NULL);
+
+        if (threads[i].rounds_ok != rounds)
+        {
+            printf("Thread %d: output mismatch at round %d\n", i, threads[i].rounds_ok);
+            failed += 1;
+        }
+    }
+
+    // translate the code using worker pool of reil_translate_parallel()
+    if (test_parallel(threads_num) != 0)
+    {
+        printf("reil_translate_parallel(): output mismatch\n");
+        failed += 1;
+    }
+
+    printf(failed ? "FAILED\n" : "OK\n");
+
+    delete[] threads;
+    free(code_data);
+
+    return failed ? -1 : 0;
+}
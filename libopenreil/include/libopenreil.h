@@ -9,10 +9,291 @@
 
 #define REIL_ERROR -1
 
+// translator flags for reil_init_ex()
+#define REIL_FLAG_NO_CACHE  0x00000001  // don't use translation cache
+#define REIL_FLAG_RELEASE   0x00000002  // give unused VEX IR memory back to the OS
+#define REIL_FLAG_DIRECT    0x00000004  // generate BAP IR without copying of VEX IR
+#define REIL_FLAG_BLOCK     0x00000008  // translate basic block with one VEX call
+#define REIL_FLAG_OPTIMIZE  0x00000010  // optimize IR code of each machine instruction
+#define REIL_FLAG_DEAD_EFLAGS 0x00000020  // remove EFLAGS computations that are never used
+
+//
+// REIL_FLAG_DEAD_EFLAGS is supported only for ARCH_X86, reil_init_ex() returns NULL
+// for other architectures. It takes effect only when several machine instructions
+// are translated with one call: reil_translate(), reil_translate_batch(),
+// reil_translate_func() and reil_translate_parallel() (within chunk boundaries).
+// reil_translate_insn() and Translator.to_reil() in Python are processing one
+// instruction at time, flags are always live after it, so, the flag is ignored there.
+//
+
 typedef void * reil_t;
 typedef enum _reil_arch_t { ARCH_X86 } reil_arch_t;
 typedef int (* reil_inst_handler_t)(reil_inst_t *inst, void *context);
 
+typedef struct _reil_batch_insn_t
+{
+    reil_addr_t addr;   // address of the machine instruction
+    int size;           // .. and it's size
+
+    int first;          // index of the first IR instruction in reil_batch_t.insts
+    int count;          // number of IR instructions
+
+} reil_batch_insn_t;
+
+typedef struct _reil_batch_t
+{
+    // caller-owned IR instructions buffer
+    reil_inst_t *insts;
+    int insts_max;
+
+    // caller-owned machine instructions index
+    reil_batch_insn_t *index;
+    int index_max;
+
+    // filled by reil_translate_batch()
+    int insts_count;
+    int index_count;
+    int translated;     // number of input bytes that was translated
+
+} reil_batch_t;
+
+//
+// Called by reil_translate_func() to read machine code, handler must return 
+// the number of bytes that was copied into the buffer or -1 on error.
+//
+typedef int (* reil_reader_t)(reil_addr_t addr, unsigned char *buff, int size, void *context);
+
+typedef struct _reil_func_bb_t
+{
+    reil_addr_t addr;   // IR address of the first instruction of basic block
+    reil_inum_t inum;
+
+    int first;          // index of the first IR instruction in reil_func_t.insts
+    int count;          // number of IR instructions
+
+    int succ;           // index of the first successor in reil_func_t.succ
+    int succ_count;     // number of successors
+
+} reil_func_bb_t;
+
+typedef struct _reil_func_t
+{
+    // IR code of all basic blocks sorted by IR address
+    reil_inst_t *insts;
+    int insts_count;
+
+    // basic blocks sorted by IR address
+    reil_func_bb_t *bbs;
+    int bbs_count;
+    int entry;              // index of the function entry basic block
+
+    // successors of the basic blocks as indexes in bbs array
+    int *succ;
+    int succ_count;
+
+    reil_addr_t error_addr; // instruction that can't be read or translated
+
+} reil_func_t;
+
+typedef void * reil_dfg_t;
+
+// special IR instruction indexes of reil_dfg_edge_t
+#define REIL_DFG_ENTRY      -1  // value that variable had at the function entry
+#define REIL_DFG_EXIT       -1  // value that variable has at the function exit
+
+typedef struct _reil_dfg_edge_t
+{
+    int def_inst;   // index of IR instruction in reil_func_t.insts that defines the variable
+    int use_inst;   // .. and index of IR instruction that uses this definition
+    int var;        // variable index, see reil_dfg_var_name()
+
+} reil_dfg_edge_t;
+
+typedef void * reil_ssa_t;
+
+// special SSA versions
+#define REIL_SSA_ENTRY      0   // value that variable had at the function entry
+#define REIL_SSA_NONE       -1  // basic block is not reachable from the function entry
+
+// argument of reil_ssa_ref_t
+#define REIL_SSA_ARG_A      0
+#define REIL_SSA_ARG_B      1
+#define REIL_SSA_ARG_C      2
+#define REIL_SSA_ARG_CALL   -1  // register that is used or defined by the called function
+
+typedef struct _reil_ssa_ref_t
+{
+    int var;        // variable index, see reil_ssa_var_name()
+    int version;    // variable version
+    int arg;        // instruction argument, REIL_SSA_ARG_*
+
+} reil_ssa_ref_t;
+
+typedef struct _reil_ssa_inst_t
+{
+    // uses and definitions of the IR instruction as ranges of reil_ssa_func_t.refs
+    int uses;
+    int uses_count;
+    int defs;
+    int defs_count;
+
+} reil_ssa_inst_t;
+
+typedef struct _reil_ssa_phi_t
+{
+    int bb;         // index of basic block in reil_func_t.bbs
+    int var;        // variable index
+    int version;    // version that is defined by phi function
+
+    // one argument for each predecessor as range of reil_ssa_func_t.phi_args
+    int args;
+    int args_count;
+
+} reil_ssa_phi_t;
+
+typedef struct _reil_ssa_phi_arg_t
+{
+    int bb;         // predecessor basic block, -1 for the function entry
+    int version;    // version of the variable at the end of predecessor
+
+} reil_ssa_phi_arg_t;
+
+typedef struct _reil_ssa_func_t
+{
+    // one entry for each instruction of reil_func_t.insts
+    reil_ssa_inst_t *insts;
+    int insts_count;
+
+    reil_ssa_ref_t *refs;
+    int refs_count;
+
+    // phi functions sorted by basic block
+    reil_ssa_phi_t *phis;
+    int phis_count;
+
+    reil_ssa_phi_arg_t *phi_args;
+    int phi_args_count;
+
+    // immediate dominator of each basic block, -1 for entry and unreachable blocks
+    int *idom;
+
+    // number of versions of each variable including REIL_SSA_ENTRY
+    int *versions;
+    int vars_count;
+
+} reil_ssa_func_t;
+
+typedef void * reil_dom_t;
+
+typedef struct _reil_loop_t
+{
+    int header;     // index of loop header in reil_func_t.bbs
+    int parent;     // index of the enclosing loop, -1 for outermost loops
+    int depth;      // loop nesting depth, 1 for outermost loops
+
+    // basic blocks of the loop and its nested loops as range of reil_dom_func_t.loop_bbs
+    int bbs;
+    int bbs_count;
+
+} reil_loop_t;
+
+typedef struct _reil_dom_func_t
+{
+    // immediate dominator of each basic block, -1 for entry and unreachable blocks
+    int *idom;
+
+    // immediate post-dominator of each basic block, -1 if it's post-dominated 
+    // only by the function exit or if the function exit can't be reached
+    int *ipdom;
+
+    // natural loops, enclosing loops are going before nested ones
+    reil_loop_t *loops;
+    int loops_count;
+
+    int *loop_bbs;
+    int loop_bbs_count;
+
+    // innermost loop of each basic block, -1 if it's not a part of any loop
+    int *bb_loop;
+
+} reil_dom_func_t;
+
+typedef struct _reil_stats_t
+{
+    // translation cache statistics
+    unsigned long long cache_hits;      // instructions that was replayed from the cache
+    unsigned long long cache_misses;    // .. and that was translated from scratch
+    int cache_entries;                  // number of machine instructions in the cache
+    int cache_uncacheable;              // .. and how many of them can't be replayed
+
+    // VEX IR memory arena statistics (in bytes)
+    unsigned long long arena_last;      // peak usage during the last instruction translation
+    unsigned long long arena_peak;      // max. peak usage per instruction
+    unsigned long long arena_size;      // currently allocated memory
+
+    // REIL_FLAG_OPTIMIZE statistics
+    unsigned long long opt_removed;     // number of IR instructions that was removed
+
+    // REIL_FLAG_DEAD_EFLAGS statistics
+    unsigned long long eflags_removed;  // number of IR instructions that was removed
+
+    // on-disk translation cache statistics
+    unsigned long long disk_hits;       // instructions that was loaded from the on-disk cache
+    unsigned long long disk_stores;     // .. and that was saved into it
+
+} reil_stats_t;
+
+typedef struct _reil_reg_info_t
+{
+    reil_reg_t reg;
+    const char *name;   // register name as in reil_arg_t.name
+    reil_size_t size;
+
+    reil_reg_t parent;  // full-width register that holds this one
+    int offset;         // .. and bit offset of the value inside of it
+
+} reil_reg_info_t;
+
+typedef void * reil_vm_t;
+typedef void * reil_vm_snapshot_t;
+
+// interpreter flags for reil_vm_init()
+#define REIL_VM_FLAG_STRICT 0x00000001  // don't allow writes to the memory that wasn't allocated
+#define REIL_VM_FLAG_JIT    0x00000002  // compile basic blocks into the host code (x86_64 only)
+
+// reasons of reil_vm_run() exit
+#define REIL_VM_NO_CODE     0   // IR code for the address wasn't added with reil_vm_code()
+#define REIL_VM_STOP        1   // breakpoint was reached
+#define REIL_VM_MEM_READ    2   // access to the memory that wasn't allocated
+#define REIL_VM_MEM_WRITE   3
+#define REIL_VM_INVALID     4   // unknown or invalid IR instruction
+
+typedef struct _reil_vm_exit_t
+{
+    int reason;             // REIL_VM_* code
+    reil_addr_t addr;       // IR address of the instruction where execution stopped
+    reil_inum_t inum;       // .. or address of the missing code for REIL_VM_NO_CODE
+    reil_addr_t mem_addr;   // memory address for REIL_VM_MEM_READ and REIL_VM_MEM_WRITE
+
+} reil_vm_exit_t;
+
+//
+// Called when VM accesses the memory that wasn't allocated, handler must fill
+// the buffer and return 0 if it knows the contents of this memory.
+//
+typedef int (* reil_vm_mem_handler_t)(reil_addr_t addr, int size, unsigned char *buff, void *context);
+
+typedef struct _reil_worker_stats_t
+{
+    int chunks;                 // number of translated chunks
+    int chunks_stolen;          // .. and how many of them was stolen from other workers
+    int insts;                  // number of translated machine instructions
+    int bytes;                  // .. and their total size
+    int reil_insts;             // number of generated IR instructions
+    unsigned long long time;    // time spent in translation (in microseconds)
+
+} reil_worker_stats_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -20,10 +301,87 @@ extern "C" {
 void reil_inst_print(reil_inst_t *inst);
 
 reil_t reil_init(reil_arch_t arch, reil_inst_handler_t handler, void *context);
+reil_t reil_init_ex(reil_arch_t arch, reil_inst_handler_t handler, void *context, int flags);
 void reil_close(reil_t reil);
 
 int reil_translate(reil_t reil, reil_addr_t addr, unsigned char *buff, int len);
 int reil_translate_insn(reil_t reil, reil_addr_t addr, unsigned char *buff, int len);
+int reil_translate_batch(reil_t reil, reil_addr_t addr, unsigned char *buff, int len, reil_batch_t *batch);
+
+// VEX part of the translation is serialized between the worker threads, so, it doesn't scale linearly
+int reil_translate_parallel(reil_t reil, reil_addr_t addr, unsigned char *buff, int len, int threads,
+                            reil_inst_handler_t handler, void *context);
+
+int reil_translate_func(reil_t reil, reil_addr_t addr, reil_reader_t reader, void *context, reil_func_t *func);
+int reil_parallel_stats(reil_t reil, reil_worker_stats_t *stats, int stats_max);
+void reil_get_stats(reil_t reil, reil_stats_t *stats);
+
+int reil_set_disk_cache(reil_t reil, const char *path, unsigned long long max_size);
+
+// register IDs are in range 1 .. reil_reg_count() - 1
+int reil_reg_count(reil_arch_t arch);
+const reil_reg_info_t *reil_reg_info(reil_arch_t arch, reil_reg_t reg);
+reil_reg_t reil_reg_by_name(reil_arch_t arch, const char *name);
+
+// native REIL interpreter
+reil_vm_t reil_vm_init(reil_arch_t arch, reil_vm_mem_handler_t handler, void *context, int flags);
+void reil_vm_close(reil_vm_t vm);
+
+// add IR code of the machine instruction, address is taken from raw_info
+int reil_vm_code(reil_vm_t vm, reil_inst_t *insts, int count);
+void reil_vm_code_clear(reil_vm_t vm);
+
+void reil_vm_break(reil_vm_t vm, reil_addr_t addr, reil_inum_t inum);
+void reil_vm_break_clear(reil_vm_t vm);
+
+// run the code until breakpoint, error or missing code
+int reil_vm_run(reil_vm_t vm, reil_addr_t addr, reil_vm_exit_t *exit);
+
+// VM registers (including temp registers) are identified by index
+int reil_vm_reg(reil_vm_t vm, const char *name, reil_size_t size);
+int reil_vm_reg_count(reil_vm_t vm);
+const char *reil_vm_reg_name(reil_vm_t vm, int reg);
+reil_size_t reil_vm_reg_size(reil_vm_t vm, int reg);
+reil_const_t reil_vm_get(reil_vm_t vm, int reg);
+void reil_vm_set(reil_vm_t vm, int reg, reil_const_t val);
+
+// VM memory, functions return REIL_ERROR for memory that wasn't allocated
+void reil_vm_mem_alloc(reil_vm_t vm, reil_addr_t addr, int size, unsigned char *data);
+int reil_vm_mem_read(reil_vm_t vm, reil_addr_t addr, int size, unsigned char *buff);
+int reil_vm_mem_write(reil_vm_t vm, reil_addr_t addr, int size, unsigned char *buff);
+void reil_vm_mem_clear(reil_vm_t vm);
+
+// copy-on-write snapshots of VM registers and memory, must be freed before reil_vm_close()
+reil_vm_snapshot_t reil_vm_snapshot(reil_vm_t vm);
+void reil_vm_restore(reil_vm_t vm, reil_vm_snapshot_t snap);
+void reil_vm_snapshot_free(reil_vm_t vm, reil_vm_snapshot_t snap);
+
+// reaching definitions analysis for function that was returned by reil_translate_func()
+reil_dfg_t reil_dfg_init(reil_arch_t arch);
+void reil_dfg_close(reil_dfg_t dfg);
+
+// returns number of def-use edges, they are valid until the next reil_dfg_build() call
+int reil_dfg_build(reil_dfg_t dfg, reil_func_t *func, reil_dfg_edge_t **edges);
+
+// A_REG and A_TEMP variables are identified by index
+int reil_dfg_var_count(reil_dfg_t dfg);
+const char *reil_dfg_var_name(reil_dfg_t dfg, int var);
+
+// SSA form of the function that was returned by reil_translate_func()
+reil_ssa_t reil_ssa_init(reil_arch_t arch);
+void reil_ssa_close(reil_ssa_t ssa);
+
+// returns REIL_ERROR for function without basic blocks, returned arrays are valid until the next reil_ssa_build() call
+int reil_ssa_build(reil_ssa_t ssa, reil_func_t *func, reil_ssa_func_t *ssa_func);
+const char *reil_ssa_var_name(reil_ssa_t ssa, int var);
+
+// dominator and post-dominator trees and natural loops of function CFG,
+// only bbs, succ and entry fields of reil_func_t are used
+reil_dom_t reil_dom_init(void);
+void reil_dom_close(reil_dom_t dom);
+
+// returns REIL_ERROR for function without basic blocks, returned arrays are valid until the next reil_dom_build() call
+int reil_dom_build(reil_dom_t dom, reil_func_t *func, reil_dom_func_t *dom_func);
 
 #ifdef __cplusplus
 }
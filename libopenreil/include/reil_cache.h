@@ -0,0 +1,66 @@
+#ifndef REIL_CACHE_H
+#define REIL_CACHE_H
+
+// default max. size of the on-disk translation cache (in bytes)
+#define REIL_DISK_CACHE_DEF_SIZE (256 * 1024 * 1024)
+
+// how much data must be written before the next cache size check (as fraction of max. size)
+#define REIL_DISK_CACHE_CHECK_DIV 16
+
+// eviction removes the oldest entries until cache size is below this fraction of max. size
+#define REIL_DISK_CACHE_KEEP_NUM 3
+#define REIL_DISK_CACHE_KEEP_DIV 4
+
+// update modification time of the used entry if it's older than that (in seconds)
+#define REIL_DISK_CACHE_TOUCH_TIME 3600
+
+// temp files of crashed writers are removed after that (in seconds)
+#define REIL_DISK_CACHE_TEMP_TIME 600
+
+#define REIL_DISK_CACHE_MAGIC 0x31434452 // "RDC1"
+
+// header of the cache entry file
+typedef struct _reil_disk_cache_hdr
+{
+    uint32_t magic;
+    uint32_t key_size;          // size of the key that follows the header
+    uint32_t insts_count;       // number of reil_inst_t records that follows the key
+    uint32_t checksum;          // checksum of the key, records and relocations
+    uint64_t addr;              // address of the instruction when it was translated
+
+} reil_disk_cache_hdr;
+
+//
+// Persistent translation cache that can be shared between processes. Each
+// entry is stored in separate file with name that derived from the key hash,
+// new files are written under temp name and renamed when they are complete,
+// so, readers never see partially written entries and don't need any locks.
+//
+class CReilDiskCache
+{
+public:
+
+    CReilDiskCache(const char *path, unsigned long long max_size = 0);
+
+    // returns false if cache directory can't be used
+    bool check(void);
+
+    bool load(string &key, reil_addr_t *addr, vector<reil_inst_t> &insts, vector<uint8_t> &relocs);
+    void store(string &key, reil_addr_t addr, vector<reil_inst_t> &insts, vector<uint8_t> &relocs);
+
+    // remove the least recently used entries when cache is too large
+    void evict(void);
+
+    string path;
+    unsigned long long max_size;
+
+private:
+
+    string entry_path(string &key, string &dir);
+
+    // number of bytes that was written since the last size check
+    unsigned long long written;
+    unsigned int temp_count;
+};
+
+#endif // REIL_CACHE_H
@@ -0,0 +1,74 @@
+#ifndef REIL_DFG_H
+#define REIL_DFG_H
+
+// dense bitset word
+typedef uint64_t reil_dfg_word;
+
+#define REIL_DFG_WORD_BITS 64
+
+// registers that are used and defined by the function call, terminated by REIL_REG_NONE
+extern const reil_reg_t reil_dfg_call_regs_x86[];
+
+//
+// Reaching definitions analysis over the function CFG. Definition sites of
+// each variable are occupying contiguous range of bits in the dense bitsets,
+// the first bit of the range stands for the value that variable had at the
+// function entry.
+//
+class CReilDataFlow
+{
+public:
+
+    CReilDataFlow(reil_arch_t arch);
+
+    // returns number of def-use edges
+    int build(reil_func_t *func);
+
+    const char *var_name(int var) { return vars[var].c_str(); }
+    int var_count(void) { return vars.size(); }
+
+    vector<reil_dfg_edge_t> edges;
+
+private:
+
+    int var_index(const char *name);
+
+    void collect(reil_func_t *func);
+    void order(reil_func_t *func);
+    void solve(reil_func_t *func);
+    void emit(reil_func_t *func);
+
+    void block_in(reil_func_t *func, int bb, reil_dfg_word *in);
+    void add_edge(int def_inst, int use_inst, int var);
+
+    reil_arch_t arch;
+
+    // variable names, registers and temp registers are identified by name
+    vector<string> vars;
+    map<string, int> vars_index;
+
+    // registers that are used and defined by the function call
+    vector<int> call_vars;
+
+    // variables that are used and defined by each IR instruction
+    vector<int> uses_first, uses;
+    vector<int> defs_first, defs, defs_bit;
+
+    // first bit of each variable definition sites range
+    vector<int> var_bits;
+
+    // IR instruction of each definition site, REIL_DFG_ENTRY for the first bit of range
+    vector<int> bit_inst;
+
+    // predecessors of basic blocks
+    vector<int> preds_first, preds;
+
+    // reverse postorder of the basic blocks reachable from entry
+    vector<int> rpo, rpo_index;
+
+    // definitions that reach the end of each basic block
+    vector<reil_dfg_word> out;
+    int words;
+};
+
+#endif // REIL_DFG_H
@@ -0,0 +1,82 @@
+#ifndef REIL_DOM_H
+#define REIL_DOM_H
+
+// group ( key, item ) pairs by key into CSR arrays, order of items is preserved
+void reil_dom_group(int keys_count, vector<pair<int, int> > &pairs, vector<int> &first, vector<int> &items);
+
+//
+// Dominator tree of the directed graph that is stored in CSR form, it's
+// computed with Lengauer-Tarjan algorithm (simple version with path
+// compression) that scales well for any shape of the graph.
+//
+class CReilDominators
+{
+public:
+
+    // returns number of nodes reachable from entry
+    int build(int nodes_count, int entry, const int *succ_first, const int *succ);
+    int build(reil_func_t *func);
+
+    bool reachable(int node) { return rpo_index[node] != -1; }
+
+    // check if node a dominates node b, it's O(1) thanks to dominator tree numbering
+    bool dominates(int a, int b)
+    {
+        return reachable(a) && reachable(b) && pre[a] <= pre[b] && post[b] <= post[a];
+    }
+
+    // reverse postorder of the nodes reachable from entry
+    vector<int> rpo, rpo_index;
+
+    // reachable predecessors of each node, sorted by node index
+    vector<int> preds_first, preds;
+
+    // immediate dominator of each node, -1 for entry and unreachable nodes
+    vector<int> idom;
+
+    // children of each node in dominator tree
+    vector<int> children_first, children;
+
+private:
+
+    void order(int nodes_count, int entry, const int *succ_first, const int *succ);
+    void number(int entry);
+    int eval(int node);
+
+    // DFS preorder and parent of each node in DFS tree
+    vector<int> dfs, dfs_parent;
+
+    // semidominators and path compressed forest
+    vector<int> semi, label, ancestor, path;
+
+    // preorder and postorder numbers of dominator tree nodes
+    vector<int> pre, post;
+};
+
+//
+// Dominators, post-dominators and natural loops of the function CFG.
+//
+class CReilDomInfo
+{
+public:
+
+    void build(reil_func_t *func, reil_dom_func_t *dom_func);
+
+private:
+
+    void post_dominators(reil_func_t *func);
+    void find_loops(reil_func_t *func);
+    int loop_root(int loop);
+
+    CReilDominators dom, pdom;
+
+    vector<int> ipdom;
+
+    vector<reil_loop_t> loops;
+    vector<int> loop_bbs, bb_loop;
+
+    // union-find forest of the loops that were already processed
+    vector<int> loop_link;
+};
+
+#endif // REIL_DOM_H
@@ -52,6 +52,45 @@ typedef unsigned short reil_inum_t;
 
 typedef enum _reil_size_t { U1, U8, U16, U32, U64 } reil_size_t;
 
+typedef unsigned short reil_reg_t;
+
+// not an architecture register or register that has no ID
+#define REIL_REG_NONE 0
+
+typedef enum _reil_x86_reg_t
+{
+    // general purpose registers
+    REIL_X86_EAX = 1, REIL_X86_EBX, REIL_X86_ECX, REIL_X86_EDX, 
+    REIL_X86_ESI, REIL_X86_EDI, REIL_X86_EBP, REIL_X86_ESP, REIL_X86_EIP,
+
+    // half-sized registers
+    REIL_X86_AX, REIL_X86_BX, REIL_X86_CX, REIL_X86_DX, 
+    REIL_X86_SI, REIL_X86_DI, REIL_X86_BP, REIL_X86_SP,
+    REIL_X86_AL, REIL_X86_BL, REIL_X86_CL, REIL_X86_DL,
+    REIL_X86_AH, REIL_X86_BH, REIL_X86_CH, REIL_X86_DH,
+
+    // EFLAGS and it's bits
+    REIL_X86_EFLAGS,
+    REIL_X86_CF, REIL_X86_PF, REIL_X86_AF, REIL_X86_ZF, REIL_X86_SF, REIL_X86_OF,
+    REIL_X86_DFLAG, REIL_X86_IDFLAG, REIL_X86_ACFLAG,
+
+    // VEX flags thunk and emulation warnings
+    REIL_X86_CC_OP, REIL_X86_CC_DEP1, REIL_X86_CC_DEP2, REIL_X86_CC_NDEP,
+    REIL_X86_EMWARN,
+
+    // segment registers and their base addresses
+    REIL_X86_CS, REIL_X86_DS, REIL_X86_ES, REIL_X86_FS, REIL_X86_GS, REIL_X86_SS,
+    REIL_X86_LDT, REIL_X86_GDT,
+    REIL_X86_CS_BASE, REIL_X86_DS_BASE, REIL_X86_ES_BASE, 
+    REIL_X86_FS_BASE, REIL_X86_GS_BASE, REIL_X86_SS_BASE,
+
+    // FPU and SSE control
+    REIL_X86_FTOP, REIL_X86_FPROUND, REIL_X86_FC3210, REIL_X86_SSEROUND,
+
+    REIL_X86_REG_MAX
+
+} reil_x86_reg_t;
+
 typedef struct _reil_arg_t
 {
     reil_type_t type;
@@ -59,6 +98,12 @@ typedef struct _reil_arg_t
     reil_const_t val;    
     char name[REIL_MAX_NAME_LEN];
 
+    // A_REG only: register ID, ID of the full-width register that holds
+    // it and bit offset of the register value inside of the parent
+    reil_reg_t reg;
+    reil_reg_t parent;
+    unsigned char offset;
+
 } reil_arg_t;
 
 typedef struct _reil_raw_t
@@ -0,0 +1,108 @@
+#ifndef REIL_JIT_H
+#define REIL_JIT_H
+
+// JIT compiler supports only x86_64 hosts
+#if defined(__x86_64__) || defined(_M_X64)
+#define REIL_JIT_SUPPORTED
+#endif
+
+// size of the memory region for compiled code
+#define REIL_JIT_CACHE_SIZE (16 * 1024 * 1024)
+
+// max. number of machine instructions in the compiled block
+#define REIL_JIT_MAX_INSNS 0x40
+
+// max. size of compiled code for single IR instruction or block exit
+#define REIL_JIT_MAX_INST_LEN 0x100
+
+//
+// State of the compiled code, pointer to this structure is the only
+// argument of the compiled block.
+//
+typedef struct _reil_jit_ctx
+{
+    reil_const_t *regs;     // VM register file
+
+    // memory access helpers, return zero on error, regs might be changed by them
+    int (* mem_load)(struct _reil_jit_ctx *ctx, reil_addr_t addr, int size, reil_const_t *val);
+    int (* mem_store)(struct _reil_jit_ctx *ctx, reil_addr_t addr, int size, reil_const_t val);
+    void *vm;
+
+    reil_const_t val;       // value for mem_load()
+
+    // filled on exit from the compiled code
+    int reason;             // REIL_VM_NO_CODE when execution must be continued at addr
+    reil_addr_t addr;
+    reil_inum_t inum;
+    reil_addr_t mem_addr;
+
+} reil_jit_ctx;
+
+// common entry point of compiled blocks
+typedef void (* reil_jit_entry_t)(reil_jit_ctx *ctx, void *block);
+
+//
+// Compiles IR code of the sequence of machine instructions into the host
+// code. Blocks are chained directly with each other when target address
+// of the exit is known at compile time.
+//
+class CReilJit
+{
+public:
+
+    CReilJit(size_t size = REIL_JIT_CACHE_SIZE);
+    ~CReilJit();
+
+    bool is_ready(void) { return code != NULL; }
+
+    // check if machine instruction can be compiled
+    static bool can_compile(reil_vm_insn *insn);
+
+    // returns NULL when there's no free space in the code cache
+    void *compile(vector<reil_vm_insn *> &insns, int reg_ip, reil_const_t ip_mask);
+
+    void exec(void *block, reil_jit_ctx *ctx) { ((reil_jit_entry_t)entry)(ctx, block); }
+
+    // unlink compiled block from the other blocks, it will not be executed anymore
+    void invalidate(reil_addr_t addr);
+
+    // remove all of the compiled code
+    void flush(void);
+
+private:
+
+    void emit(uint8_t byte) { *ptr++ = byte; }
+    void emit32(uint32_t val);
+    void emit64(uint64_t val);
+
+    void emit_rex(int reg, int rm, bool wide);
+    void emit_mov_imm(int reg, reil_const_t val);
+    void emit_mov_reg(int dst, int src);
+    void emit_reg_access(uint8_t opcode, int reg, int slot);
+    void emit_ctx_access(uint8_t opcode, int reg, int offset);
+    void emit_ctx_imm32(int offset, uint32_t val);
+    void emit_zero_ext(int reg, int bits);
+    void emit_sign_ext(int reg, int bits);
+    void emit_arg(reil_vm_arg *arg, int reg);
+
+    uint8_t *emit_jcc8(uint8_t opcode);
+    void patch8(uint8_t *pos);
+    void patch32(uint8_t *pos, uint8_t *target);
+
+    void emit_jmp_epilogue(void);
+    void emit_exit(reil_addr_t addr);
+    void emit_fault(reil_vm_insn *insn, reil_vm_inst *inst, int reason);
+    bool emit_inst(reil_vm_insn *insn, reil_vm_inst *inst);
+
+    uint8_t *code, *code_end, *ptr;
+    size_t code_size;
+
+    // entry point and common exit of compiled blocks
+    uint8_t *entry, *epilogue;
+
+    // compiled blocks bodies and exit jumps by guest address
+    map<reil_addr_t, uint8_t *> blocks;
+    multimap<reil_addr_t, uint8_t *> links;
+};
+
+#endif // REIL_JIT_H
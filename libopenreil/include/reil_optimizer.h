@@ -0,0 +1,43 @@
+#ifndef REIL_OPTIMIZER_H
+#define REIL_OPTIMIZER_H
+
+// optimization passes for REIL_FLAG_OPTIMIZE
+#define REIL_PASS_COPY_PROP     0x01    // copy and constant propagation
+#define REIL_PASS_CONST_FOLD    0x02    // constant folding
+#define REIL_PASS_DEAD_TEMP     0x04    // dead temp registers elimination
+#define REIL_PASS_RENUMBER      0x08    // temp registers renumbering
+
+#define REIL_PASS_ALL           0x0f
+
+// max. number of propagation/folding/elimination rounds
+#define REIL_OPT_MAX_ROUNDS 8
+
+//
+// Optimizes IR code of the single machine instruction. Temp registers
+// are local to the machine instruction, so, passes need no information
+// about the rest of the code.
+//
+class CReilOptimizer
+{
+public:
+
+    CReilOptimizer(int passes = REIL_PASS_ALL) : passes(passes) {};
+
+    // returns number of IR instructions that was removed
+    int optimize(vector<reil_inst_t> &insts);
+
+private:
+
+    bool copy_prop(vector<reil_inst_t> &insts);
+    bool const_fold(vector<reil_inst_t> &insts);
+    bool dead_temp(vector<reil_inst_t> &insts);
+    void renumber(vector<reil_inst_t> &insts);
+
+    int passes;
+
+    // temp register number -> value/state, reused between calls
+    vector<reil_arg_t> temp_val;
+    vector<int> temp_state;
+};
+
+#endif // REIL_OPTIMIZER_H
@@ -0,0 +1,58 @@
+#ifndef REIL_SSA_H
+#define REIL_SSA_H
+
+//
+// SSA construction for the function CFG: phi functions are placed at the
+// iterated dominance frontiers of definitions (only for variables that are
+// live across basic blocks), then all of the A_REG and A_TEMP variables are
+// renamed during dominator tree traversal.
+//
+class CReilSSA
+{
+public:
+
+    CReilSSA(reil_arch_t arch);
+
+    void build(reil_func_t *func, reil_ssa_func_t *ssa_func);
+
+    const char *var_name(int var) { return vars[var].c_str(); }
+
+private:
+
+    int var_index(const char *name);
+    void add_ref(reil_arg_t *arg, int arg_num);
+    void add_call_ref(int var);
+
+    void collect(reil_func_t *func);
+    void frontiers(reil_func_t *func);
+    void place(reil_func_t *func);
+    void rename(reil_func_t *func);
+    void rename_block(reil_func_t *func, int bb, vector<pair<int, int> > &undo);
+
+    reil_arch_t arch;
+
+    // variable names, registers and temp registers are identified by name
+    vector<string> vars;
+    map<string, int> vars_index;
+
+    // registers that are used and defined by the function call
+    vector<int> call_vars;
+
+    CReilDominators dom;
+
+    // dominance frontier of each basic block
+    vector<int> df_first, df;
+
+    // phi functions of each basic block
+    vector<int> phis_first;
+
+    // current and the next version of each variable
+    vector<int> top, versions;
+
+    vector<reil_ssa_inst_t> insts;
+    vector<reil_ssa_ref_t> refs;
+    vector<reil_ssa_phi_t> phis;
+    vector<reil_ssa_phi_arg_t> phi_args;
+};
+
+#endif // REIL_SSA_H
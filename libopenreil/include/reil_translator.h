@@ -4,14 +4,18 @@
 
 #define EXPAND_EFLAGS
 
-#define MAX_REG_NAME_LEN 20
-
 string to_string_constant(reil_const_t val, reil_size_t size);
 string to_string_size(reil_size_t size);
 string to_string_operand(reil_arg_t *a);
 string to_string_inst_code(reil_op_t inst_code);
 
-typedef pair<int32_t, string> TEMPREG_BAP;
+typedef pair<int32_t, sym_t> TEMPREG_BAP;
+
+// register ID information by register symbol (reil_regs.cpp)
+const reil_reg_info_t *reil_reg_lookup(VexArch guest, sym_t sym);
+
+class CReilOptimizer;
+class CReilDiskCache;
 
 class CReilTranslatorException
 {
@@ -29,16 +33,16 @@ public:
     ~CReilFromBilTranslator();
 
     void reset_state(bap_block_t *block);    
+    void set_inst_handler(reil_inst_handler_t handler, void *context);
 
     void process_bil_stmt(Stmt *s, uint64_t inst_flags);
     void process_bil(reil_raw_t *raw_info, bap_block_t *block);
 
 private:        
     
-    int32_t tempreg_find(string name);
+    int32_t tempreg_find(sym_t sym);
     int32_t tempreg_alloc(void);
-    string tempreg_get_name(int32_t tempreg_num);
-    string tempreg_get(string name);
+    sym_t tempreg_get(sym_t sym);
     
     uint64_t convert_special(Special *special);
     reg_t convert_operand_size(reil_size_t size);
@@ -53,7 +57,7 @@ private:
 
     void process_reil_inst(reil_inst_t *reil_inst);
 
-    bool get_bil_label(string name, reil_addr_t *addr);
+    bool get_bil_label(sym_t sym, reil_addr_t *addr);
     Stmt *get_bil_stmt(int pos);
 
     void check_cjmp_false_target(Exp *target);
@@ -83,19 +87,122 @@ private:
     void *inst_handler_context;
 };
 
+// VEX IR memory high-water mark for REIL_FLAG_RELEASE
+#define REIL_ARENA_RELEASE_SIZE (1 << 20)
+
+// max. number of machine instructions in one VEX call for REIL_FLAG_BLOCK
+#define REIL_BLOCK_MAX_INSNS 32
+
+// max. number of machine instructions in translation cache
+#define REIL_CACHE_MAX_ENTRIES 0x4000
+
+// max. number of machine instructions to keep for REIL_FLAG_DEAD_EFLAGS
+#define REIL_EFLAGS_MAX_INSNS 0x100
+
+// address delta that is used to find address dependent IR constants
+#define REIL_CACHE_PROBE_DELTA 0x1000
+
+// must be changed when generated IR code changes, on-disk cache entries of other versions are ignored
+#define REIL_TRANSLATOR_VERSION 1
+
+// translation cache entry states
+#define REIL_CACHE_SEEN 0   // instruction was translated only once
+#define REIL_CACHE_OK   1   // cached IR code can be replayed
+#define REIL_CACHE_BAD  2   // IR code depends on instruction address in unknown way
+
+// which arguments of cached IR instruction must be relocated
+#define REIL_RELOC_A    0x01
+#define REIL_RELOC_B    0x02
+#define REIL_RELOC_C    0x04
+
+typedef struct _reil_cache_entry
+{
+    int state;
+    reil_addr_t addr;               // address of the cached instruction
+    vector<reil_inst_t> insts;      // .. and it's IR code
+    vector<uint8_t> relocs;         // REIL_RELOC_* bits for each IR instruction
+
+} reil_cache_entry;
+
 class CReilTranslator
 {
 public:
 
-    CReilTranslator(VexArch arch, reil_inst_handler_t handler, void *context);
+    CReilTranslator(VexArch arch, reil_inst_handler_t handler, void *context, int flags = 0);
     ~CReilTranslator();
 
     int process_inst(address_t addr, uint8_t *data, int size);
+    int process_insns(address_t addr, uint8_t *data, int size, int *insns_count);
+    int get_inst_size(uint8_t *data);
+    void set_inst_handler(reil_inst_handler_t handler, void *context);
+    void get_stats(reil_stats_t *stats);
+
+    // use persistent translation cache in addition to the in-memory one
+    bool set_disk_cache(const char *path, unsigned long long max_size);
+    CReilDiskCache *get_disk_cache(void) { return disk_cache; }
+
+    // pass all of the pending IR instructions to the user handler, returns
+    // REIL_ERROR when handler has failed
+    int flush(void);
+
+    // check if IR code of some machine instructions wasn't passed to the handler yet
+    bool is_pending(void) { return eflags_insts.size() > 0; }
+
+    VexArch get_arch(void) { return guest; }
+    int get_flags(void) { return flags; }
 
 private:
 
+    static int inst_handler_proxy(reil_inst_t *inst, void *context);
+    int deliver_inst(reil_inst_t *inst);
+
+    void eflags_record(reil_inst_t *inst);
+    void eflags_optimize(void);
+
+    int translate_inst(address_t addr, uint8_t *data, int size);
+    void translate_block(bap_block_t *block, uint8_t *data);
+
+    int cache_update(reil_cache_entry *entry, address_t addr, uint8_t *data, int size);
+    bool cache_relocs(reil_cache_entry *entry, vector<reil_inst_t> &probe);
+    void cache_replay(reil_cache_entry *entry, reil_raw_t *raw_info);
+    void cache_replay(reil_cache_entry *entry, address_t addr, uint8_t *data, int size, 
+                      string &str_mnem, string &str_op);
+    reil_cache_entry *cache_insert(string &key);
+
     VexArch guest;
+    int flags;
     CReilFromBilTranslator *translator;
+
+    // user-specified REIL instruction handler
+    reil_inst_handler_t inst_handler;
+    void *inst_handler_context;
+
+    // libasmir state that belongs to this instance
+    asmir_ctx_t *asmir_ctx;
+
+    // translation cache, keyed by instruction bytes
+    map<string, reil_cache_entry> cache;
+    deque<string> cache_order;
+
+    vector<reil_inst_t> *cache_record;  // where to save IR instructions that was generated
+    bool cache_probe;                   // don't pass generated IR to the user handler
+
+    // on-disk translation cache, it's keyed by instruction bytes with this prefix
+    CReilDiskCache *disk_cache;
+    string disk_cache_prefix;
+
+    // IR code optimizer for REIL_FLAG_OPTIMIZE
+    CReilOptimizer *optimizer;
+    vector<reil_inst_t> *optimizer_record;  // IR code of the current machine instruction
+
+    // dead EFLAGS elimination for REIL_FLAG_DEAD_EFLAGS
+    CReilOptimizer *eflags_optimizer;
+    vector<reil_inst_t> eflags_insts;       // IR code of the current basic block
+    deque<string> eflags_raw;               // .. copies of the machine code and strings
+    int eflags_count;                       // .. and number of machine instructions
+    int eflags_ret;                         // handler error at the end of basic block
+
+    reil_stats_t stats;
 };
 
 #endif // REIL_TRANSLATOR_H
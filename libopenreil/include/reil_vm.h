@@ -0,0 +1,159 @@
+#ifndef REIL_VM_H
+#define REIL_VM_H
+
+// VM memory page size
+#define REIL_VM_PAGE_BITS 12
+#define REIL_VM_PAGE_SIZE (1 << REIL_VM_PAGE_BITS)
+
+typedef struct _reil_vm_page
+{
+    uint8_t data[REIL_VM_PAGE_SIZE];
+    uint8_t valid[REIL_VM_PAGE_SIZE / 8];   // bitmap of allocated bytes
+    int refs;                               // number of VM and snapshots using this page
+
+} reil_vm_page;
+
+// number of entries in the page lookup cache
+#define REIL_VM_PAGE_CACHE 0x40
+
+typedef struct _reil_vm_page_cache
+{
+    reil_addr_t addr;
+    reil_vm_page *page;
+
+} reil_vm_page_cache;
+
+typedef struct _reil_vm_arg
+{
+    reil_type_t type;
+    reil_size_t size;
+    int bits;           // size of the argument in bits
+    reil_const_t mask;  // .. and it's value mask
+    reil_const_t val;   // value of A_CONST
+    int reg;            // index of A_REG or A_TEMP in the register file
+
+} reil_vm_arg;
+
+typedef struct _reil_vm_inst
+{
+    reil_op_t op;
+    reil_inum_t inum;
+    reil_vm_arg a, b, c;
+    bool brk;           // breakpoint before this instruction
+
+} reil_vm_inst;
+
+typedef struct _reil_vm_insn
+{
+    reil_addr_t addr;   // address of the machine instruction
+    int size;           // .. and it's size
+    vector<reil_vm_inst> insts;
+
+    // code of the next machine instruction, set on first execution
+    struct _reil_vm_insn *next;
+
+    bool bb_end;        // instruction ends basic block
+    void *jit_block;    // compiled block that starts at this instruction
+    bool jit_skip;      // .. or true if it can't be compiled
+
+    // addresses of compiled blocks that contain this instruction
+    vector<reil_addr_t> jit_refs;
+
+} reil_vm_insn;
+
+typedef struct _reil_vm_reg_info
+{
+    string name;
+    reil_size_t size;
+    reil_const_t mask;
+
+} reil_vm_reg_info;
+
+typedef struct _reil_vm_snap
+{
+    map<reil_addr_t, reil_vm_page *> pages;
+    vector<reil_const_t> regs_val;
+
+} reil_vm_snap;
+
+class CReilJit;
+
+class CReilVm
+{
+public:
+
+    CReilVm(VexArch arch, reil_vm_mem_handler_t handler, void *context, int flags);
+    ~CReilVm();
+
+    void add_code(reil_inst_t *insts, int count);
+    void clear_code(void);
+
+    void set_break(reil_addr_t addr, reil_inum_t inum);
+    void clear_break(void);
+
+    int run(reil_addr_t addr, reil_vm_exit_t *exit);
+
+    int reg_index(const char *name, reil_size_t size);
+    int reg_count(void) { return regs.size(); }
+    reil_vm_reg_info *reg_info(int reg) { return &regs[reg]; }
+
+    reil_const_t reg_get(int reg) { return regs_val[reg]; }
+    void reg_set(int reg, reil_const_t val) { regs_val[reg] = val & regs[reg].mask; }
+
+    void mem_alloc(reil_addr_t addr, int size, uint8_t *data);
+    bool mem_read(reil_addr_t addr, int size, uint8_t *buff);
+    bool mem_write(reil_addr_t addr, int size, uint8_t *buff);
+    void mem_clear(void);
+
+    reil_vm_snap *snapshot(void);
+    void restore(reil_vm_snap *snap);
+    void snapshot_free(reil_vm_snap *snap);
+
+private:
+
+    void convert_arg(reil_arg_t *arg, reil_vm_arg *vm_arg);
+
+    reil_vm_page *mem_page(reil_addr_t addr, bool alloc);
+    reil_vm_page *mem_page_write(reil_addr_t addr, bool alloc);
+    void mem_page_release(reil_vm_page *page);
+    bool mem_load(reil_addr_t addr, int size, reil_const_t *val);
+    bool mem_store(reil_addr_t addr, int size, reil_const_t val);
+
+    // memory access helpers for compiled code
+    static int jit_mem_load(struct _reil_jit_ctx *ctx, reil_addr_t addr, int size, reil_const_t *val);
+    static int jit_mem_store(struct _reil_jit_ctx *ctx, reil_addr_t addr, int size, reil_const_t val);
+
+    void jit_compile(reil_vm_insn *first);
+    void jit_invalidate(reil_vm_insn *insn);
+    void jit_flush(void);
+
+    VexArch guest;
+
+    // register index of the instruction pointer
+    int reg_ip;
+
+    // flat register file, registers are never removed
+    vector<reil_vm_reg_info> regs;
+    vector<reil_const_t> regs_val;
+    map<string, int> regs_index;
+
+    // IR code of machine instructions and breakpoints
+    map<reil_addr_t, reil_vm_insn> code;
+    map<reil_addr_t, vector<reil_inum_t> > breaks;
+
+    // paged memory
+    map<reil_addr_t, reil_vm_page *> pages;
+    reil_vm_page_cache page_cache[REIL_VM_PAGE_CACHE];
+
+    // pages that were modified since the last snapshot() or restore() of snap_base
+    set<reil_addr_t> pages_dirty;
+    reil_vm_snap *snap_base;
+
+    bool strict;
+    CReilJit *jit;
+
+    reil_vm_mem_handler_t mem_handler;
+    void *mem_handler_context;
+};
+
+#endif // REIL_VM_H
@@ -5,6 +5,13 @@
 #include <assert.h>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <pthread.h>
+#include <sys/time.h>
 
 // libasmir includes
 #include "irtoir.h"
@@ -12,15 +19,47 @@
 // OpenREIL includes
 #include "libopenreil.h"
 #include "reil_translator.h"
+#include "reil_cache.h"
 
 #define STR_ARG_EMPTY " "
 #define STR_VAR(_name_, _t_) "(" + (_name_) + ", " + to_string_size((_t_)) + ")"
 #define STR_CONST(_val_, _t_) "(" + to_string_constant((_val_), (_t_)) + ", " + to_string_size((_t_)) + ")"
 
+// extended information about machine instruction that was translated in batch or parallel mode
+typedef struct _reil_batch_raw
+{
+    int inst;           // index of the IR instruction in reil_batch_t.insts or chunk buffer
+    size_t data;        // offsets of instruction bytes and strings in the heap
+    size_t str_mnem;
+    size_t str_op;
+
+} reil_batch_raw;
+
 typedef struct _reil_context
 {
     CReilTranslator *translator;
 
+    // user-specified REIL instruction handler
+    reil_inst_handler_t inst_handler;
+    void *inst_handler_context;
+
+    // reil_translate_batch() state
+    reil_batch_t *batch;
+    bool batch_overflow;
+    vector<char> batch_heap;
+    vector<reil_batch_raw> batch_raw;
+
+    // per-worker statistics of the last reil_translate_parallel() call
+    vector<reil_worker_stats_t> parallel_stats;
+
+    // reil_translate_func() state
+    vector<reil_inst_t> func_code;
+    vector<char> func_heap;
+    vector<reil_batch_raw> func_raw;
+    vector<reil_inst_t> func_insts;
+    vector<reil_func_bb_t> func_bbs;
+    vector<int> func_succ;
+
 } reil_context;
 
 string to_string_constant(reil_const_t val, reil_size_t size)
@@ -89,7 +128,7 @@ extern "C" void reil_inst_print(reil_inst_t *inst)
     printf("\n");
 }
 
-extern "C" reil_t reil_init(reil_arch_t arch, reil_inst_handler_t handler, void *context)
+extern "C" reil_t reil_init_ex(reil_arch_t arch, reil_inst_handler_t handler, void *context, int flags)
 {
     VexArch guest;
 
@@ -105,17 +144,33 @@ extern "C" reil_t reil_init(reil_arch_t arch, reil_inst_handler_t handler, void
         assert(0);
     }
 
+    if ((flags & REIL_FLAG_DEAD_EFLAGS) && guest != VexArchX86)
+    {
+        // EFLAGS elimination is implemented only for x86
+        return NULL;
+    }
+
     // allocate translator context
-    reil_context *c = (reil_context *)malloc(sizeof(reil_context));
+    reil_context *c = new reil_context;
     assert(c);
 
+    c->inst_handler = handler;
+    c->inst_handler_context = context;
+    c->batch = NULL;
+    c->batch_overflow = false;
+
     // create new translator instance
-    c->translator = new CReilTranslator(guest, handler, context);
+    c->translator = new CReilTranslator(guest, handler, context, flags);
     assert(c->translator);
 
     return c;
 }
 
+extern "C" reil_t reil_init(reil_arch_t arch, reil_inst_handler_t handler, void *context)
+{
+    return reil_init_ex(arch, handler, context, 0);
+}
+
 extern "C" void reil_close(reil_t reil)
 {
     reil_context *c = (reil_context *)reil;
@@ -124,7 +179,7 @@ extern "C" void reil_close(reil_t reil)
     assert(c->translator);
     delete c->translator;
 
-    free(c);
+    delete c;
 }
 
 int reil_translate_report_error(reil_addr_t addr, const char *reason)
@@ -135,15 +190,13 @@ int reil_translate_report_error(reil_addr_t addr, const char *reason)
     return REIL_ERROR;
 }
 
-extern "C" int reil_translate_insn(reil_t reil, reil_addr_t addr, unsigned char *buff, int len)
+int reil_translate_process_inst(CReilTranslator *translator, reil_addr_t addr, unsigned char *buff, int len)
 {
     int inst_len = 0;
-    reil_context *c = (reil_context *)reil;
-    assert(c);    
 
     try
     {
-        inst_len = c->translator->process_inst(addr, buff, len);    
+        inst_len = translator->process_inst(addr, buff, len);    
         assert(inst_len != 0 && inst_len != -1);
     }
     catch (CReilTranslatorException e)
@@ -160,25 +213,1161 @@ extern "C" int reil_translate_insn(reil_t reil, reil_addr_t addr, unsigned char
     return inst_len;
 }
 
+extern "C" int reil_translate_insn(reil_t reil, reil_addr_t addr, unsigned char *buff, int len)
+{
+    reil_context *c = (reil_context *)reil;
+    assert(c);    
+
+    int ret = reil_translate_process_inst(c->translator, addr, buff, len);
+
+    // REIL_FLAG_DEAD_EFLAGS can't look beyond the single instruction here
+    if (c->translator->flush() == REIL_ERROR)
+    {
+        return REIL_ERROR;
+    }
+
+    return ret;
+}
+
+int reil_translate_process_insns(CReilTranslator *translator, reil_addr_t addr, unsigned char *buff, int len, 
+                                 int *insns_count)
+{
+    int insns_len = 0;
+
+    try
+    {
+        insns_len = translator->process_insns(addr, buff, len, insns_count);    
+        assert(insns_len != 0 && insns_len != -1);
+    }
+    catch (CReilTranslatorException e)
+    {
+        // libopenreil exception
+        return reil_translate_report_error(addr, e.reason.c_str());
+    }
+    catch (const char *e)
+    {
+        // libasmir exception
+        return reil_translate_report_error(addr, e);
+    }
+
+    return insns_len;
+}
+
+int reil_translate_buff(CReilTranslator *translator, reil_addr_t addr, unsigned char *buff, int len)
+{
+    if (len >= MAX_INST_LEN)
+    {
+        // buffer is large enough for any instruction, translate it in place
+        return reil_translate_process_inst(translator, addr, buff, len);
+    }
+
+    uint8_t inst_buff[MAX_INST_LEN];
+
+    // copy the last instruction into the zero padded buffer
+    memset(inst_buff, 0, sizeof(inst_buff));
+    memcpy(inst_buff, buff, len);
+
+    return reil_translate_process_inst(translator, addr, inst_buff, sizeof(inst_buff));
+}
+
 extern "C" int reil_translate(reil_t reil, reil_addr_t addr, unsigned char *buff, int len)
 {
     int p = 0, translated = 0;    
+    reil_context *c = (reil_context *)reil;
+    assert(c);
 
     while (p < len)
     {
-        uint8_t inst_buff[MAX_INST_LEN];
-        int copy_len = min(MAX_INST_LEN, len - p), inst_len = 0;
+        int inst_len = 0, insns_count = 1;
 
-        // copy one instruction into the buffer
-        memset(inst_buff, 0, sizeof(inst_buff));
-        memcpy(inst_buff, buff + p, copy_len);
+        if (len - p >= MAX_INST_LEN * 2)
+        {
+            // translate several instructions at once if REIL_FLAG_BLOCK was set
+            inst_len = reil_translate_process_insns(c->translator, addr + p, buff + p, len - p, &insns_count);
+        }
+        else
+        {
+            inst_len = reil_translate_buff(c->translator, addr + p, buff + p, len - p);
+        }
 
-        inst_len = reil_translate_insn(reil, addr + p, inst_buff, sizeof(inst_buff));
-        if (inst_len == REIL_ERROR) return REIL_ERROR;
+        if (inst_len == REIL_ERROR) 
+        {
+            // deliver IR code of the successfully translated instructions
+            c->translator->flush();
+            return REIL_ERROR;
+        }
 
         p += inst_len;
-        translated += 1;
+        translated += insns_count;
     }    
 
+    // all of the flags are live at the end of the buffer
+    if (c->translator->flush() == REIL_ERROR)
+    {
+        return REIL_ERROR;
+    }
+
     return translated;
 }
+
+size_t reil_heap_put(vector<char> &heap, const void *data, size_t size)
+{
+    size_t offset = heap.size();
+
+    heap.insert(heap.end(), (char *)data, (char *)data + size);
+
+    return offset;
+}
+
+int reil_batch_handler(reil_inst_t *inst, void *context)
+{
+    reil_context *c = (reil_context *)context;
+    reil_batch_t *batch = c->batch;
+
+    if (batch->insts_count >= batch->insts_max)
+    {
+        // caller-owned buffer is full
+        c->batch_overflow = true;
+        return 0;
+    }
+
+    reil_inst_t *dst = &batch->insts[batch->insts_count];
+    memcpy(dst, inst, sizeof(reil_inst_t));
+
+    if (inst->inum == 0)
+    {
+        reil_batch_raw raw;
+        raw.inst = batch->insts_count;
+
+        /* 
+            Pointers that was passed by translator are valid only during handler call, 
+            so, we need to copy instruction bytes and strings into the heap that
+            belongs to the translator context.
+        */
+        raw.data = reil_heap_put(c->batch_heap, inst->raw_info.data, inst->raw_info.size);
+        raw.str_mnem = reil_heap_put(c->batch_heap, inst->raw_info.str_mnem, strlen(inst->raw_info.str_mnem) + 1);
+        raw.str_op = reil_heap_put(c->batch_heap, inst->raw_info.str_op, strlen(inst->raw_info.str_op) + 1);
+
+        c->batch_raw.push_back(raw);
+    }
+
+    batch->insts_count += 1;
+
+    return 0;
+}
+
+static int reil_batch_index(reil_context *c, reil_batch_t *batch, int first, vector<reil_batch_insn_t> &pending)
+{
+    int count = pending.size();
+
+    for (int n = 0; n < count; n++)
+    {
+        reil_batch_insn_t *insn = &batch->index[batch->index_count];
+
+        *insn = pending[n];
+        insn->first = first;
+
+        // IR code of each machine instruction ends with IOPT_ASM_END
+        while (first < batch->insts_count - 1 && !(batch->insts[first].flags & IOPT_ASM_END))
+        {
+            first += 1;
+        }
+
+        insn->count = first + 1 - insn->first;
+        first += 1;
+
+        batch->index_count += 1;
+    }
+
+    // discard partially translated instruction, if any
+    batch->insts_count = first;
+
+    while (c->batch_raw.size() > 0 && c->batch_raw.back().inst >= first)
+    {
+        c->batch_raw.pop_back();
+    }
+
+    pending.clear();
+
+    return count;
+}
+
+extern "C" int reil_translate_batch(reil_t reil, reil_addr_t addr, unsigned char *buff, int len, reil_batch_t *batch)
+{
+    int p = 0, translated = 0, ret = 0;
+    reil_context *c = (reil_context *)reil;
+    assert(c);
+    assert(batch);
+
+    batch->insts_count = batch->index_count = batch->translated = 0;
+
+    // pointers that was returned by previous call are not valid anymore
+    c->batch_heap.clear();
+    c->batch_raw.clear();
+
+    c->batch = batch;
+    c->translator->set_inst_handler(reil_batch_handler, c);
+
+    // instructions of the current basic block, REIL_FLAG_DEAD_EFLAGS passes 
+    // their IR code to the handler only at the end of the block
+    vector<reil_batch_insn_t> pending;
+    int first = 0, block_p = 0;
+    size_t raw_count = 0;
+    bool single = false;
+
+    while (p < len && batch->index_count + (int)pending.size() < batch->index_max)
+    {
+        if (pending.size() == 0)
+        {
+            first = batch->insts_count;
+            raw_count = c->batch_raw.size();
+            block_p = p;
+
+            c->batch_overflow = false;
+        }
+
+        int inst_len = reil_translate_buff(c->translator, addr + p, buff + p, len - p);
+
+        if (inst_len != REIL_ERROR)
+        {
+            reil_batch_insn_t insn;
+            insn.addr = addr + p;
+            insn.size = inst_len;
+            insn.first = insn.count = 0;
+
+            pending.push_back(insn);
+            p += inst_len;
+        }
+
+        if (inst_len == REIL_ERROR || single || p >= len ||
+            batch->index_count + (int)pending.size() >= batch->index_max)
+        {
+            // end of the batch, get all of the pending IR code
+            c->translator->flush();
+        }
+
+        if (c->translator->is_pending())
+        {
+            // basic block is not finished yet
+            continue;
+        }
+
+        if (c->batch_overflow)
+        {
+            // discard IR code of the whole basic block
+            batch->insts_count = first;
+            c->batch_raw.resize(raw_count);
+
+            // next call will start from the first instruction of the block
+            p = block_p;
+
+            if (translated == 0 && pending.size() > 1)
+            {
+                // translate this block one instruction at time
+                pending.clear();
+                single = true;
+                continue;
+            }
+
+            if (translated == 0)
+            {
+                if (pending.size() > 0)
+                {
+                    fprintf(stderr, "Batch buffer is too small for instruction at address 0x%llx\n", addr + p);
+                }
+
+                ret = REIL_ERROR;
+            }
+
+            break;
+        }
+
+        translated += reil_batch_index(c, batch, first, pending);
+
+        if (inst_len == REIL_ERROR)
+        {
+            if (translated == 0)
+            {
+                ret = REIL_ERROR;
+            }
+
+            // next call will start from the current instruction
+            break;
+        }
+    }
+
+    c->batch = NULL;
+    c->translator->set_inst_handler(c->inst_handler, c->inst_handler_context);
+
+    // heap is not growing anymore, so it's safe to get the pointers
+    for (vector<reil_batch_raw>::iterator it = c->batch_raw.begin(); it != c->batch_raw.end(); ++it)
+    {
+        reil_raw_t *raw_info = &batch->insts[it->inst].raw_info;
+
+        raw_info->data = (unsigned char *)&c->batch_heap[it->data];
+        raw_info->str_mnem = &c->batch_heap[it->str_mnem];
+        raw_info->str_op = &c->batch_heap[it->str_op];
+    }
+
+    batch->translated = p;
+
+    return ret == REIL_ERROR ? REIL_ERROR : translated;
+}
+
+//======================================================================
+//
+// Function translation
+//
+//======================================================================
+
+// max. number of machine instructions in one function
+#define FUNC_MAX_INSTS 0x10000
+
+typedef pair<reil_addr_t, reil_inum_t> reil_func_addr;
+
+typedef struct _reil_func_insn
+{
+    int first;          // index of the first IR instruction in reil_context.func_code
+    int count;          // number of IR instructions
+
+} reil_func_insn;
+
+int reil_func_handler(reil_inst_t *inst, void *context)
+{
+    reil_context *c = (reil_context *)context;
+
+    c->func_code.push_back(*inst);
+
+    if (inst->inum == 0)
+    {
+        reil_batch_raw raw;
+        raw.inst = c->func_code.size() - 1;
+
+        // see reil_batch_handler()
+        raw.data = reil_heap_put(c->func_heap, inst->raw_info.data, inst->raw_info.size);
+        raw.str_mnem = reil_heap_put(c->func_heap, inst->raw_info.str_mnem, strlen(inst->raw_info.str_mnem) + 1);
+        raw.str_op = reil_heap_put(c->func_heap, inst->raw_info.str_op, strlen(inst->raw_info.str_op) + 1);
+
+        c->func_raw.push_back(raw);
+    }
+    else
+    {
+        reil_raw_t *raw_info = &c->func_code.back().raw_info;
+
+        raw_info->data = NULL;
+        raw_info->str_mnem = raw_info->str_op = NULL;
+    }
+
+    return 0;
+}
+
+// check for jump to the known location
+static bool reil_func_is_jump(reil_inst_t *inst)
+{
+    return inst->op == I_JCC && !(inst->flags & IOPT_CALL) && inst->c.type == A_CONST;
+}
+
+// the same rules as Insn.next() in pyopenreil/REIL.py
+static bool reil_func_has_next(reil_inst_t *inst)
+{
+    if (inst->flags & IOPT_RET)
+    {
+        // end of function
+        return false;
+    }
+
+    if (inst->op == I_JCC && !(inst->flags & IOPT_CALL) && inst->a.type == A_CONST && inst->a.val != 0)
+    {
+        // unconditional jump
+        return false;
+    }
+
+    return true;
+}
+
+static reil_func_addr reil_func_next(reil_inst_t *inst)
+{
+    if (inst->flags & IOPT_ASM_END)
+    {
+        // first IR instruction of the next machine instruction
+        return reil_func_addr(inst->raw_info.addr + inst->raw_info.size, 0);
+    }
+
+    return reil_func_addr(inst->raw_info.addr, inst->inum + 1);
+}
+
+static void reil_func_succ(reil_context *c, map<reil_func_addr, int> &bbs, reil_func_bb_t *bb, reil_func_addr addr)
+{
+    map<reil_func_addr, int>::iterator it = bbs.find(addr);
+    if (it == bbs.end())
+    {
+        return;
+    }
+
+    for (int i = bb->succ; i < (int)c->func_succ.size(); i++)
+    {
+        // conditional jump to the next instruction
+        if (c->func_succ[i] == it->second) return;
+    }
+
+    c->func_succ.push_back(it->second);
+}
+
+static void reil_func_index(reil_context *c, map<reil_addr_t, reil_func_insn> &insns, set<reil_func_addr> &leaders, 
+                            vector<reil_addr_t> &stack, vector<reil_addr_t> &pending, int first)
+{
+    for (size_t n = 0; n < pending.size(); n++)
+    {
+        reil_func_insn *insn = &insns[pending[n]];
+        insn->first = first;
+
+        // IR code of each machine instruction ends with IOPT_ASM_END
+        while (first < (int)c->func_code.size() - 1 && !(c->func_code[first].flags & IOPT_ASM_END))
+        {
+            first += 1;
+        }
+
+        insn->count = first + 1 - insn->first;
+        first += 1;
+
+        for (int i = insn->first; i < insn->first + insn->count; i++)
+        {
+            reil_inst_t *inst = &c->func_code[i];
+
+            if (reil_func_is_jump(inst))
+            {
+                // jump destination starts a new basic block
+                leaders.insert(reil_func_addr(inst->c.val, 0));
+                stack.push_back(inst->c.val);
+            }
+
+            if ((inst->flags & IOPT_BB_END) && reil_func_has_next(inst))
+            {
+                leaders.insert(reil_func_next(inst));
+            }
+        }
+    }
+
+    pending.clear();
+}
+
+int reil_func_translate(reil_context *c, reil_addr_t addr, reil_reader_t reader, void *context, 
+                        map<reil_addr_t, reil_func_insn> &insns, set<reil_func_addr> &leaders, 
+                        reil_addr_t *error_addr)
+{
+    vector<reil_addr_t> stack;
+
+    // instructions of the current basic block, REIL_FLAG_DEAD_EFLAGS passes 
+    // their IR code to the handler only at the end of the block
+    vector<reil_addr_t> pending;
+    reil_addr_t next = 0;
+    int first = 0;
+
+    leaders.insert(reil_func_addr(addr, 0));
+    stack.push_back(addr);
+
+    // iterative recursive descent
+    while (stack.size() > 0 || pending.size() > 0)
+    {
+        if (pending.size() > 0 && (stack.size() == 0 || stack.back() != next))
+        {
+            // fall-through instruction was already translated, get IR code of the block
+            c->translator->flush();
+            reil_func_index(c, insns, leaders, stack, pending, first);
+            continue;
+        }
+
+        reil_addr_t inst_addr = stack.back();
+        uint8_t buff[MAX_INST_LEN];
+
+        stack.pop_back();
+        *error_addr = inst_addr;
+
+        if (insns.find(inst_addr) != insns.end())
+        {
+            // already translated
+            continue;
+        }
+
+        if (insns.size() >= FUNC_MAX_INSTS)
+        {
+            fprintf(stderr, "Function at address 0x%llx is too large\n", addr);
+            return REIL_ERROR;
+        }
+
+        // zero padded buffer, see reil_translate_buff()
+        memset(buff, 0, sizeof(buff));
+
+        if (reader(inst_addr, buff, sizeof(buff), context) <= 0)
+        {
+            fprintf(stderr, "Unable to read instruction at address 0x%llx\n", inst_addr);
+            return REIL_ERROR;
+        }
+
+        if (pending.size() == 0)
+        {
+            first = c->func_code.size();
+        }
+
+        int inst_len = reil_translate_process_inst(c->translator, inst_addr, buff, sizeof(buff));
+
+        if (inst_len == REIL_ERROR)
+        {
+            return REIL_ERROR;
+        }
+
+        // IR code will be assigned by reil_func_index()
+        insns[inst_addr].first = insns[inst_addr].count = 0;
+
+        pending.push_back(inst_addr);
+        next = inst_addr + inst_len;
+
+        if (c->translator->is_pending())
+        {
+            // basic block is not finished yet, instruction has fall-through
+            stack.push_back(next);
+            continue;
+        }
+
+        reil_func_index(c, insns, leaders, stack, pending, first);
+
+        if (reil_func_has_next(&c->func_code.back()))
+        {
+            // fall-through to the next instruction will be processed first
+            stack.push_back(next);
+        }
+    }
+
+    return 0;
+}
+
+void reil_func_reachable(reil_context *c, reil_addr_t addr, map<reil_addr_t, reil_func_insn> &insns, 
+                         vector<bool> &reachable)
+{
+    vector<reil_func_addr> stack;
+
+    stack.push_back(reil_func_addr(addr, 0));
+
+    while (stack.size() > 0)
+    {
+        reil_func_addr inst_addr = stack.back();
+        stack.pop_back();
+
+        map<reil_addr_t, reil_func_insn>::iterator it = insns.find(inst_addr.first);
+        if (it == insns.end() || inst_addr.second >= it->second.count)
+        {
+            continue;
+        }
+
+        // IR instructions are numbered sequentially
+        int i = it->second.first + inst_addr.second;
+        if (reachable[i])
+        {
+            continue;
+        }
+
+        reil_inst_t *inst = &c->func_code[i];
+        reachable[i] = true;
+
+        if (reil_func_has_next(inst))
+        {
+            stack.push_back(reil_func_next(inst));
+        }
+
+        if (reil_func_is_jump(inst))
+        {
+            stack.push_back(reil_func_addr(inst->c.val, 0));
+        }
+    }
+}
+
+void reil_func_build(reil_context *c, reil_addr_t addr, map<reil_addr_t, reil_func_insn> &insns, 
+                     set<reil_func_addr> &leaders, map<reil_func_addr, int> &bbs)
+{
+    // func_code index -> func_insts index
+    vector<int> index(c->func_code.size());
+
+    // VEX might generate unreachable IR code after the jumps inside of machine instruction
+    vector<bool> reachable(c->func_code.size(), false);
+    reil_func_reachable(c, addr, insns, reachable);
+
+    reil_func_addr next;
+    bool bb_end = true;
+
+    for (map<reil_addr_t, reil_func_insn>::iterator it = insns.begin(); it != insns.end(); ++it)
+    {
+        for (int i = it->second.first; i < it->second.first + it->second.count; i++)
+        {
+            reil_inst_t *inst = &c->func_code[i];
+            reil_func_addr inst_addr(inst->raw_info.addr, inst->inum);
+
+            if (!reachable[i])
+            {
+                bb_end = true;
+                continue;
+            }
+
+            // jump destination or instruction that is not reachable from the previous one
+            if (bb_end || inst_addr != next || leaders.find(inst_addr) != leaders.end())
+            {
+                reil_func_bb_t bb;
+                bb.addr = inst_addr.first;
+                bb.inum = inst_addr.second;
+                bb.first = c->func_insts.size();
+                bb.count = bb.succ = bb.succ_count = 0;
+
+                bbs[inst_addr] = c->func_bbs.size();
+                c->func_bbs.push_back(bb);
+            }
+
+            index[i] = c->func_insts.size();
+
+            c->func_insts.push_back(*inst);
+            c->func_bbs.back().count += 1;
+
+            bb_end = (inst->flags & IOPT_BB_END) || !reil_func_has_next(inst);
+            next = reil_func_next(inst);
+        }
+    }
+
+    // successors of each basic block, fall-through goes first
+    for (int i = 0; i < (int)c->func_bbs.size(); i++)
+    {
+        reil_func_bb_t *bb = &c->func_bbs[i];
+        reil_inst_t *last = &c->func_insts[bb->first + bb->count - 1];
+
+        bb->succ = c->func_succ.size();
+
+        if (reil_func_has_next(last))
+        {
+            reil_func_succ(c, bbs, bb, reil_func_next(last));
+        }
+
+        if (reil_func_is_jump(last))
+        {
+            reil_func_succ(c, bbs, bb, reil_func_addr(last->c.val, 0));
+        }
+
+        bb->succ_count = c->func_succ.size() - bb->succ;
+    }
+
+    // heap is not growing anymore, so it's safe to get the pointers
+    for (vector<reil_batch_raw>::iterator it = c->func_raw.begin(); it != c->func_raw.end(); ++it)
+    {
+        if (!reachable[it->inst])
+        {
+            continue;
+        }
+
+        reil_raw_t *raw_info = &c->func_insts[index[it->inst]].raw_info;
+
+        raw_info->data = (unsigned char *)&c->func_heap[it->data];
+        raw_info->str_mnem = &c->func_heap[it->str_mnem];
+        raw_info->str_op = &c->func_heap[it->str_op];
+    }
+}
+
+extern "C" int reil_translate_func(reil_t reil, reil_addr_t addr, reil_reader_t reader, void *context, reil_func_t *func)
+{
+    map<reil_addr_t, reil_func_insn> insns;
+    set<reil_func_addr> leaders;
+    map<reil_func_addr, int> bbs;
+
+    reil_context *c = (reil_context *)reil;
+    assert(c);
+    assert(reader);
+    assert(func);
+
+    memset(func, 0, sizeof(reil_func_t));
+
+    // pointers that was returned by previous call are not valid anymore
+    c->func_code.clear();
+    c->func_heap.clear();
+    c->func_raw.clear();
+    c->func_insts.clear();
+    c->func_bbs.clear();
+    c->func_succ.clear();
+
+    c->translator->set_inst_handler(reil_func_handler, c);
+
+    int ret = reil_func_translate(c, addr, reader, context, insns, leaders, &func->error_addr);
+
+    c->translator->set_inst_handler(c->inst_handler, c->inst_handler_context);
+
+    if (ret == REIL_ERROR)
+    {
+        return REIL_ERROR;
+    }
+
+    reil_func_build(c, addr, insns, leaders, bbs);
+
+    func->insts = &c->func_insts[0];
+    func->insts_count = c->func_insts.size();
+    func->bbs = &c->func_bbs[0];
+    func->bbs_count = c->func_bbs.size();
+    func->entry = bbs[reil_func_addr(addr, 0)];
+    func->succ = c->func_succ.size() > 0 ? &c->func_succ[0] : NULL;
+    func->succ_count = c->func_succ.size();
+    func->error_addr = 0;
+
+    return func->bbs_count;
+}
+
+//======================================================================
+//
+// Parallel translation
+//
+//======================================================================
+
+// number of machine instructions in one chunk of work
+#define PARALLEL_CHUNK_INSTS 64
+
+// how many chunks ahead of the delivered one workers can translate
+#define PARALLEL_WINDOW_PER_THREAD 4
+
+typedef struct _reil_parallel_chunk
+{
+    int first;          // index of the first machine instruction in reil_parallel.offsets
+    int count;          // number of machine instructions
+    
+    bool done;
+    int translated;     // number of successfully translated machine instructions
+
+    // translated IR code
+    vector<reil_inst_t> insts;
+    vector<char> heap;
+    vector<reil_batch_raw> raw;
+
+} reil_parallel_chunk;
+
+struct _reil_parallel;
+
+typedef struct _reil_parallel_worker
+{
+    struct _reil_parallel *parallel;
+
+    pthread_t thread;
+    CReilTranslator *translator;
+
+    // queue of chunks that was assigned to this worker
+    deque<int> queue;
+
+    // chunk that is being translated
+    reil_parallel_chunk *chunk;
+
+    reil_worker_stats_t stats;
+
+} reil_parallel_worker;
+
+typedef struct _reil_parallel
+{
+    reil_addr_t addr;
+    unsigned char *buff;
+    int len;
+
+    // offsets of machine instructions in buff
+    vector<int> offsets;
+
+    vector<reil_parallel_chunk> chunks;
+    vector<reil_parallel_worker> workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond_worker;     // signaled when window moves or translation was aborted
+    pthread_cond_t cond_done;       // signaled when chunk was translated
+
+    int delivered;                  // number of chunks that was passed to the handler
+    int window;
+    bool abort;
+
+} reil_parallel;
+
+unsigned long long reil_time_usec(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+int reil_parallel_handler(reil_inst_t *inst, void *context)
+{
+    reil_parallel_worker *worker = (reil_parallel_worker *)context;
+    reil_parallel_chunk *chunk = worker->chunk;
+
+    chunk->insts.push_back(*inst);
+
+    if (inst->inum == 0)
+    {
+        reil_batch_raw raw;
+        raw.inst = chunk->insts.size() - 1;
+
+        // see reil_batch_handler()
+        raw.data = reil_heap_put(chunk->heap, inst->raw_info.data, inst->raw_info.size);
+        raw.str_mnem = reil_heap_put(chunk->heap, inst->raw_info.str_mnem, strlen(inst->raw_info.str_mnem) + 1);
+        raw.str_op = reil_heap_put(chunk->heap, inst->raw_info.str_op, strlen(inst->raw_info.str_op) + 1);
+
+        chunk->raw.push_back(raw);
+    }
+
+    worker->stats.reil_insts += 1;
+
+    return 0;
+}
+
+int reil_parallel_get_chunk(reil_parallel_worker *worker, bool *stolen)
+{
+    reil_parallel *parallel = worker->parallel;
+
+    while (!parallel->abort)
+    {
+        int limit = parallel->delivered + parallel->window;
+        bool pending = false;
+
+        // take the next chunk from our own queue
+        if (worker->queue.size() > 0)
+        {
+            pending = true;
+
+            if (worker->queue.front() < limit)
+            {
+                int chunk = worker->queue.front();
+                worker->queue.pop_front();
+
+                *stolen = false;
+                return chunk;
+            }
+        }
+
+        /*
+            Steal from the worker that holds the lowest chunk: results are
+            delivered in address order, so, it's the most wanted one.
+        */
+        reil_parallel_worker *victim = NULL;
+
+        for (vector<reil_parallel_worker>::iterator it = parallel->workers.begin(); 
+             it != parallel->workers.end(); ++it)
+        {
+            if (it->queue.size() > 0)
+            {
+                pending = true;
+
+                if (it->queue.front() < limit &&
+                    (victim == NULL || it->queue.front() < victim->queue.front()))
+                {
+                    victim = &(*it);
+                }
+            }
+        }
+
+        if (victim)
+        {
+            int chunk = victim->queue.front();
+            victim->queue.pop_front();
+
+            *stolen = true;
+            return chunk;
+        }
+
+        if (!pending)
+        {
+            // all of the chunks were taken
+            break;
+        }
+
+        // wait for the main thread to deliver some chunks
+        pthread_cond_wait(&parallel->cond_worker, &parallel->lock);
+    }
+
+    return -1;
+}
+
+void *reil_parallel_worker_proc(void *param)
+{
+    reil_parallel_worker *worker = (reil_parallel_worker *)param;
+    reil_parallel *parallel = worker->parallel;
+
+    pthread_mutex_lock(&parallel->lock);
+
+    while (true)
+    {
+        bool stolen = false;
+        int n = reil_parallel_get_chunk(worker, &stolen);
+        if (n == -1)
+        {
+            break;
+        }
+
+        pthread_mutex_unlock(&parallel->lock);
+
+        reil_parallel_chunk *chunk = &parallel->chunks[n];
+        unsigned long long time_start = reil_time_usec();
+
+        worker->chunk = chunk;
+
+        for (int i = chunk->first; i < chunk->first + chunk->count; i++)
+        {
+            int p = parallel->offsets[i];
+
+            if (reil_translate_buff(worker->translator, parallel->addr + p, 
+                                    parallel->buff + p, parallel->len - p) == REIL_ERROR)
+            {
+                break;
+            }
+
+            worker->stats.insts += 1;
+            worker->stats.bytes += parallel->offsets[i + 1] - p;
+            chunk->translated += 1;
+        }
+
+        // REIL_FLAG_DEAD_EFLAGS works within the chunk boundaries
+        worker->translator->flush();
+
+        worker->chunk = NULL;
+        worker->stats.chunks += 1;
+        worker->stats.chunks_stolen += stolen ? 1 : 0;
+        worker->stats.time += reil_time_usec() - time_start;
+
+        pthread_mutex_lock(&parallel->lock);
+
+        chunk->done = true;
+        pthread_cond_signal(&parallel->cond_done);
+    }
+
+    pthread_mutex_unlock(&parallel->lock);
+
+    return NULL;
+}
+
+bool reil_parallel_split(reil_context *c, reil_parallel *parallel)
+{
+    int p = 0;
+
+    // linear sweep disassembly to find machine instructions boundaries
+    while (p < parallel->len)
+    {
+        int inst_len = 0;
+
+        if (parallel->len - p >= MAX_INST_LEN)
+        {
+            inst_len = c->translator->get_inst_size(parallel->buff + p);
+        }
+        else
+        {
+            uint8_t inst_buff[MAX_INST_LEN];
+
+            // see reil_translate_buff()
+            memset(inst_buff, 0, sizeof(inst_buff));
+            memcpy(inst_buff, parallel->buff + p, parallel->len - p);
+
+            inst_len = c->translator->get_inst_size(inst_buff);
+        }
+
+        if (inst_len <= 0)
+        {
+            reil_translate_report_error(parallel->addr + p, "Invalid instruction");
+            break;
+        }
+
+        parallel->offsets.push_back(p);
+        p += inst_len;
+    }
+
+    // end of the last instruction
+    parallel->offsets.push_back(p);
+
+    for (int i = 0; i < (int)parallel->offsets.size() - 1; i += PARALLEL_CHUNK_INSTS)
+    {
+        reil_parallel_chunk chunk;
+
+        chunk.first = i;
+        chunk.count = min((int)parallel->offsets.size() - 1 - i, PARALLEL_CHUNK_INSTS);
+        chunk.done = false;
+        chunk.translated = 0;
+
+        parallel->chunks.push_back(chunk);
+    }
+
+    return p >= parallel->len;
+}
+
+void reil_parallel_deliver(reil_parallel_chunk *chunk, reil_inst_handler_t handler, void *context)
+{
+    // heap is not growing anymore, so it's safe to get the pointers
+    for (vector<reil_batch_raw>::iterator it = chunk->raw.begin(); it != chunk->raw.end(); ++it)
+    {
+        reil_raw_t *raw_info = &chunk->insts[it->inst].raw_info;
+
+        raw_info->data = (unsigned char *)&chunk->heap[it->data];
+        raw_info->str_mnem = &chunk->heap[it->str_mnem];
+        raw_info->str_op = &chunk->heap[it->str_op];
+    }
+
+    for (vector<reil_inst_t>::iterator it = chunk->insts.begin(); it != chunk->insts.end(); ++it)
+    {
+        handler(&(*it), context);
+    }
+
+    // free translated code
+    vector<reil_inst_t>().swap(chunk->insts);
+    vector<char>().swap(chunk->heap);
+    vector<reil_batch_raw>().swap(chunk->raw);
+}
+
+extern "C" int reil_translate_parallel(reil_t reil, reil_addr_t addr, unsigned char *buff, int len, int threads,
+                                       reil_inst_handler_t handler, void *context)
+{
+    int translated = 0;
+    reil_context *c = (reil_context *)reil;
+    assert(c);
+    assert(threads > 0);
+
+    if (handler == NULL)
+    {
+        // use handler that was passed to reil_init()
+        handler = c->inst_handler;
+        context = c->inst_handler_context;
+    }
+
+    reil_parallel parallel;
+    parallel.addr = addr;
+    parallel.buff = buff;
+    parallel.len = len;
+    parallel.delivered = 0;
+    parallel.abort = false;
+
+    bool split_ok = reil_parallel_split(c, &parallel);
+
+    // don't start workers that will have nothing to do
+    threads = min(threads, (int)parallel.chunks.size());
+    parallel.window = threads * PARALLEL_WINDOW_PER_THREAD;
+
+    pthread_mutex_init(&parallel.lock, NULL);
+    pthread_cond_init(&parallel.cond_worker, NULL);
+    pthread_cond_init(&parallel.cond_done, NULL);
+
+    parallel.workers.resize(threads);
+
+    for (int i = 0; i < threads; i++)
+    {
+        reil_parallel_worker *worker = &parallel.workers[i];
+
+        worker->parallel = &parallel;
+        worker->chunk = NULL;
+        memset(&worker->stats, 0, sizeof(worker->stats));
+
+        // each worker has its own translator instance, direct mode holds VEX lock 
+        // during BAP IR generation so it's not used here
+        worker->translator = new CReilTranslator(c->translator->get_arch(), reil_parallel_handler, worker, 
+                                                 c->translator->get_flags() & ~REIL_FLAG_DIRECT);
+        assert(worker->translator);
+
+        CReilDiskCache *disk_cache = c->translator->get_disk_cache();
+        if (disk_cache)
+        {
+            // workers are sharing on-disk cache with the main translator
+            worker->translator->set_disk_cache(disk_cache->path.c_str(), disk_cache->max_size);
+        }
+    }
+
+    // distribute chunks between the workers
+    for (int i = 0; i < (int)parallel.chunks.size(); i++)
+    {
+        parallel.workers[i % threads].queue.push_back(i);
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        int err = pthread_create(&parallel.workers[i].thread, NULL, 
+                                 reil_parallel_worker_proc, &parallel.workers[i]);
+        assert(err == 0);
+    }
+
+    for (int i = 0; i < (int)parallel.chunks.size(); i++)
+    {
+        reil_parallel_chunk *chunk = &parallel.chunks[i];
+
+        pthread_mutex_lock(&parallel.lock);
+
+        while (!chunk->done)
+        {
+            pthread_cond_wait(&parallel.cond_done, &parallel.lock);
+        }
+
+        pthread_mutex_unlock(&parallel.lock);
+
+        // call user-specified REIL instruction handler in address order
+        reil_parallel_deliver(chunk, handler, context);
+
+        translated += chunk->translated;
+
+        pthread_mutex_lock(&parallel.lock);
+
+        parallel.delivered += 1;
+
+        if (chunk->translated != chunk->count)
+        {
+            // stop other workers after translation error
+            parallel.abort = true;
+            split_ok = false;
+        }
+
+        pthread_cond_broadcast(&parallel.cond_worker);
+        pthread_mutex_unlock(&parallel.lock);
+
+        if (parallel.abort)
+        {
+            break;
+        }
+    }
+
+    c->parallel_stats.clear();
+
+    for (int i = 0; i < threads; i++)
+    {
+        reil_parallel_worker *worker = &parallel.workers[i];
+
+        pthread_join(worker->thread, NULL);
+
+        c->parallel_stats.push_back(worker->stats);
+        delete worker->translator;
+    }
+
+    pthread_cond_destroy(&parallel.cond_done);
+    pthread_cond_destroy(&parallel.cond_worker);
+    pthread_mutex_destroy(&parallel.lock);
+
+    return split_ok ? translated : REIL_ERROR;
+}
+
+extern "C" int reil_parallel_stats(reil_t reil, reil_worker_stats_t *stats, int stats_max)
+{
+    reil_context *c = (reil_context *)reil;
+    assert(c);
+
+    int count = min((int)c->parallel_stats.size(), stats_max);
+
+    for (int i = 0; i < count; i++)
+    {
+        stats[i] = c->parallel_stats[i];
+    }
+
+    return c->parallel_stats.size();
+}
+
+extern "C" void reil_get_stats(reil_t reil, reil_stats_t *stats)
+{
+    reil_context *c = (reil_context *)reil;
+    assert(c);
+
+    c->translator->get_stats(stats);
+}
+
+extern "C" int reil_set_disk_cache(reil_t reil, const char *path, unsigned long long max_size)
+{
+    reil_context *c = (reil_context *)reil;
+    assert(c);
+
+    // NULL path disables on-disk cache
+    return c->translator->set_disk_cache(path, max_size) ? 0 : REIL_ERROR;
+}
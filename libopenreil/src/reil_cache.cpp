@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <direct.h>
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#endif
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+// OpenREIL includes
+#include "libopenreil.h"
+#include "reil_cache.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+typedef struct _reil_disk_cache_file
+{
+    time_t time;
+    unsigned long long size;
+    string path;
+
+} reil_disk_cache_file;
+
+static bool cache_file_older(const reil_disk_cache_file &a, const reil_disk_cache_file &b)
+{
+    return a.time < b.time;
+}
+
+// FNV-1a
+static uint64_t cache_hash(const char *data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ (uint8_t)data[i]) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static int cache_mkdir(const char *path)
+{
+
+#ifdef _WIN32
+
+    return _mkdir(path);
+
+#else
+
+    return mkdir(path, 0777);
+
+#endif
+
+}
+
+static void cache_touch(const char *path)
+{
+
+#ifdef _WIN32
+
+    _utime(path, NULL);
+
+#else
+
+    utime(path, NULL);
+
+#endif
+
+}
+
+// atomically replace destination file if it exists
+static bool cache_replace(const char *src, const char *dst)
+{
+
+#ifdef _WIN32
+
+    return MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING) != 0;
+
+#else
+
+    return rename(src, dst) == 0;
+
+#endif
+
+}
+
+// get names of all directory entries except "." and ".."
+static bool cache_list_dir(const string &path, vector<string> &names)
+{
+
+#ifdef _WIN32
+
+    WIN32_FIND_DATAA data;
+    string mask = path + "/*";
+
+    HANDLE find = FindFirstFileA(mask.c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    do
+    {
+        if (strcmp(data.cFileName, ".") && strcmp(data.cFileName, ".."))
+        {
+            names.push_back(data.cFileName);
+        }
+    }
+    while (FindNextFileA(find, &data));
+
+    FindClose(find);
+
+#else
+
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL)
+    {
+        return false;
+    }
+
+    struct dirent *entry = NULL;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
+        {
+            names.push_back(entry->d_name);
+        }
+    }
+
+    closedir(dir);
+
+#endif
+
+    return true;
+}
+
+static bool cache_read(int fd, char *buff, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = read(fd, buff, size);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR) continue;
+
+            return false;
+        }
+
+        buff += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+static bool cache_write(int fd, const char *buff, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = write(fd, buff, size);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR) continue;
+
+            return false;
+        }
+
+        buff += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+CReilDiskCache::CReilDiskCache(const char *path, unsigned long long max_size)
+{
+    this->path = string(path);
+    this->max_size = max_size == 0 ? REIL_DISK_CACHE_DEF_SIZE : max_size;
+
+    written = 0;
+    temp_count = 0;
+}
+
+bool CReilDiskCache::check(void)
+{
+    struct stat st;
+
+    if (cache_mkdir(path.c_str()) != 0 && errno != EEXIST)
+    {
+        return false;
+    }
+
+    if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        return false;
+    }
+
+#ifdef _WIN32
+
+    // there's no execute permission for directories
+    return _access(path.c_str(), 06) == 0;
+
+#else
+
+    return access(path.c_str(), R_OK | W_OK | X_OK) == 0;
+
+#endif
+
+}
+
+string CReilDiskCache::entry_path(string &key, string &dir)
+{
+    char name[0x20];
+    uint64_t hash = cache_hash(key.data(), key.size());
+
+    // use the first byte of hash as subdirectory name
+    sprintf(name, "%.2x", (unsigned int)(hash >> 56));
+    dir = path + "/" + name;
+
+    sprintf(name, "%.14llx", (unsigned long long)(hash & 0x00ffffffffffffffULL));
+
+    return dir + "/" + name;
+}
+
+bool CReilDiskCache::load(string &key, reil_addr_t *addr, vector<reil_inst_t> &insts, vector<uint8_t> &relocs)
+{
+    string dir;
+    string file = entry_path(key, dir);
+    struct stat st;
+
+    int fd = open(file.c_str(), O_RDONLY | O_BINARY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(reil_disk_cache_hdr))
+    {
+        close(fd);
+        return false;
+    }
+
+    vector<char> buff(st.st_size);
+    bool ok = cache_read(fd, &buff[0], buff.size());
+
+    close(fd);
+
+    if (!ok)
+    {
+        return false;
+    }
+
+    reil_disk_cache_hdr *hdr = (reil_disk_cache_hdr *)&buff[0];
+    char *data = &buff[0] + sizeof(reil_disk_cache_hdr);
+    size_t size = buff.size() - sizeof(reil_disk_cache_hdr);
+
+    // entry might be damaged or it's a hash collision
+    if (hdr->magic != REIL_DISK_CACHE_MAGIC || hdr->key_size != key.size() ||
+        size != key.size() + (size_t)hdr->insts_count * (sizeof(reil_inst_t) + 1) ||
+        hdr->checksum != (uint32_t)cache_hash(data, size) ||
+        memcmp(data, key.data(), key.size()) != 0)
+    {
+        return false;
+    }
+
+    data += key.size();
+
+    insts.resize(hdr->insts_count);
+    relocs.resize(hdr->insts_count);
+
+    for (uint32_t i = 0; i < hdr->insts_count; i++)
+    {
+        memcpy(&insts[i], data + i * sizeof(reil_inst_t), sizeof(reil_inst_t));
+
+        // pointers are set when cached instruction is replayed
+        insts[i].raw_info.data = NULL;
+        insts[i].raw_info.str_mnem = insts[i].raw_info.str_op = NULL;
+
+        relocs[i] = (uint8_t)data[hdr->insts_count * sizeof(reil_inst_t) + i];
+    }
+
+    *addr = hdr->addr;
+
+    if (time(NULL) - st.st_mtime > REIL_DISK_CACHE_TOUCH_TIME)
+    {
+        // entry was used recently, keep it away from eviction
+        cache_touch(file.c_str());
+    }
+
+    return true;
+}
+
+void CReilDiskCache::store(string &key, reil_addr_t addr, vector<reil_inst_t> &insts, vector<uint8_t> &relocs)
+{
+    assert(insts.size() == relocs.size());
+
+    string dir;
+    string file = entry_path(key, dir);
+    char name[0x40];
+
+    reil_disk_cache_hdr hdr;
+    size_t size = sizeof(hdr) + key.size() + insts.size() * (sizeof(reil_inst_t) + 1);
+    vector<char> buff(size);
+    char *data = &buff[0] + sizeof(hdr);
+
+    memcpy(data, key.data(), key.size());
+
+    for (size_t i = 0; i < insts.size(); i++)
+    {
+        reil_inst_t inst = insts[i];
+
+        // pointers are valid only in the current process
+        inst.raw_info.data = NULL;
+        inst.raw_info.str_mnem = inst.raw_info.str_op = NULL;
+
+        memcpy(data + key.size() + i * sizeof(reil_inst_t), &inst, sizeof(reil_inst_t));
+        data[key.size() + insts.size() * sizeof(reil_inst_t) + i] = (char)relocs[i];
+    }
+
+    hdr.magic = REIL_DISK_CACHE_MAGIC;
+    hdr.key_size = key.size();
+    hdr.insts_count = insts.size();
+    hdr.checksum = (uint32_t)cache_hash(data, size - sizeof(hdr));
+    hdr.addr = addr;
+
+    memcpy(&buff[0], &hdr, sizeof(hdr));
+
+    if (cache_mkdir(dir.c_str()) != 0 && errno != EEXIST)
+    {
+        return;
+    }
+
+    // temp name must be unique for each writer
+    sprintf(name, "/.%d_%lx_%x", (int)getpid(), (unsigned long)(size_t)this, temp_count++);
+    string temp = dir + name;
+
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0666);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    bool ok = cache_write(fd, &buff[0], buff.size());
+
+    close(fd);
+
+    // existing entry for the same key will be replaced
+    if (!ok || !cache_replace(temp.c_str(), file.c_str()))
+    {
+        unlink(temp.c_str());
+        return;
+    }
+
+    written += size;
+
+    if (written >= max_size / REIL_DISK_CACHE_CHECK_DIV)
+    {
+        written = 0;
+        evict();
+    }
+}
+
+void CReilDiskCache::evict(void)
+{
+    vector<reil_disk_cache_file> files;
+    unsigned long long total = 0;
+    time_t now = time(NULL);
+
+    vector<string> subdirs;
+
+    if (!cache_list_dir(path, subdirs))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < subdirs.size(); i++)
+    {
+        vector<string> entries;
+
+        if (subdirs[i][0] == '.')
+        {
+            continue;
+        }
+
+        string dir = path + "/" + subdirs[i];
+
+        if (!cache_list_dir(dir, entries))
+        {
+            continue;
+        }
+
+        for (size_t n = 0; n < entries.size(); n++)
+        {
+            reil_disk_cache_file file;
+            struct stat st;
+
+            file.path = dir + "/" + entries[n];
+
+            if (stat(file.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            {
+                continue;
+            }
+
+            if (entries[n][0] == '.')
+            {
+                // temp file that was left by crashed writer
+                if (now - st.st_mtime > REIL_DISK_CACHE_TEMP_TIME)
+                {
+                    unlink(file.path.c_str());
+                }
+
+                continue;
+            }
+
+            file.time = st.st_mtime;
+            file.size = st.st_size;
+
+            total += file.size;
+            files.push_back(file);
+        }
+    }
+
+    if (total <= max_size)
+    {
+        return;
+    }
+
+    sort(files.begin(), files.end(), cache_file_older);
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (total <= max_size / REIL_DISK_CACHE_KEEP_DIV * REIL_DISK_CACHE_KEEP_NUM)
+        {
+            break;
+        }
+
+        // other processes might be removing the same files
+        unlink(files[i].path.c_str());
+        total -= files[i].size;
+    }
+}
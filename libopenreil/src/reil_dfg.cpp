@@ -0,0 +1,527 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+
+using namespace std;
+
+// OpenREIL includes
+#include "libopenreil.h"
+#include "reil_dfg.h"
+
+// registers that can be read or written by called function, see DFGraphBuilder in pyopenreil
+const reil_reg_t reil_dfg_call_regs_x86[] =
+{
+    REIL_X86_EAX, REIL_X86_EBX, REIL_X86_ECX, REIL_X86_EDX,
+    REIL_X86_ESI, REIL_X86_EDI, REIL_X86_EBP, REIL_X86_ESP, REIL_REG_NONE
+};
+
+static inline bool dfg_is_var(reil_arg_t *arg)
+{
+    return arg->type == A_REG || arg->type == A_TEMP;
+}
+
+static inline reil_dfg_word dfg_bit(int n)
+{
+    return (reil_dfg_word)1 << (n % REIL_DFG_WORD_BITS);
+}
+
+static inline void dfg_bit_set(reil_dfg_word *bits, int n)
+{
+    bits[n / REIL_DFG_WORD_BITS] |= dfg_bit(n);
+}
+
+// clear bits in range [first, last)
+static void dfg_bits_clear(reil_dfg_word *bits, int first, int last)
+{
+    int n = first;
+
+    while (n < last)
+    {
+        if (n % REIL_DFG_WORD_BITS == 0 && last - n >= REIL_DFG_WORD_BITS)
+        {
+            bits[n / REIL_DFG_WORD_BITS] = 0;
+            n += REIL_DFG_WORD_BITS;
+        }
+        else
+        {
+            bits[n / REIL_DFG_WORD_BITS] &= ~dfg_bit(n);
+            n += 1;
+        }
+    }
+}
+
+CReilDataFlow::CReilDataFlow(reil_arch_t arch)
+{
+    assert(arch == ARCH_X86);
+
+    this->arch = arch;
+    words = 0;
+}
+
+int CReilDataFlow::var_index(const char *name)
+{
+    map<string, int>::iterator it = vars_index.find(name);
+    if (it != vars_index.end())
+    {
+        return it->second;
+    }
+
+    vars_index[name] = vars.size();
+    vars.push_back(name);
+
+    return vars.size() - 1;
+}
+
+void CReilDataFlow::collect(reil_func_t *func)
+{
+    vars.clear();
+    vars_index.clear();
+    call_vars.clear();
+
+    uses_first.clear();
+    uses.clear();
+    defs_first.clear();
+    defs.clear();
+
+    for (int i = 0; i < func->insts_count; i++)
+    {
+        reil_inst_t *inst = &func->insts[i];
+        reil_arg_t *src[3], *dst = NULL;
+        int src_count = 0;
+
+        uses_first.push_back(uses.size());
+        defs_first.push_back(defs.size());
+
+        if (inst->flags & IOPT_CALL)
+        {
+            if (call_vars.size() == 0)
+            {
+                for (int n = 0; reil_dfg_call_regs_x86[n] != REIL_REG_NONE; n++)
+                {
+                    call_vars.push_back(var_index(reil_reg_info(arch, reil_dfg_call_regs_x86[n])->name));
+                }
+            }
+
+            // called function can read and write all general purpose registers
+            uses.insert(uses.end(), call_vars.begin(), call_vars.end());
+            defs.insert(defs.end(), call_vars.begin(), call_vars.end());
+
+            continue;
+        }
+
+        if (inst->op == I_NONE)
+        {
+            continue;
+        }
+        else if (inst->op == I_UNK)
+        {
+            // operands of unknown instruction
+            src[src_count++] = &inst->a;
+            dst = &inst->c;
+        }
+        else
+        {
+            src[src_count++] = &inst->a;
+            src[src_count++] = &inst->b;
+
+            if (inst->op == I_JCC || inst->op == I_STM)
+            {
+                src[src_count++] = &inst->c;
+            }
+            else
+            {
+                dst = &inst->c;
+            }
+        }
+
+        for (int n = 0; n < src_count; n++)
+        {
+            if (dfg_is_var(src[n]))
+            {
+                int var = var_index(src[n]->name);
+
+                // the same variable might be used twice
+                if (find(uses.begin() + uses_first.back(), uses.end(), var) == uses.end())
+                {
+                    uses.push_back(var);
+                }
+            }
+        }
+
+        if (dst && dfg_is_var(dst))
+        {
+            defs.push_back(var_index(dst->name));
+        }
+    }
+
+    uses_first.push_back(uses.size());
+    defs_first.push_back(defs.size());
+
+    // number of definition sites of each variable
+    vector<int> next(vars.size(), 1);
+
+    for (size_t n = 0; n < defs.size(); n++)
+    {
+        next[defs[n]] += 1;
+    }
+
+    var_bits.resize(vars.size() + 1);
+    var_bits[0] = 0;
+
+    for (size_t v = 0; v < vars.size(); v++)
+    {
+        var_bits[v + 1] = var_bits[v] + next[v];
+        next[v] = var_bits[v] + 1;
+    }
+
+    bit_inst.assign(var_bits.back(), REIL_DFG_ENTRY);
+    defs_bit.resize(defs.size());
+
+    for (int i = 0; i < func->insts_count; i++)
+    {
+        for (int n = defs_first[i]; n < defs_first[i + 1]; n++)
+        {
+            defs_bit[n] = next[defs[n]]++;
+            bit_inst[defs_bit[n]] = i;
+        }
+    }
+
+    words = var_bits.back() / REIL_DFG_WORD_BITS + 1;
+}
+
+void CReilDataFlow::order(reil_func_t *func)
+{
+    vector<pair<int, int> > stack;
+    vector<bool> visited(func->bbs_count, false);
+
+    rpo.clear();
+    rpo_index.assign(func->bbs_count, -1);
+
+    stack.push_back(make_pair(func->entry, 0));
+    visited[func->entry] = true;
+
+    // iterative DFS, rpo is filled in postorder first
+    while (stack.size() > 0)
+    {
+        reil_func_bb_t *bb = &func->bbs[stack.back().first];
+        int n = stack.back().second;
+
+        if (n < bb->succ_count)
+        {
+            int succ = func->succ[bb->succ + n];
+
+            stack.back().second += 1;
+
+            if (!visited[succ])
+            {
+                visited[succ] = true;
+                stack.push_back(make_pair(succ, 0));
+            }
+        }
+        else
+        {
+            rpo.push_back(stack.back().first);
+            stack.pop_back();
+        }
+    }
+
+    reverse(rpo.begin(), rpo.end());
+
+    for (size_t n = 0; n < rpo.size(); n++)
+    {
+        rpo_index[rpo[n]] = n;
+    }
+
+    // predecessors of each basic block
+    preds_first.assign(func->bbs_count + 1, 0);
+
+    for (int n = 0; n < func->succ_count; n++)
+    {
+        preds_first[func->succ[n] + 1] += 1;
+    }
+
+    for (int n = 0; n < func->bbs_count; n++)
+    {
+        preds_first[n + 1] += preds_first[n];
+    }
+
+    vector<int> next(preds_first.begin(), preds_first.end() - 1);
+    preds.resize(func->succ_count);
+
+    for (int n = 0; n < func->bbs_count; n++)
+    {
+        reil_func_bb_t *bb = &func->bbs[n];
+
+        for (int s = bb->succ; s < bb->succ + bb->succ_count; s++)
+        {
+            preds[next[func->succ[s]]++] = n;
+        }
+    }
+}
+
+void CReilDataFlow::block_in(reil_func_t *func, int bb, reil_dfg_word *in)
+{
+    memset(in, 0, words * sizeof(reil_dfg_word));
+
+    for (int n = preds_first[bb]; n < preds_first[bb + 1]; n++)
+    {
+        int pred = preds[n];
+        if (rpo_index[pred] == -1)
+        {
+            continue;
+        }
+
+        reil_dfg_word *pred_out = &out[pred * words];
+
+        for (int w = 0; w < words; w++)
+        {
+            in[w] |= pred_out[w];
+        }
+    }
+
+    if (bb == func->entry)
+    {
+        // all variables are defined at the function entry
+        for (size_t v = 0; v < vars.size(); v++)
+        {
+            dfg_bit_set(in, var_bits[v]);
+        }
+    }
+}
+
+void CReilDataFlow::solve(reil_func_t *func)
+{
+    vector<int> gen_first, gen_var, gen_bit, last(vars.size(), -1);
+
+    // the last definition of each variable in basic block
+    for (int bb = 0; bb < func->bbs_count; bb++)
+    {
+        reil_func_bb_t *info = &func->bbs[bb];
+
+        gen_first.push_back(gen_var.size());
+
+        for (int i = info->first; i < info->first + info->count; i++)
+        {
+            for (int n = defs_first[i]; n < defs_first[i + 1]; n++)
+            {
+                int var = defs[n];
+
+                if (last[var] == -1)
+                {
+                    gen_var.push_back(var);
+                    gen_bit.push_back(0);
+                }
+
+                last[var] = defs_bit[n];
+            }
+        }
+
+        for (size_t n = gen_first.back(); n < gen_var.size(); n++)
+        {
+            gen_bit[n] = last[gen_var[n]];
+            last[gen_var[n]] = -1;
+        }
+    }
+
+    gen_first.push_back(gen_var.size());
+
+    out.assign(func->bbs_count * words, 0);
+
+    vector<reil_dfg_word> in(words);
+    set<int> worklist;
+
+    for (size_t n = 0; n < rpo.size(); n++)
+    {
+        worklist.insert(n);
+    }
+
+    // worklist is processed in reverse postorder
+    while (worklist.size() > 0)
+    {
+        int bb = rpo[*worklist.begin()];
+        worklist.erase(worklist.begin());
+
+        block_in(func, bb, &in[0]);
+
+        for (int n = gen_first[bb]; n < gen_first[bb + 1]; n++)
+        {
+            // definition kills all of the other definitions of the same variable
+            dfg_bits_clear(&in[0], var_bits[gen_var[n]], var_bits[gen_var[n] + 1]);
+            dfg_bit_set(&in[0], gen_bit[n]);
+        }
+
+        if (memcmp(&in[0], &out[bb * words], words * sizeof(reil_dfg_word)) == 0)
+        {
+            continue;
+        }
+
+        memcpy(&out[bb * words], &in[0], words * sizeof(reil_dfg_word));
+
+        reil_func_bb_t *info = &func->bbs[bb];
+
+        for (int s = info->succ; s < info->succ + info->succ_count; s++)
+        {
+            worklist.insert(rpo_index[func->succ[s]]);
+        }
+    }
+}
+
+void CReilDataFlow::add_edge(int def_inst, int use_inst, int var)
+{
+    reil_dfg_edge_t edge;
+    edge.def_inst = def_inst;
+    edge.use_inst = use_inst;
+    edge.var = var;
+
+    edges.push_back(edge);
+}
+
+void CReilDataFlow::emit(reil_func_t *func)
+{
+    vector<reil_dfg_word> in(words);
+    vector<int> local(vars.size(), -1), touched;
+
+    for (int bb = 0; bb < func->bbs_count; bb++)
+    {
+        reil_func_bb_t *info = &func->bbs[bb];
+
+        if (rpo_index[bb] == -1)
+        {
+            // not reachable from entry
+            continue;
+        }
+
+        block_in(func, bb, &in[0]);
+
+        for (int i = info->first; i < info->first + info->count; i++)
+        {
+            for (int n = uses_first[i]; n < uses_first[i + 1]; n++)
+            {
+                int var = uses[n];
+
+                if (local[var] != -1)
+                {
+                    // variable was defined in the same basic block
+                    add_edge(bit_inst[local[var]], i, var);
+                    continue;
+                }
+
+                for (int bit = var_bits[var]; bit < var_bits[var + 1]; bit++)
+                {
+                    reil_dfg_word word = in[bit / REIL_DFG_WORD_BITS];
+
+                    if (word == 0)
+                    {
+                        // skip to the next word
+                        bit |= REIL_DFG_WORD_BITS - 1;
+                    }
+                    else if (word & dfg_bit(bit))
+                    {
+                        add_edge(bit_inst[bit], i, var);
+                    }
+                }
+            }
+
+            for (int n = defs_first[i]; n < defs_first[i + 1]; n++)
+            {
+                if (local[defs[n]] == -1)
+                {
+                    touched.push_back(defs[n]);
+                }
+
+                local[defs[n]] = defs_bit[n];
+            }
+        }
+
+        if (info->succ_count == 0)
+        {
+            // definitions that live at the function exit
+            for (size_t var = 0; var < vars.size(); var++)
+            {
+                if (local[var] != -1)
+                {
+                    add_edge(bit_inst[local[var]], REIL_DFG_EXIT, var);
+                    continue;
+                }
+
+                for (int bit = var_bits[var] + 1; bit < var_bits[var + 1]; bit++)
+                {
+                    reil_dfg_word word = in[bit / REIL_DFG_WORD_BITS];
+
+                    if (word == 0)
+                    {
+                        bit |= REIL_DFG_WORD_BITS - 1;
+                    }
+                    else if (word & dfg_bit(bit))
+                    {
+                        add_edge(bit_inst[bit], REIL_DFG_EXIT, var);
+                    }
+                }
+            }
+        }
+
+        for (size_t n = 0; n < touched.size(); n++)
+        {
+            local[touched[n]] = -1;
+        }
+
+        touched.clear();
+    }
+}
+
+int CReilDataFlow::build(reil_func_t *func)
+{
+    assert(func->entry >= 0 && func->entry < func->bbs_count);
+
+    edges.clear();
+
+    collect(func);
+    order(func);
+    solve(func);
+    emit(func);
+
+    return edges.size();
+}
+
+extern "C" reil_dfg_t reil_dfg_init(reil_arch_t arch)
+{
+    CReilDataFlow *dfg = new CReilDataFlow(arch);
+    assert(dfg);
+
+    return dfg;
+}
+
+extern "C" void reil_dfg_close(reil_dfg_t dfg)
+{
+    delete (CReilDataFlow *)dfg;
+}
+
+extern "C" int reil_dfg_build(reil_dfg_t dfg, reil_func_t *func, reil_dfg_edge_t **edges)
+{
+    CReilDataFlow *c = (CReilDataFlow *)dfg;
+    assert(c);
+    assert(func);
+
+    int count = c->build(func);
+
+    *edges = count > 0 ? &c->edges[0] : NULL;
+
+    return count;
+}
+
+extern "C" int reil_dfg_var_count(reil_dfg_t dfg)
+{
+    return ((CReilDataFlow *)dfg)->var_count();
+}
+
+extern "C" const char *reil_dfg_var_name(reil_dfg_t dfg, int var)
+{
+    return ((CReilDataFlow *)dfg)->var_name(var);
+}
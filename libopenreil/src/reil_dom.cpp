@@ -0,0 +1,505 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+// OpenREIL includes
+#include "libopenreil.h"
+#include "reil_dom.h"
+
+void reil_dom_group(int keys_count, vector<pair<int, int> > &pairs, vector<int> &first, vector<int> &items)
+{
+    first.assign(keys_count + 1, 0);
+
+    for (size_t n = 0; n < pairs.size(); n++)
+    {
+        first[pairs[n].first + 1] += 1;
+    }
+
+    for (int n = 0; n < keys_count; n++)
+    {
+        first[n + 1] += first[n];
+    }
+
+    vector<int> next(first.begin(), first.end() - 1);
+    items.resize(pairs.size());
+
+    for (size_t n = 0; n < pairs.size(); n++)
+    {
+        items[next[pairs[n].first]++] = pairs[n].second;
+    }
+}
+
+void CReilDominators::order(int nodes_count, int entry, const int *succ_first, const int *succ)
+{
+    vector<pair<int, int> > stack;
+
+    rpo.clear();
+    rpo_index.assign(nodes_count, -1);
+
+    dfs.clear();
+    dfs_parent.assign(nodes_count, -1);
+
+    // -2 marks visited nodes that are not numbered yet
+    stack.push_back(make_pair(entry, succ_first[entry]));
+    rpo_index[entry] = -2;
+    dfs.push_back(entry);
+
+    // iterative DFS, rpo is filled in postorder first
+    while (stack.size() > 0)
+    {
+        int node = stack.back().first;
+        int n = stack.back().second;
+
+        if (n < succ_first[node + 1])
+        {
+            stack.back().second += 1;
+
+            if (rpo_index[succ[n]] == -1)
+            {
+                rpo_index[succ[n]] = -2;
+                stack.push_back(make_pair(succ[n], succ_first[succ[n]]));
+
+                dfs.push_back(succ[n]);
+                dfs_parent[succ[n]] = node;
+            }
+        }
+        else
+        {
+            rpo.push_back(node);
+            stack.pop_back();
+        }
+    }
+
+    reverse(rpo.begin(), rpo.end());
+
+    for (size_t n = 0; n < rpo.size(); n++)
+    {
+        rpo_index[rpo[n]] = n;
+    }
+
+    // predecessors of each node, edges from unreachable nodes are ignored
+    preds_first.assign(nodes_count + 1, 0);
+
+    for (size_t n = 0; n < rpo.size(); n++)
+    {
+        for (int s = succ_first[rpo[n]]; s < succ_first[rpo[n] + 1]; s++)
+        {
+            preds_first[succ[s] + 1] += 1;
+        }
+    }
+
+    for (int n = 0; n < nodes_count; n++)
+    {
+        preds_first[n + 1] += preds_first[n];
+    }
+
+    vector<int> next(preds_first.begin(), preds_first.end() - 1);
+    preds.resize(preds_first.back());
+
+    for (int node = 0; node < nodes_count; node++)
+    {
+        if (rpo_index[node] == -1)
+        {
+            continue;
+        }
+
+        for (int s = succ_first[node]; s < succ_first[node + 1]; s++)
+        {
+            preds[next[succ[s]]++] = node;
+        }
+    }
+}
+
+int CReilDominators::eval(int node)
+{
+    if (ancestor[node] == -1)
+    {
+        return node;
+    }
+
+    path.clear();
+
+    // ancestors of the forest root are not compressed
+    for (int v = node; ancestor[ancestor[v]] != -1; v = ancestor[v])
+    {
+        path.push_back(v);
+    }
+
+    // compress path starting from the top
+    for (int n = path.size() - 1; n >= 0; n--)
+    {
+        int v = path[n], a = ancestor[v];
+
+        if (semi[label[a]] < semi[label[v]]) label[v] = label[a];
+
+        ancestor[v] = ancestor[a];
+    }
+
+    return label[node];
+}
+
+int CReilDominators::build(int nodes_count, int entry, const int *succ_first, const int *succ)
+{
+    assert(entry >= 0 && entry < nodes_count);
+
+    order(nodes_count, entry, succ_first, succ);
+
+    vector<int> bucket(nodes_count, -1), bucket_next(nodes_count, -1);
+
+    semi.assign(nodes_count, -1);
+    label.resize(nodes_count);
+    ancestor.assign(nodes_count, -1);
+    idom.assign(nodes_count, -1);
+
+    for (size_t n = 0; n < dfs.size(); n++)
+    {
+        semi[dfs[n]] = n;
+        label[dfs[n]] = dfs[n];
+    }
+
+    // semidominators are computed in reverse preorder of DFS tree
+    for (int n = dfs.size() - 1; n > 0; n--)
+    {
+        int node = dfs[n], parent = dfs_parent[node];
+
+        for (int p = preds_first[node]; p < preds_first[node + 1]; p++)
+        {
+            int u = eval(preds[p]);
+
+            if (semi[u] < semi[node]) semi[node] = semi[u];
+        }
+
+        // idom of node will be found when its semidominator is linked
+        bucket_next[node] = bucket[dfs[semi[node]]];
+        bucket[dfs[semi[node]]] = node;
+
+        ancestor[node] = parent;
+
+        for (int v = bucket[parent]; v != -1; v = bucket_next[v])
+        {
+            int u = eval(v);
+
+            idom[v] = semi[u] < semi[v] ? u : parent;
+        }
+
+        bucket[parent] = -1;
+    }
+
+    for (size_t n = 1; n < dfs.size(); n++)
+    {
+        int node = dfs[n];
+
+        if (idom[node] != dfs[semi[node]]) idom[node] = idom[idom[node]];
+    }
+
+    idom[entry] = -1;
+
+    vector<pair<int, int> > pairs;
+
+    // build dominator tree, children are going in reverse postorder
+    for (size_t n = 1; n < rpo.size(); n++)
+    {
+        pairs.push_back(make_pair(idom[rpo[n]], rpo[n]));
+    }
+
+    reil_dom_group(nodes_count, pairs, children_first, children);
+
+    number(entry);
+
+    return rpo.size();
+}
+
+void CReilDominators::number(int entry)
+{
+    vector<pair<int, int> > stack;
+    int counter = 0;
+
+    pre.assign(idom.size(), -1);
+    post.assign(idom.size(), -1);
+
+    pre[entry] = counter++;
+    stack.push_back(make_pair(entry, children_first[entry]));
+
+    // node dominates all of the nodes that were numbered between its pre and post
+    while (stack.size() > 0)
+    {
+        int node = stack.back().first;
+        int n = stack.back().second;
+
+        if (n < children_first[node + 1])
+        {
+            stack.back().second += 1;
+
+            pre[children[n]] = counter++;
+            stack.push_back(make_pair(children[n], children_first[children[n]]));
+        }
+        else
+        {
+            post[node] = counter++;
+            stack.pop_back();
+        }
+    }
+}
+
+int CReilDominators::build(reil_func_t *func)
+{
+    vector<int> succ_first(func->bbs_count + 1), succ;
+
+    // basic blocks might refer to the successor ranges in any order
+    for (int n = 0; n < func->bbs_count; n++)
+    {
+        reil_func_bb_t *bb = &func->bbs[n];
+
+        succ_first[n] = succ.size();
+        succ.insert(succ.end(), func->succ + bb->succ, func->succ + bb->succ + bb->succ_count);
+    }
+
+    succ_first[func->bbs_count] = succ.size();
+    succ.push_back(-1);
+
+    return build(func->bbs_count, func->entry, &succ_first[0], &succ[0]);
+}
+
+void CReilDomInfo::post_dominators(reil_func_t *func)
+{
+    int exit = func->bbs_count;
+    vector<int> succ_first(func->bbs_count + 2), succ;
+
+    // reversed CFG with virtual exit node that precedes all of the exit blocks
+    for (int n = 0; n < func->bbs_count; n++)
+    {
+        succ_first[n] = succ.size();
+        succ.insert(succ.end(), dom.preds.begin() + dom.preds_first[n], dom.preds.begin() + dom.preds_first[n + 1]);
+    }
+
+    succ_first[exit] = succ.size();
+
+    for (int n = 0; n < func->bbs_count; n++)
+    {
+        if (dom.reachable(n) && func->bbs[n].succ_count == 0)
+        {
+            succ.push_back(n);
+        }
+    }
+
+    succ_first[exit + 1] = succ.size();
+    succ.push_back(-1);
+
+    pdom.build(func->bbs_count + 1, exit, &succ_first[0], &succ[0]);
+
+    ipdom.assign(func->bbs_count, -1);
+
+    for (int n = 0; n < func->bbs_count; n++)
+    {
+        if (pdom.idom[n] != exit) ipdom[n] = pdom.idom[n];
+    }
+}
+
+int CReilDomInfo::loop_root(int loop)
+{
+    int root = loop;
+
+    while (loop_link[root] != root) root = loop_link[root];
+
+    // path compression
+    while (loop_link[loop] != root)
+    {
+        int next = loop_link[loop];
+
+        loop_link[loop] = root;
+        loop = next;
+    }
+
+    return root;
+}
+
+void CReilDomInfo::find_loops(reil_func_t *func)
+{
+    vector<reil_loop_t> found;
+    vector<int> owner(func->bbs_count, -1), worklist;
+
+    loop_link.clear();
+
+    // headers of nested loops are going after the enclosing ones in reverse postorder
+    for (int n = dom.rpo.size() - 1; n >= 0; n--)
+    {
+        int header = dom.rpo[n], loop = found.size();
+
+        for (int p = dom.preds_first[header]; p < dom.preds_first[header + 1]; p++)
+        {
+            // back edge
+            if (dom.dominates(header, dom.preds[p])) worklist.push_back(dom.preds[p]);
+        }
+
+        if (worklist.size() == 0)
+        {
+            continue;
+        }
+
+        reil_loop_t info;
+        info.header = header;
+        info.parent = -1;
+        info.depth = info.bbs = info.bbs_count = 0;
+
+        found.push_back(info);
+        loop_link.push_back(loop);
+        owner[header] = loop;
+
+        // walk backwards from the back edges until the loop header
+        while (worklist.size() > 0)
+        {
+            int bb = worklist.back(), first = -1;
+            worklist.pop_back();
+
+            if (owner[bb] == -1)
+            {
+                owner[bb] = loop;
+                first = bb;
+            }
+            else
+            {
+                int inner = loop_root(owner[bb]);
+                if (inner == loop)
+                {
+                    continue;
+                }
+
+                // loop that was found before is nested into this one
+                found[inner].parent = loop_link[inner] = loop;
+                first = found[inner].header;
+            }
+
+            worklist.insert(worklist.end(), dom.preds.begin() + dom.preds_first[first],
+                                            dom.preds.begin() + dom.preds_first[first + 1]);
+        }
+    }
+
+    int count = found.size();
+    vector<pair<int, int> > pairs;
+    vector<int> children_first, children, bbs_first, bbs, index(count, -1);
+
+    // nested loops of each loop ordered by header, count stands for the outermost level
+    for (int loop = count - 1; loop >= 0; loop--)
+    {
+        pairs.push_back(make_pair(found[loop].parent == -1 ? count : found[loop].parent, loop));
+    }
+
+    reil_dom_group(count + 1, pairs, children_first, children);
+
+    pairs.clear();
+
+    for (int bb = 0; bb < func->bbs_count; bb++)
+    {
+        if (owner[bb] != -1) pairs.push_back(make_pair(owner[bb], bb));
+    }
+
+    // basic blocks that are not a part of nested loops
+    reil_dom_group(count, pairs, bbs_first, bbs);
+
+    vector<pair<int, int> > stack;
+
+    loops.clear();
+    loop_bbs.clear();
+
+    stack.push_back(make_pair(count, children_first[count]));
+
+    // preorder traversal of the loop nesting tree
+    while (stack.size() > 0)
+    {
+        int loop = stack.back().first;
+        int n = stack.back().second;
+
+        if (n < children_first[loop + 1])
+        {
+            int child = children[n];
+            reil_loop_t info = found[child];
+
+            stack.back().second += 1;
+
+            index[child] = loops.size();
+
+            info.parent = info.parent == -1 ? -1 : index[info.parent];
+            info.depth = info.parent == -1 ? 1 : loops[info.parent].depth + 1;
+            info.bbs = loop_bbs.size();
+
+            loops.push_back(info);
+            loop_bbs.insert(loop_bbs.end(), bbs.begin() + bbs_first[child], bbs.begin() + bbs_first[child + 1]);
+
+            stack.push_back(make_pair(child, children_first[child]));
+        }
+        else
+        {
+            if (loop != count)
+            {
+                // all of the nested loops were visited
+                loops[index[loop]].bbs_count = loop_bbs.size() - loops[index[loop]].bbs;
+            }
+
+            stack.pop_back();
+        }
+    }
+
+    bb_loop.assign(func->bbs_count, -1);
+
+    for (int bb = 0; bb < func->bbs_count; bb++)
+    {
+        if (owner[bb] != -1) bb_loop[bb] = index[owner[bb]];
+    }
+}
+
+void CReilDomInfo::build(reil_func_t *func, reil_dom_func_t *dom_func)
+{
+    assert(func->entry >= 0 && func->entry < func->bbs_count);
+
+    dom.build(func);
+
+    post_dominators(func);
+    find_loops(func);
+
+    memset(dom_func, 0, sizeof(reil_dom_func_t));
+
+    dom_func->idom = &dom.idom[0];
+    dom_func->ipdom = &ipdom[0];
+    dom_func->loops = loops.size() > 0 ? &loops[0] : NULL;
+    dom_func->loops_count = loops.size();
+    dom_func->loop_bbs = loop_bbs.size() > 0 ? &loop_bbs[0] : NULL;
+    dom_func->loop_bbs_count = loop_bbs.size();
+    dom_func->bb_loop = &bb_loop[0];
+}
+
+extern "C" reil_dom_t reil_dom_init(void)
+{
+    CReilDomInfo *dom = new CReilDomInfo();
+    assert(dom);
+
+    return dom;
+}
+
+extern "C" void reil_dom_close(reil_dom_t dom)
+{
+    delete (CReilDomInfo *)dom;
+}
+
+extern "C" int reil_dom_build(reil_dom_t dom, reil_func_t *func, reil_dom_func_t *dom_func)
+{
+    CReilDomInfo *c = (CReilDomInfo *)dom;
+    assert(c);
+    assert(func);
+    assert(dom_func);
+
+    if (func->bbs_count == 0)
+    {
+        return REIL_ERROR;
+    }
+
+    c->build(func, dom_func);
+
+    return 0;
+}
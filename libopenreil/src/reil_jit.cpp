@@ -0,0 +1,641 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+// libasmir includes
+#include "libvex.h"
+
+// OpenREIL includes
+#include "libopenreil.h"
+#include "reil_vm.h"
+#include "reil_jit.h"
+
+// host registers
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RSP 4
+#define RBP 5
+#define RSI 6
+#define RDI 7
+#define R8  8
+#define R9  9
+
+// arguments of the memory access helpers
+#ifdef _WIN32
+#define ARG0 RCX
+#define ARG1 RDX
+#define ARG2 R8
+#define ARG3 R9
+#define STACK_FRAME 0x28    // shadow space for callee
+#else
+#define ARG0 RDI
+#define ARG1 RSI
+#define ARG2 RDX
+#define ARG3 RCX
+#define STACK_FRAME 0x08
+#endif
+
+#define MODRM(_mod_, _reg_, _rm_) ((uint8_t)(((_mod_) << 6) | (((_reg_) & 7) << 3) | ((_rm_) & 7)))
+
+// REX.W prefix for operations with rax, rcx and rdx
+#define REX_W 0x48
+
+#define CTX_OFFSET(_field_) ((int)offsetof(reil_jit_ctx, _field_))
+
+CReilJit::CReilJit(size_t size)
+{
+    code = code_end = ptr = NULL;
+    entry = epilogue = NULL;
+    code_size = size;
+
+#ifdef REIL_JIT_SUPPORTED
+
+#ifdef _WIN32
+
+    code = (uint8_t *)VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+
+#else
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    code = mem == MAP_FAILED ? NULL : (uint8_t *)mem;
+
+#endif
+
+    if (code == NULL)
+    {
+        fprintf(stderr, "WARNING: Unable to allocate memory for JIT code cache\n");
+        return;
+    }
+
+    code_end = code + size;
+    ptr = code;
+
+    // entry point of compiled blocks, ctx and block address are passed as arguments
+    entry = ptr;
+    emit(0x53);                                 // push rbx
+    emit(0x55);                                 // push rbp
+    emit(REX_W); emit(0x83); emit(MODRM(3, 5, RSP)); emit(STACK_FRAME);
+    emit_mov_reg(RBP, ARG0);
+    emit_ctx_access(0x8b, RBX, CTX_OFFSET(regs));
+    emit_rex(0, ARG1, false);
+    emit(0xff); emit(MODRM(3, 4, ARG1));       // jmp block
+
+    // common exit of compiled blocks
+    epilogue = ptr;
+    emit(REX_W); emit(0x83); emit(MODRM(3, 0, RSP)); emit(STACK_FRAME);
+    emit(0x5d);                                 // pop rbp
+    emit(0x5b);                                 // pop rbx
+    emit(0xc3);                                 // ret
+
+    flush();
+
+#endif // REIL_JIT_SUPPORTED
+}
+
+CReilJit::~CReilJit()
+{
+    if (code)
+    {
+
+#ifdef _WIN32
+
+        VirtualFree(code, 0, MEM_RELEASE);
+
+#else
+
+        munmap(code, code_size);
+
+#endif
+
+    }
+}
+
+void CReilJit::flush(void)
+{
+    blocks.clear();
+    links.clear();
+
+    // keep entry and epilogue code
+    ptr = epilogue ? epilogue + 16 : code;
+}
+
+void CReilJit::invalidate(reil_addr_t addr)
+{
+    if (blocks.erase(addr) == 0)
+    {
+        return;
+    }
+
+    pair<multimap<reil_addr_t, uint8_t *>::iterator,
+         multimap<reil_addr_t, uint8_t *>::iterator> range = links.equal_range(addr);
+
+    for (multimap<reil_addr_t, uint8_t *>::iterator it = range.first; it != range.second; ++it)
+    {
+        // jump to the following code that returns to the dispatcher
+        patch32(it->second, it->second + sizeof(int32_t));
+    }
+}
+
+bool CReilJit::can_compile(reil_vm_insn *insn)
+{
+    for (size_t i = 0; i < insn->insts.size(); i++)
+    {
+        reil_vm_inst *inst = &insn->insts[i];
+
+        // breakpoints and unknown instructions are handled by interpreter
+        if (inst->brk || inst->op == I_UNK || inst->op > I_LT)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CReilJit::emit32(uint32_t val)
+{
+    memcpy(ptr, &val, sizeof(val));
+    ptr += sizeof(val);
+}
+
+void CReilJit::emit64(uint64_t val)
+{
+    memcpy(ptr, &val, sizeof(val));
+    ptr += sizeof(val);
+}
+
+void CReilJit::emit_rex(int reg, int rm, bool wide)
+{
+    uint8_t rex = 0x40 | (wide ? 8 : 0) | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0);
+
+    if (rex != 0x40)
+    {
+        emit(rex);
+    }
+}
+
+void CReilJit::emit_mov_imm(int reg, reil_const_t val)
+{
+    if (val <= 0xffffffff)
+    {
+        // mov r32, imm32 clears high part of the register
+        emit_rex(0, reg, false);
+        emit(0xb8 + (reg & 7));
+        emit32((uint32_t)val);
+    }
+    else
+    {
+        emit_rex(0, reg, true);
+        emit(0xb8 + (reg & 7));
+        emit64(val);
+    }
+}
+
+void CReilJit::emit_mov_reg(int dst, int src)
+{
+    if (dst != src)
+    {
+        emit_rex(src, dst, true);
+        emit(0x89); emit(MODRM(3, src, dst));
+    }
+}
+
+void CReilJit::emit_reg_access(uint8_t opcode, int reg, int slot)
+{
+    // load or store of VM register, register file address is in rbx
+    emit_rex(reg, RBX, true);
+    emit(opcode); emit(MODRM(2, reg, RBX));
+    emit32((uint32_t)(slot * sizeof(reil_const_t)));
+}
+
+void CReilJit::emit_ctx_access(uint8_t opcode, int reg, int offset)
+{
+    // access to reil_jit_ctx field, it's address is in rbp
+    assert(offset < 0x80);
+
+    emit_rex(reg, RBP, true);
+    emit(opcode); emit(MODRM(1, reg, RBP));
+    emit((uint8_t)offset);
+}
+
+void CReilJit::emit_ctx_imm32(int offset, uint32_t val)
+{
+    assert(offset < 0x80);
+
+    emit(0xc7); emit(MODRM(1, 0, RBP));
+    emit((uint8_t)offset);
+    emit32(val);
+}
+
+void CReilJit::emit_zero_ext(int reg, int bits)
+{
+    assert(reg < 4);
+
+    switch (bits)
+    {
+    case 1: emit(0x83); emit(MODRM(3, 4, reg)); emit(0x01); break;  // and r32, 1
+    case 8: emit(0x0f); emit(0xb6); emit(MODRM(3, reg, reg)); break;    // movzx r32, r8
+    case 16: emit(0x0f); emit(0xb7); emit(MODRM(3, reg, reg)); break;   // movzx r32, r16
+    case 32: emit(0x89); emit(MODRM(3, reg, reg)); break;           // mov r32, r32
+    }
+}
+
+void CReilJit::emit_sign_ext(int reg, int bits)
+{
+    assert(reg < 4);
+
+    switch (bits)
+    {
+    case 8: emit(REX_W); emit(0x0f); emit(0xbe); emit(MODRM(3, reg, reg)); break;
+    case 16: emit(REX_W); emit(0x0f); emit(0xbf); emit(MODRM(3, reg, reg)); break;
+    case 32: emit(REX_W); emit(0x63); emit(MODRM(3, reg, reg)); break;
+    }
+}
+
+void CReilJit::emit_arg(reil_vm_arg *arg, int reg)
+{
+    switch (arg->type)
+    {
+    case A_CONST:
+
+        emit_mov_imm(reg, arg->val);
+        break;
+
+    case A_REG:
+    case A_TEMP:
+
+        emit_reg_access(0x8b, reg, arg->reg);
+        emit_zero_ext(reg, arg->bits);
+        break;
+
+    default:
+
+        emit_mov_imm(reg, 0);
+        break;
+    }
+}
+
+uint8_t *CReilJit::emit_jcc8(uint8_t opcode)
+{
+    emit(opcode);
+    emit(0);
+
+    return ptr - 1;
+}
+
+void CReilJit::patch8(uint8_t *pos)
+{
+    ptrdiff_t delta = ptr - (pos + 1);
+    assert(delta < 0x80);
+
+    *pos = (uint8_t)delta;
+}
+
+void CReilJit::patch32(uint8_t *pos, uint8_t *target)
+{
+    int32_t delta = (int32_t)(target - (pos + sizeof(int32_t)));
+
+    memcpy(pos, &delta, sizeof(delta));
+}
+
+void CReilJit::emit_jmp_epilogue(void)
+{
+    emit(0xe9);
+    emit32(0);
+    patch32(ptr - sizeof(int32_t), epilogue);
+}
+
+void CReilJit::emit_exit(reil_addr_t addr)
+{
+    map<reil_addr_t, uint8_t *>::iterator it = blocks.find(addr);
+
+    emit(0xe9);
+    emit32(0);
+
+    // will be patched when the target block is compiled or invalidated
+    links.insert(make_pair(addr, ptr - sizeof(int32_t)));
+
+    if (it != blocks.end())
+    {
+        // jump to the compiled block
+        patch32(ptr - sizeof(int32_t), it->second);
+    }
+
+    // return to the dispatcher
+    emit_mov_imm(RAX, addr);
+    emit_ctx_access(0x89, RAX, CTX_OFFSET(addr));
+    emit_ctx_imm32(CTX_OFFSET(reason), REIL_VM_NO_CODE);
+    emit_jmp_epilogue();
+}
+
+void CReilJit::emit_fault(reil_vm_insn *insn, reil_vm_inst *inst, int reason)
+{
+    // memory address is already in ctx
+    emit_ctx_imm32(CTX_OFFSET(reason), reason);
+    emit_mov_imm(RAX, insn->addr);
+    emit_ctx_access(0x89, RAX, CTX_OFFSET(addr));
+
+    // mov word [rbp + inum], imm16
+    emit(0x66); emit(0xc7); emit(MODRM(1, 0, RBP));
+    emit((uint8_t)CTX_OFFSET(inum));
+    emit(inst->inum & 0xff); emit(inst->inum >> 8);
+
+    emit_jmp_epilogue();
+}
+
+bool CReilJit::emit_inst(reil_vm_insn *insn, reil_vm_inst *inst)
+{
+    uint8_t *pos = NULL, *end = NULL, *zero = NULL;
+    int bits = max(max(inst->a.bits, inst->b.bits), 8);
+
+    switch (inst->op)
+    {
+    case I_NONE:
+
+        return true;
+
+    case I_JCC:
+
+        emit_arg(&inst->a, RAX);
+        emit(REX_W); emit(0x85); emit(0xc0);    // test rax, rax
+        pos = emit_jcc8(0x74);                  // jz
+
+        if (inst->c.type == A_CONST)
+        {
+            emit_exit(inst->c.val);
+        }
+        else
+        {
+            // jump to the address from register
+            emit_arg(&inst->c, RAX);
+            emit_ctx_access(0x89, RAX, CTX_OFFSET(addr));
+            emit_ctx_imm32(CTX_OFFSET(reason), REIL_VM_NO_CODE);
+            emit_jmp_epilogue();
+        }
+
+        patch8(pos);
+        return true;
+
+    case I_STM:
+
+        emit_arg(&inst->c, RAX);
+        emit_ctx_access(0x89, RAX, CTX_OFFSET(mem_addr));
+        emit_arg(&inst->a, RCX);
+
+        // mem_store(ctx, addr, size, val)
+        emit_mov_reg(ARG3, RCX);
+        emit_mov_reg(ARG1, RAX);
+        emit_mov_reg(ARG0, RBP);
+        emit_mov_imm(ARG2, inst->a.bits / 8);
+        emit(0xff); emit(MODRM(1, 2, RBP)); emit((uint8_t)CTX_OFFSET(mem_store));
+
+        // register file might be reallocated by the call
+        emit_ctx_access(0x8b, RBX, CTX_OFFSET(regs));
+
+        emit(0x85); emit(0xc0);                 // test eax, eax
+        pos = emit_jcc8(0x75);                  // jnz
+        emit_fault(insn, inst, REIL_VM_MEM_WRITE);
+        patch8(pos);
+        return true;
+
+    case I_LDM:
+
+        emit_arg(&inst->a, RAX);
+        emit_ctx_access(0x89, RAX, CTX_OFFSET(mem_addr));
+
+        // mem_load(ctx, addr, size, &ctx->val)
+        emit_mov_reg(ARG1, RAX);
+        emit_mov_reg(ARG0, RBP);
+        emit_mov_imm(ARG2, inst->c.bits / 8);
+        emit_ctx_access(0x8d, ARG3, CTX_OFFSET(val));
+        emit(0xff); emit(MODRM(1, 2, RBP)); emit((uint8_t)CTX_OFFSET(mem_load));
+
+        // register file might be reallocated by the call
+        emit_ctx_access(0x8b, RBX, CTX_OFFSET(regs));
+
+        emit(0x85); emit(0xc0);                 // test eax, eax
+        pos = emit_jcc8(0x75);                  // jnz
+        emit_fault(insn, inst, REIL_VM_MEM_READ);
+        patch8(pos);
+
+        emit_ctx_access(0x8b, RAX, CTX_OFFSET(val));
+        emit_zero_ext(RAX, inst->c.bits);
+        emit_reg_access(0x89, RAX, inst->c.reg);
+        return true;
+
+    default:
+
+        break;
+    }
+
+    emit_arg(&inst->a, RAX);
+
+    if (inst->op != I_STR && inst->op != I_NEG && inst->op != I_NOT)
+    {
+        emit_arg(&inst->b, RCX);
+    }
+
+    switch (inst->op)
+    {
+    case I_STR: break;
+    case I_ADD: emit(REX_W); emit(0x01); emit(0xc8); break;    // add rax, rcx
+    case I_SUB: emit(REX_W); emit(0x29); emit(0xc8); break;    // sub rax, rcx
+    case I_NEG: emit(REX_W); emit(0xf7); emit(0xd8); break;    // neg rax
+    case I_MUL: emit(REX_W); emit(0x0f); emit(0xaf); emit(0xc1); break;    // imul rax, rcx
+    case I_AND: emit(REX_W); emit(0x21); emit(0xc8); break;    // and rax, rcx
+    case I_OR:  emit(REX_W); emit(0x09); emit(0xc8); break;    // or rax, rcx
+    case I_XOR: emit(REX_W); emit(0x31); emit(0xc8); break;    // xor rax, rcx
+    case I_NOT: emit(REX_W); emit(0xf7); emit(0xd0); break;    // not rax
+
+    case I_EQ:
+    case I_LT:
+
+        emit(REX_W); emit(0x39); emit(0xc8);    // cmp rax, rcx
+        emit(0x0f); emit(inst->op == I_EQ ? 0x94 : 0x92); emit(0xc0);  // sete/setb al
+        emit(0x0f); emit(0xb6); emit(0xc0);     // movzx eax, al
+        break;
+
+    case I_DIV:
+    case I_MOD:
+
+        emit(REX_W); emit(0x85); emit(0xc9);    // test rcx, rcx
+        zero = emit_jcc8(0x74);                 // jz
+        emit(0x31); emit(0xd2);                 // xor edx, edx
+        emit(REX_W); emit(0xf7); emit(0xf1);    // div rcx
+
+        if (inst->op == I_MOD)
+        {
+            emit_mov_reg(RAX, RDX);
+        }
+
+        end = emit_jcc8(0xeb);                  // jmp
+        patch8(zero);
+        emit(0x31); emit(0xc0);                 // xor eax, eax
+        patch8(end);
+        break;
+
+    case I_SHL:
+    case I_SHR:
+
+        emit(REX_W); emit(0x83); emit(0xf9); emit((uint8_t)bits);     // cmp rcx, bits
+        zero = emit_jcc8(0x73);                 // jae
+        emit(REX_W); emit(0xd3); emit(inst->op == I_SHL ? 0xe0 : 0xe8);    // shl/shr rax, cl
+        end = emit_jcc8(0xeb);                  // jmp
+        patch8(zero);
+        emit(0x31); emit(0xc0);                 // xor eax, eax
+        patch8(end);
+        break;
+
+    case I_SMUL:
+    case I_SDIV:
+    case I_SMOD:
+
+        // signed operands, one bit values are never negative
+        if (inst->a.bits != 1) emit_sign_ext(RAX, inst->a.bits);
+        if (inst->b.bits != 1) emit_sign_ext(RCX, inst->b.bits);
+
+        if (inst->op == I_SMUL)
+        {
+            emit(REX_W); emit(0x0f); emit(0xaf); emit(0xc1);    // imul rax, rcx
+        }
+        else
+        {
+            uint8_t *zero_2 = NULL, *not_min = NULL, *no_rem = NULL, *same_sign = NULL;
+
+            emit(REX_W); emit(0x85); emit(0xc9);    // test rcx, rcx
+            zero = emit_jcc8(0x74);                 // jz
+            emit(REX_W); emit(0x83); emit(0xf9); emit(0xff);    // cmp rcx, -1
+            not_min = emit_jcc8(0x75);              // jne
+            emit_mov_imm(RDX, 0x8000000000000000ULL);
+            emit(REX_W); emit(0x39); emit(0xd0);    // cmp rax, rdx
+            zero_2 = emit_jcc8(0x74);               // je
+            patch8(not_min);
+
+            emit(REX_W); emit(0x99);                // cqo
+            emit(REX_W); emit(0xf7); emit(0xf9);    // idiv rcx
+
+            // the same rounding as python integers have
+            emit(REX_W); emit(0x85); emit(0xd2);    // test rdx, rdx
+            no_rem = emit_jcc8(0x74);               // jz
+            emit_mov_reg(R8, RDX);
+            emit(0x49); emit(0x31); emit(0xc8);     // xor r8, rcx
+            same_sign = emit_jcc8(0x79);            // jns
+            emit(REX_W); emit(0xff); emit(0xc8);    // dec rax
+            emit(REX_W); emit(0x01); emit(0xca);    // add rdx, rcx
+            patch8(no_rem);
+            patch8(same_sign);
+
+            if (inst->op == I_SMOD)
+            {
+                emit_mov_reg(RAX, RDX);
+            }
+
+            end = emit_jcc8(0xeb);                  // jmp
+            patch8(zero);
+            patch8(zero_2);
+            emit(0x31); emit(0xc0);                 // xor eax, eax
+            patch8(end);
+        }
+
+        // negative result is sign extended to the destination size
+        emit_sign_ext(RAX, bits);
+        break;
+
+    default:
+
+        return false;
+    }
+
+    if (inst->op != I_STR && inst->op != I_SMUL &&
+        inst->op != I_SDIV && inst->op != I_SMOD)
+    {
+        emit_zero_ext(RAX, bits);
+    }
+
+    if (inst->a.bits == 1 && inst->b.bits == 1)
+    {
+        // one bit expression
+        emit_zero_ext(RAX, 1);
+    }
+
+    emit_zero_ext(RAX, inst->c.bits);
+    emit_reg_access(0x89, RAX, inst->c.reg);
+
+    return true;
+}
+
+void *CReilJit::compile(vector<reil_vm_insn *> &insns, int reg_ip, reil_const_t ip_mask)
+{
+    size_t need = 2;
+
+    if (code == NULL || insns.size() == 0)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < insns.size(); i++)
+    {
+        need += insns[i]->insts.size() + 1;
+    }
+
+    if (ptr + need * REIL_JIT_MAX_INST_LEN > code_end)
+    {
+        // code cache is full
+        return NULL;
+    }
+
+    uint8_t *block = ptr;
+    reil_addr_t addr = insns[0]->addr;
+
+    blocks[addr] = block;
+
+    // link already compiled code with the new block
+    pair<multimap<reil_addr_t, uint8_t *>::iterator,
+         multimap<reil_addr_t, uint8_t *>::iterator> range = links.equal_range(addr);
+
+    for (multimap<reil_addr_t, uint8_t *>::iterator it = range.first; it != range.second; ++it)
+    {
+        patch32(it->second, block);
+    }
+
+    for (size_t i = 0; i < insns.size(); i++)
+    {
+        reil_vm_insn *insn = insns[i];
+
+        if (reg_ip != -1)
+        {
+            // update instruction pointer
+            emit_mov_imm(RAX, insn->addr & ip_mask);
+            emit_reg_access(0x89, RAX, reg_ip);
+        }
+
+        for (size_t n = 0; n < insn->insts.size(); n++)
+        {
+            bool ret = emit_inst(insn, &insn->insts[n]);
+            assert(ret);
+        }
+    }
+
+    // continue execution at the next machine instruction
+    emit_exit(insns.back()->addr + insns.back()->size);
+
+    return block;
+}
@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <vector>
+
+using namespace std;
+
+// OpenREIL includes
+#include "libopenreil.h"
+#include "reil_optimizer.h"
+
+// temp register states for copy_prop()
+#define TEMP_UNKNOWN    0   // value of the temp is not known
+#define TEMP_COPY       1   // temp holds a copy of register, temp or constant
+
+static inline bool is_temp(reil_arg_t *arg)
+{
+    return arg->type == A_TEMP;
+}
+
+static inline int temp_num(reil_arg_t *arg)
+{
+    // temp names are in "V_<nn>" format
+    return atoi(arg->name + 2);
+}
+
+static int arg_bits(reil_size_t size)
+{
+    switch (size)
+    {
+    case U1: return 1;
+    case U8: return 8;
+    case U16: return 16;
+    case U32: return 32;
+    case U64: return 64;
+    }
+
+    assert(0);
+}
+
+static reil_const_t arg_mask(int bits)
+{
+    return bits >= 64 ? 0xffffffffffffffffULL : ((1ULL << bits) - 1);
+}
+
+static inline bool inst_writes_c(reil_inst_t *inst)
+{
+    // STM and JCC are reading their destination argument
+    return inst->op != I_NONE && inst->op != I_UNK && inst->op != I_STM && inst->op != I_JCC;
+}
+
+static inline bool is_same_reg(reil_arg_t *a, reil_arg_t *b)
+{
+    if (a->type != A_REG || b->type != A_REG)
+    {
+        return false;
+    }
+
+    if (a->parent != REIL_REG_NONE && a->parent == b->parent)
+    {
+        // overlapping parts of the same register
+        return true;
+    }
+
+    return !strcmp(a->name, b->name);
+}
+
+bool CReilOptimizer::copy_prop(vector<reil_inst_t> &insts)
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < temp_state.size(); i++)
+    {
+        temp_state[i] = TEMP_UNKNOWN;
+    }
+
+    for (size_t i = 0; i < insts.size(); i++)
+    {
+        reil_inst_t *inst = &insts[i];
+        reil_arg_t *src[3] = { &inst->a, &inst->b, NULL };
+
+        if (inst->op == I_STM || inst->op == I_JCC)
+        {
+            src[2] = &inst->c;
+        }
+
+        for (int n = 0; n < 3; n++)
+        {
+            reil_arg_t *arg = src[n];
+
+            if (arg && is_temp(arg))
+            {
+                int num = temp_num(arg);
+
+                if (num < (int)temp_state.size() && temp_state[num] == TEMP_COPY &&
+                    temp_val[num].size == arg->size)
+                {
+                    // replace temp with it's known value
+                    *arg = temp_val[num];
+                    changed = true;
+                }
+            }
+        }
+
+        if (!inst_writes_c(inst))
+        {
+            continue;
+        }
+
+        for (size_t n = 0; n < temp_state.size(); n++)
+        {
+            // invalidate copies of the modified register or temp
+            if (temp_state[n] == TEMP_COPY &&
+                (is_same_reg(&temp_val[n], &inst->c) ||
+                 (is_temp(&temp_val[n]) && is_temp(&inst->c) &&
+                  !strcmp(temp_val[n].name, inst->c.name))))
+            {
+                temp_state[n] = TEMP_UNKNOWN;
+            }
+        }
+
+        if (is_temp(&inst->c))
+        {
+            int num = temp_num(&inst->c);
+
+            if (num >= (int)temp_state.size())
+            {
+                temp_state.resize(num + 1, TEMP_UNKNOWN);
+                temp_val.resize(num + 1);
+            }
+
+            if (inst->op == I_STR && inst->a.size == inst->c.size &&
+                !(is_temp(&inst->a) && temp_num(&inst->a) == num))
+            {
+                // remember the copy
+                temp_state[num] = TEMP_COPY;
+                temp_val[num] = inst->a;
+            }
+            else
+            {
+                temp_state[num] = TEMP_UNKNOWN;
+            }
+        }
+    }
+
+    return changed;
+}
+
+bool CReilOptimizer::const_fold(vector<reil_inst_t> &insts)
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < insts.size(); i++)
+    {
+        reil_inst_t *inst = &insts[i];
+        reil_arg_t *a = &inst->a, *b = &inst->b;
+        bool unary = inst->op == I_STR || inst->op == I_NEG || inst->op == I_NOT;
+
+        if (!inst_writes_c(inst) || inst->op == I_LDM ||
+            a->type != A_CONST || (!unary && b->type != A_CONST))
+        {
+            continue;
+        }
+
+        if (inst->op == I_STR && a->size == inst->c.size)
+        {
+            // nothing to fold
+            continue;
+        }
+
+        // operands are promoted to the widest of them (one bit values are bytes)
+        int bits_a = arg_bits(a->size), bits_b = unary ? 1 : arg_bits(b->size);
+        int bits = max(max(bits_a, bits_b), 8);
+
+        reil_const_t mask = arg_mask(bits);
+        reil_const_t val_a = a->val & arg_mask(bits_a);
+        reil_const_t val_b = unary ? 0 : b->val & arg_mask(bits_b);
+        reil_const_t ret = 0;
+
+        // signed operations are folded only for non-negative operands of the same size
+        bool is_signed = inst->op == I_SMUL || inst->op == I_SDIV || inst->op == I_SMOD;
+        if (is_signed && (bits_a != bits_b ||
+            (val_a >> (bits_a - 1)) != 0 || (val_b >> (bits_b - 1)) != 0))
+        {
+            continue;
+        }
+
+        switch (inst->op)
+        {
+        case I_STR: ret = val_a; break;
+        case I_ADD: ret = val_a + val_b; break;
+        case I_SUB: ret = val_a - val_b; break;
+        case I_NEG: ret = -val_a; break;
+        case I_MUL:
+        case I_SMUL: ret = val_a * val_b; break;
+        case I_AND: ret = val_a & val_b; break;
+        case I_OR:  ret = val_a | val_b; break;
+        case I_XOR: ret = val_a ^ val_b; break;
+        case I_NOT: ret = ~val_a; break;
+        case I_EQ:  ret = val_a == val_b ? 1 : 0; break;
+        case I_LT:  ret = val_a < val_b ? 1 : 0; break;
+
+        case I_DIV:
+        case I_SDIV:
+        case I_MOD:
+        case I_SMOD:
+
+            if (val_b == 0)
+            {
+                // leave division by zero for the run time
+                continue;
+            }
+
+            ret = (inst->op == I_DIV || inst->op == I_SDIV) ? val_a / val_b : val_a % val_b;
+            break;
+
+        case I_SHL:
+        case I_SHR:
+
+            if (val_b >= (reil_const_t)bits)
+            {
+                // result of the shift depends on the implementation
+                continue;
+            }
+
+            ret = inst->op == I_SHL ? val_a << val_b : val_a >> val_b;
+            break;
+
+        default:
+
+            continue;
+        }
+
+        ret &= mask;
+
+        if (a->size == U1 && (unary || b->size == U1))
+        {
+            // one bit expression
+            ret &= 1;
+        }
+
+        // replace instruction with the constant assignment
+        inst->op = I_STR;
+        memset(&inst->a, 0, sizeof(inst->a));
+        inst->a.type = A_CONST;
+        inst->a.size = inst->c.size;
+        inst->a.val = ret & arg_mask(arg_bits(inst->c.size));
+        memset(&inst->b, 0, sizeof(inst->b));
+
+        changed = true;
+    }
+
+    return changed;
+}
+
+bool CReilOptimizer::dead_temp(vector<reil_inst_t> &insts)
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < temp_state.size(); i++)
+    {
+        temp_state[i] = 0;
+    }
+
+    // backward liveness analysis, temps are dead at the end of machine instruction
+    for (int i = (int)insts.size() - 1; i >= 0; i--)
+    {
+        reil_inst_t *inst = &insts[i];
+
+        if (inst_writes_c(inst) && is_temp(&inst->c))
+        {
+            int num = temp_num(&inst->c);
+
+            if (num >= (int)temp_state.size() || !temp_state[num])
+            {
+                // value is never used
+                insts.erase(insts.begin() + i);
+                changed = true;
+                continue;
+            }
+
+            temp_state[num] = 0;
+        }
+
+        reil_arg_t *src[3] = { &inst->a, &inst->b, NULL };
+
+        if (inst->op == I_STM || inst->op == I_JCC)
+        {
+            src[2] = &inst->c;
+        }
+
+        for (int n = 0; n < 3; n++)
+        {
+            if (src[n] && is_temp(src[n]))
+            {
+                int num = temp_num(src[n]);
+
+                if (num >= (int)temp_state.size())
+                {
+                    temp_state.resize(num + 1, 0);
+                }
+
+                temp_state[num] = 1;
+            }
+        }
+    }
+
+    return changed;
+}
+
+void CReilOptimizer::renumber(vector<reil_inst_t> &insts)
+{
+    vector<int> nums;
+    int count = 0;
+
+    for (size_t i = 0; i < insts.size(); i++)
+    {
+        reil_arg_t *args[3] = { &insts[i].a, &insts[i].b, &insts[i].c };
+
+        for (int n = 0; n < 3; n++)
+        {
+            if (!is_temp(args[n]))
+            {
+                continue;
+            }
+
+            int num = temp_num(args[n]);
+
+            if (num >= (int)nums.size())
+            {
+                nums.resize(num + 1, -1);
+            }
+
+            if (nums[num] == -1)
+            {
+                // assign new numbers in order of the first appearance
+                nums[num] = count++;
+            }
+
+            snprintf(args[n]->name, REIL_MAX_NAME_LEN, "V_%.2d", nums[num]);
+        }
+    }
+}
+
+int CReilOptimizer::optimize(vector<reil_inst_t> &insts)
+{
+    int count = (int)insts.size();
+    unsigned long long asm_end = 0;
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    reil_raw_t raw_info = insts[0].raw_info;
+
+    for (size_t i = 0; i < insts.size(); i++)
+    {
+        if (insts[i].op == I_UNK)
+        {
+            // leave unknown instructions as is
+            return 0;
+        }
+
+        asm_end |= insts[i].flags & IOPT_ASM_END;
+        insts[i].flags &= ~IOPT_ASM_END;
+    }
+
+    for (int round = 0; round < REIL_OPT_MAX_ROUNDS; round++)
+    {
+        bool changed = false;
+
+        if (passes & REIL_PASS_COPY_PROP) changed |= copy_prop(insts);
+        if (passes & REIL_PASS_CONST_FOLD) changed |= const_fold(insts);
+        if (passes & REIL_PASS_DEAD_TEMP) changed |= dead_temp(insts);
+
+        if (!changed)
+        {
+            break;
+        }
+    }
+
+    if (passes & REIL_PASS_RENUMBER)
+    {
+        renumber(insts);
+    }
+
+    if (insts.size() == 0)
+    {
+        // machine instruction must have at least one IR instruction
+        reil_inst_t inst;
+        memset(&inst, 0, sizeof(inst));
+
+        inst.raw_info = raw_info;
+        inst.op = I_NONE;
+        insts.push_back(inst);
+    }
+
+    for (size_t i = 0; i < insts.size(); i++)
+    {
+        insts[i].inum = (reil_inum_t)i;
+    }
+
+    if (insts.size() > 0)
+    {
+        insts.back().flags |= asm_end;
+    }
+
+    return count - (int)insts.size();
+}
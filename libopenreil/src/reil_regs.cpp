@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+// libasmir includes
+#include "irtoir.h"
+
+// OpenREIL includes
+#include "libopenreil.h"
+#include "reil_translator.h"
+
+using namespace std;
+
+#define X86_REG(_name_, _size_, _parent_, _offset_) \
+    { REIL_X86_##_name_, "R_" #_name_, _size_, REIL_X86_##_parent_, _offset_ }
+
+// must be in the same order as reil_x86_reg_t values
+static const reil_reg_info_t x86_regs[] =
+{
+    { REIL_REG_NONE, NULL, U1, REIL_REG_NONE, 0 },
+
+    X86_REG(EAX, U32, EAX, 0),
+    X86_REG(EBX, U32, EBX, 0),
+    X86_REG(ECX, U32, ECX, 0),
+    X86_REG(EDX, U32, EDX, 0),
+    X86_REG(ESI, U32, ESI, 0),
+    X86_REG(EDI, U32, EDI, 0),
+    X86_REG(EBP, U32, EBP, 0),
+    X86_REG(ESP, U32, ESP, 0),
+    X86_REG(EIP, U32, EIP, 0),
+
+    X86_REG(AX, U16, EAX, 0),
+    X86_REG(BX, U16, EBX, 0),
+    X86_REG(CX, U16, ECX, 0),
+    X86_REG(DX, U16, EDX, 0),
+    X86_REG(SI, U16, ESI, 0),
+    X86_REG(DI, U16, EDI, 0),
+    X86_REG(BP, U16, EBP, 0),
+    X86_REG(SP, U16, ESP, 0),
+    X86_REG(AL, U8, EAX, 0),
+    X86_REG(BL, U8, EBX, 0),
+    X86_REG(CL, U8, ECX, 0),
+    X86_REG(DL, U8, EDX, 0),
+    X86_REG(AH, U8, EAX, 8),
+    X86_REG(BH, U8, EBX, 8),
+    X86_REG(CH, U8, ECX, 8),
+    X86_REG(DH, U8, EDX, 8),
+
+    // flags are separate registers in IR code, not a parts of EFLAGS
+    X86_REG(EFLAGS, U32, EFLAGS, 0),
+    X86_REG(CF, U1, CF, 0),
+    X86_REG(PF, U1, PF, 0),
+    X86_REG(AF, U1, AF, 0),
+    X86_REG(ZF, U1, ZF, 0),
+    X86_REG(SF, U1, SF, 0),
+    X86_REG(OF, U1, OF, 0),
+    X86_REG(DFLAG, U32, DFLAG, 0),
+    X86_REG(IDFLAG, U1, IDFLAG, 0),
+    X86_REG(ACFLAG, U1, ACFLAG, 0),
+
+    X86_REG(CC_OP, U32, CC_OP, 0),
+    X86_REG(CC_DEP1, U32, CC_DEP1, 0),
+    X86_REG(CC_DEP2, U32, CC_DEP2, 0),
+    X86_REG(CC_NDEP, U32, CC_NDEP, 0),
+    X86_REG(EMWARN, U32, EMWARN, 0),
+
+    X86_REG(CS, U16, CS, 0),
+    X86_REG(DS, U16, DS, 0),
+    X86_REG(ES, U16, ES, 0),
+    X86_REG(FS, U16, FS, 0),
+    X86_REG(GS, U16, GS, 0),
+    X86_REG(SS, U16, SS, 0),
+    X86_REG(LDT, U32, LDT, 0),
+    X86_REG(GDT, U32, GDT, 0),
+    X86_REG(CS_BASE, U32, CS_BASE, 0),
+    X86_REG(DS_BASE, U32, DS_BASE, 0),
+    X86_REG(ES_BASE, U32, ES_BASE, 0),
+    X86_REG(FS_BASE, U32, FS_BASE, 0),
+    X86_REG(GS_BASE, U32, GS_BASE, 0),
+    X86_REG(SS_BASE, U32, SS_BASE, 0),
+
+    X86_REG(FTOP, U32, FTOP, 0),
+    X86_REG(FPROUND, U32, FPROUND, 0),
+    X86_REG(FC3210, U32, FC3210, 0),
+    X86_REG(SSEROUND, U32, SSEROUND, 0)
+};
+
+static const reil_reg_info_t *reg_table(reil_arch_t arch, int *count)
+{
+    switch (arch)
+    {
+    case ARCH_X86:
+
+        *count = REIL_X86_REG_MAX;
+        return x86_regs;
+
+    default:
+
+        *count = 0;
+        return NULL;
+    }
+}
+
+static vector<reil_reg_t> x86_regs_by_sym(void)
+{
+    vector<reil_reg_t> ret;
+
+    assert(sizeof(x86_regs) / sizeof(reil_reg_info_t) == REIL_X86_REG_MAX);
+
+    for (int i = 1; i < REIL_X86_REG_MAX; i++)
+    {
+        assert(x86_regs[i].reg == i);
+
+        // map interned register name index to register ID
+        size_t index = SYM_VAL(sym_reg(x86_regs[i].name + 2));
+        if (index >= ret.size())
+        {
+            ret.resize(index + 1, REIL_REG_NONE);
+        }
+
+        ret[index] = x86_regs[i].reg;
+    }
+
+    return ret;
+}
+
+const reil_reg_info_t *reil_reg_lookup(VexArch guest, sym_t sym)
+{
+    if (guest == VexArchX86 && SYM_KIND(sym) == SYM_REG)
+    {
+        static const vector<reil_reg_t> x86_index = x86_regs_by_sym();
+
+        if (SYM_VAL(sym) < x86_index.size())
+        {
+            reil_reg_t reg = x86_index[SYM_VAL(sym)];
+
+            return reg == REIL_REG_NONE ? NULL : &x86_regs[reg];
+        }
+    }
+
+    return NULL;
+}
+
+extern "C" int reil_reg_count(reil_arch_t arch)
+{
+    int count = 0;
+    reg_table(arch, &count);
+
+    return count;
+}
+
+extern "C" const reil_reg_info_t *reil_reg_info(reil_arch_t arch, reil_reg_t reg)
+{
+    int count = 0;
+    const reil_reg_info_t *table = reg_table(arch, &count);
+
+    if (table == NULL || reg == REIL_REG_NONE || reg >= count)
+    {
+        return NULL;
+    }
+
+    return &table[reg];
+}
+
+extern "C" reil_reg_t reil_reg_by_name(reil_arch_t arch, const char *name)
+{
+    int count = 0;
+    const reil_reg_info_t *table = reg_table(arch, &count);
+
+    for (int i = 1; i < count; i++)
+    {
+        if (!strcmp(table[i].name, name))
+        {
+            return table[i].reg;
+        }
+    }
+
+    return REIL_REG_NONE;
+}
@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+using namespace std;
+
+// OpenREIL includes
+#include "libopenreil.h"
+#include "reil_dfg.h"
+#include "reil_dom.h"
+#include "reil_ssa.h"
+
+CReilSSA::CReilSSA(reil_arch_t arch)
+{
+    assert(arch == ARCH_X86);
+
+    this->arch = arch;
+}
+
+int CReilSSA::var_index(const char *name)
+{
+    map<string, int>::iterator it = vars_index.find(name);
+    if (it != vars_index.end())
+    {
+        return it->second;
+    }
+
+    vars_index[name] = vars.size();
+    vars.push_back(name);
+
+    return vars.size() - 1;
+}
+
+void CReilSSA::add_ref(reil_arg_t *arg, int arg_num)
+{
+    if (arg->type == A_REG || arg->type == A_TEMP)
+    {
+        reil_ssa_ref_t ref;
+        ref.var = var_index(arg->name);
+        ref.version = REIL_SSA_NONE;
+        ref.arg = arg_num;
+
+        refs.push_back(ref);
+    }
+}
+
+void CReilSSA::add_call_ref(int var)
+{
+    reil_ssa_ref_t ref;
+    ref.var = var;
+    ref.version = REIL_SSA_NONE;
+    ref.arg = REIL_SSA_ARG_CALL;
+
+    refs.push_back(ref);
+}
+
+void CReilSSA::collect(reil_func_t *func)
+{
+    vars.clear();
+    vars_index.clear();
+    call_vars.clear();
+
+    insts.resize(func->insts_count);
+    refs.clear();
+
+    for (int i = 0; i < func->insts_count; i++)
+    {
+        reil_inst_t *inst = &func->insts[i];
+        reil_ssa_inst_t *info = &insts[i];
+        bool call = (inst->flags & IOPT_CALL) != 0;
+
+        info->uses = refs.size();
+
+        if (inst->op == I_UNK)
+        {
+            // operands of unknown instruction
+            add_ref(&inst->a, REIL_SSA_ARG_A);
+        }
+        else if (inst->op != I_NONE)
+        {
+            add_ref(&inst->a, REIL_SSA_ARG_A);
+            add_ref(&inst->b, REIL_SSA_ARG_B);
+
+            if (inst->op == I_JCC || inst->op == I_STM)
+            {
+                add_ref(&inst->c, REIL_SSA_ARG_C);
+            }
+        }
+
+        if (call && call_vars.size() == 0)
+        {
+            for (int n = 0; reil_dfg_call_regs_x86[n] != REIL_REG_NONE; n++)
+            {
+                call_vars.push_back(var_index(reil_reg_info(arch, reil_dfg_call_regs_x86[n])->name));
+            }
+        }
+
+        // called function can read all general purpose registers
+        for (size_t n = 0; call && n < call_vars.size(); n++)
+        {
+            add_call_ref(call_vars[n]);
+        }
+
+        info->uses_count = refs.size() - info->uses;
+        info->defs = refs.size();
+
+        if (call)
+        {
+            // .. and write them
+            for (size_t n = 0; n < call_vars.size(); n++)
+            {
+                add_call_ref(call_vars[n]);
+            }
+        }
+        else if (inst->op == I_UNK ||
+                 (inst->op != I_NONE && inst->op != I_JCC && inst->op != I_STM))
+        {
+            add_ref(&inst->c, REIL_SSA_ARG_C);
+        }
+
+        info->defs_count = refs.size() - info->defs;
+    }
+}
+
+void CReilSSA::frontiers(reil_func_t *func)
+{
+    vector<pair<int, int> > pairs;
+    vector<int> stamp(func->bbs_count, -1);
+
+    for (size_t n = 0; n < dom.rpo.size(); n++)
+    {
+        int bb = dom.rpo[n];
+
+        if (dom.preds_first[bb + 1] - dom.preds_first[bb] < 2 && bb != func->entry)
+        {
+            continue;
+        }
+
+        for (int p = dom.preds_first[bb]; p < dom.preds_first[bb + 1]; p++)
+        {
+            // bb is in the frontier of each block that dominates predecessor but not bb
+            for (int runner = dom.preds[p]; runner != dom.idom[bb]; runner = dom.idom[runner])
+            {
+                if (stamp[runner] != bb)
+                {
+                    stamp[runner] = bb;
+                    pairs.push_back(make_pair(runner, bb));
+                }
+            }
+        }
+    }
+
+    reil_dom_group(func->bbs_count, pairs, df_first, df);
+}
+
+void CReilSSA::place(reil_func_t *func)
+{
+    vector<pair<int, int> > pairs;
+    vector<int> defined(vars.size(), -1), defs_first, defs;
+    vector<bool> global(vars.size(), false);
+
+    for (size_t n = 0; n < dom.rpo.size(); n++)
+    {
+        reil_func_bb_t *info = &func->bbs[dom.rpo[n]];
+
+        for (int i = info->first; i < info->first + info->count; i++)
+        {
+            reil_ssa_inst_t *inst = &insts[i];
+
+            for (int r = inst->uses; r < inst->uses + inst->uses_count; r++)
+            {
+                // variable is live at the beginning of basic block
+                if (defined[refs[r].var] != dom.rpo[n]) global[refs[r].var] = true;
+            }
+
+            for (int r = inst->defs; r < inst->defs + inst->defs_count; r++)
+            {
+                if (defined[refs[r].var] != dom.rpo[n])
+                {
+                    defined[refs[r].var] = dom.rpo[n];
+                    pairs.push_back(make_pair(refs[r].var, dom.rpo[n]));
+                }
+            }
+        }
+    }
+
+    // basic blocks that define each variable
+    reil_dom_group(vars.size(), pairs, defs_first, defs);
+
+    vector<int> has_phi(func->bbs_count, -1), in_work(func->bbs_count, -1), worklist;
+
+    pairs.clear();
+
+    for (int var = 0; var < (int)vars.size(); var++)
+    {
+        if (!global[var])
+        {
+            // semi-pruned SSA: variable is never used outside of its basic block
+            continue;
+        }
+
+        for (int n = defs_first[var]; n < defs_first[var + 1]; n++)
+        {
+            in_work[defs[n]] = var;
+            worklist.push_back(defs[n]);
+        }
+
+        // iterated dominance frontier of definitions
+        while (worklist.size() > 0)
+        {
+            int bb = worklist.back();
+            worklist.pop_back();
+
+            for (int n = df_first[bb]; n < df_first[bb + 1]; n++)
+            {
+                int join = df[n];
+
+                if (has_phi[join] != var)
+                {
+                    has_phi[join] = var;
+                    pairs.push_back(make_pair(join, var));
+
+                    if (in_work[join] != var)
+                    {
+                        in_work[join] = var;
+                        worklist.push_back(join);
+                    }
+                }
+            }
+        }
+    }
+
+    sort(pairs.begin(), pairs.end());
+
+    phis.resize(pairs.size());
+    phis_first.assign(func->bbs_count + 1, 0);
+    phi_args.clear();
+
+    for (size_t n = 0; n < pairs.size(); n++)
+    {
+        reil_ssa_phi_t *phi = &phis[n];
+        int bb = pairs[n].first;
+
+        phi->bb = bb;
+        phi->var = pairs[n].second;
+        phi->version = REIL_SSA_NONE;
+        phi->args = phi_args.size();
+
+        phis_first[bb + 1] += 1;
+
+        for (int p = dom.preds_first[bb]; p < dom.preds_first[bb + 1]; p++)
+        {
+            reil_ssa_phi_arg_t arg;
+            arg.bb = dom.preds[p];
+            arg.version = REIL_SSA_NONE;
+
+            phi_args.push_back(arg);
+        }
+
+        if (bb == func->entry)
+        {
+            // value that variable had at the function entry
+            reil_ssa_phi_arg_t arg;
+            arg.bb = -1;
+            arg.version = REIL_SSA_ENTRY;
+
+            phi_args.push_back(arg);
+        }
+
+        phi->args_count = phi_args.size() - phi->args;
+    }
+
+    for (int n = 0; n < func->bbs_count; n++)
+    {
+        phis_first[n + 1] += phis_first[n];
+    }
+}
+
+void CReilSSA::rename_block(reil_func_t *func, int bb, vector<pair<int, int> > &undo)
+{
+    reil_func_bb_t *info = &func->bbs[bb];
+
+    for (int p = phis_first[bb]; p < phis_first[bb + 1]; p++)
+    {
+        int var = phis[p].var;
+
+        undo.push_back(make_pair(var, top[var]));
+        phis[p].version = top[var] = versions[var]++;
+    }
+
+    for (int i = info->first; i < info->first + info->count; i++)
+    {
+        reil_ssa_inst_t *inst = &insts[i];
+
+        for (int r = inst->uses; r < inst->uses + inst->uses_count; r++)
+        {
+            refs[r].version = top[refs[r].var];
+        }
+
+        for (int r = inst->defs; r < inst->defs + inst->defs_count; r++)
+        {
+            int var = refs[r].var;
+
+            undo.push_back(make_pair(var, top[var]));
+            refs[r].version = top[var] = versions[var]++;
+        }
+    }
+
+    for (int s = info->succ; s < info->succ + info->succ_count; s++)
+    {
+        int succ = func->succ[s];
+
+        // predecessors are sorted, bb might be there more than once
+        int *preds = &dom.preds[0] + dom.preds_first[succ];
+        int first = lower_bound(preds, &dom.preds[0] + dom.preds_first[succ + 1], bb) - preds;
+
+        for (int p = phis_first[succ]; p < phis_first[succ + 1]; p++)
+        {
+            for (int n = first; dom.preds_first[succ] + n < dom.preds_first[succ + 1] && preds[n] == bb; n++)
+            {
+                phi_args[phis[p].args + n].version = top[phis[p].var];
+            }
+        }
+    }
+}
+
+void CReilSSA::rename(reil_func_t *func)
+{
+    vector<pair<int, int> > stack, undo;
+    vector<int> marks;
+
+    top.assign(vars.size(), REIL_SSA_ENTRY);
+    versions.assign(vars.size(), REIL_SSA_ENTRY + 1);
+
+    marks.push_back(0);
+    stack.push_back(make_pair(func->entry, dom.children_first[func->entry]));
+    rename_block(func, func->entry, undo);
+
+    // preorder traversal of dominator tree
+    while (stack.size() > 0)
+    {
+        int bb = stack.back().first;
+        int n = stack.back().second;
+
+        if (n < dom.children_first[bb + 1])
+        {
+            int child = dom.children[n];
+
+            stack.back().second += 1;
+
+            marks.push_back(undo.size());
+            stack.push_back(make_pair(child, dom.children_first[child]));
+            rename_block(func, child, undo);
+        }
+        else
+        {
+            // restore versions that were visible at the dominator
+            while ((int)undo.size() > marks.back())
+            {
+                top[undo.back().first] = undo.back().second;
+                undo.pop_back();
+            }
+
+            marks.pop_back();
+            stack.pop_back();
+        }
+    }
+}
+
+void CReilSSA::build(reil_func_t *func, reil_ssa_func_t *ssa_func)
+{
+    assert(func->entry >= 0 && func->entry < func->bbs_count);
+
+    collect(func);
+
+    dom.build(func);
+
+    frontiers(func);
+    place(func);
+    rename(func);
+
+    memset(ssa_func, 0, sizeof(reil_ssa_func_t));
+
+    ssa_func->insts = insts.size() > 0 ? &insts[0] : NULL;
+    ssa_func->insts_count = insts.size();
+    ssa_func->refs = refs.size() > 0 ? &refs[0] : NULL;
+    ssa_func->refs_count = refs.size();
+    ssa_func->phis = phis.size() > 0 ? &phis[0] : NULL;
+    ssa_func->phis_count = phis.size();
+    ssa_func->phi_args = phi_args.size() > 0 ? &phi_args[0] : NULL;
+    ssa_func->phi_args_count = phi_args.size();
+    ssa_func->idom = &dom.idom[0];
+    ssa_func->versions = versions.size() > 0 ? &versions[0] : NULL;
+    ssa_func->vars_count = vars.size();
+}
+
+extern "C" reil_ssa_t reil_ssa_init(reil_arch_t arch)
+{
+    CReilSSA *ssa = new CReilSSA(arch);
+    assert(ssa);
+
+    return ssa;
+}
+
+extern "C" void reil_ssa_close(reil_ssa_t ssa)
+{
+    delete (CReilSSA *)ssa;
+}
+
+extern "C" int reil_ssa_build(reil_ssa_t ssa, reil_func_t *func, reil_ssa_func_t *ssa_func)
+{
+    CReilSSA *c = (CReilSSA *)ssa;
+    assert(c);
+    assert(func);
+    assert(ssa_func);
+
+    if (func->bbs_count == 0)
+    {
+        return REIL_ERROR;
+    }
+
+    c->build(func, ssa_func);
+
+    return 0;
+}
+
+extern "C" const char *reil_ssa_var_name(reil_ssa_t ssa, int var)
+{
+    return ((CReilSSA *)ssa)->var_name(var);
+}
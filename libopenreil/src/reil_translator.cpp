@@ -6,6 +6,9 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <vector>
+#include <deque>
+#include <map>
 
 extern "C" 
 { 
@@ -26,6 +29,8 @@ extern string sTag;
 // OpenREIL includes
 #include "libopenreil.h"
 #include "reil_translator.h"
+#include "reil_optimizer.h"
+#include "reil_cache.h"
 
 using namespace std;
 
@@ -149,14 +154,20 @@ void CReilFromBilTranslator::reset_state(bap_block_t *block)
     skip_eflags = false;    
 }
 
-int32_t CReilFromBilTranslator::tempreg_find(string name)
+void CReilFromBilTranslator::set_inst_handler(reil_inst_handler_t handler, void *context)
+{
+    inst_handler = handler;
+    inst_handler_context = context;
+}
+
+int32_t CReilFromBilTranslator::tempreg_find(sym_t sym)
 {
     vector<TEMPREG_BAP>::iterator it;
 
-    // find temporary registry number by BAP temporary registry name
+    // find temporary registry number by BAP temporary registry symbol
     for (it = tempreg_bap.begin(); it != tempreg_bap.end(); ++it)
     {
-        if (it->second == name)
+        if (it->second == sym)
         {
             return it->first;
         }
@@ -191,30 +202,19 @@ int32_t CReilFromBilTranslator::tempreg_alloc(void)
     return -1;
 }
 
-string CReilFromBilTranslator::tempreg_get_name(int32_t tempreg_num)
-{
-    char number[15];
-    sprintf(number, "%.2d", tempreg_num);
-
-    string tempreg_name = string("V_");
-    tempreg_name += number;
-
-    return tempreg_name;
-}
-
-string CReilFromBilTranslator::tempreg_get(string name)
+sym_t CReilFromBilTranslator::tempreg_get(sym_t sym)
 {
     // lookup for BAP temporary registry alias
-    int32_t tempreg_num = tempreg_find(name);
+    int32_t tempreg_num = tempreg_find(sym);
     if (tempreg_num == -1)
     {
         // there is no alias for this registry, create it
         tempreg_num = tempreg_alloc();
-        tempreg_bap.push_back(make_pair(tempreg_num, name));
+        tempreg_bap.push_back(make_pair(tempreg_num, sym));
 
 #ifdef DBG_TEMPREG
 
-        printf("Temp reg %d reserved for %s\n", tempreg_num, name.c_str());
+        printf("Temp reg %d reserved for %s\n", tempreg_num, sym_to_string(sym).c_str());
 #endif
 
     }
@@ -223,12 +223,12 @@ string CReilFromBilTranslator::tempreg_get(string name)
 
 #ifdef DBG_TEMPREG
 
-        printf("Temp reg %d found for %s\n", tempreg_num, name.c_str());   
+        printf("Temp reg %d found for %s\n", tempreg_num, sym_to_string(sym).c_str());   
 #endif
 
     }
 
-    return tempreg_get_name(tempreg_num);
+    return sym_reil_temp(tempreg_num);
 }
 
 uint64_t CReilFromBilTranslator::convert_special(Special *special)
@@ -295,33 +295,44 @@ void CReilFromBilTranslator::convert_operand(Exp *exp, reil_arg_t *reil_arg)
     }
 
     Temp *temp = (Temp *)exp;    
-    string ret = temp->name;
-    const char *c_name = ret.c_str();
+    sym_t sym = temp->sym;
 
-    if (strncmp(c_name, "R_", 2) && strncmp(c_name, "V_", 2))
+    if (SYM_KIND(sym) == SYM_REG)
     {
-        // this is a BAP temporary registry
-        ret = tempreg_get(ret);
-    }
+        const reil_reg_info_t *info = reil_reg_lookup(guest, sym);
 
-    if (!strncmp(c_name, "R_", 2))
-    {
         // architecture register
         reil_arg->type = A_REG;
         reil_arg->size = convert_operand_size(temp->typ);
-        strncpy(reil_arg->name, ret.c_str(), REIL_MAX_NAME_LEN - 1);
+
+        if (info)
+        {
+            reil_arg->reg = info->reg;
+            reil_arg->parent = info->parent;
+            reil_arg->offset = info->offset;
+        }
     }
     else
     {
+        if (SYM_KIND(sym) != SYM_REIL_TEMP)
+        {
+            // this is a BAP temporary registry
+            sym = tempreg_get(sym);
+        }
+
         // temporary register
         reil_arg->type = A_TEMP;
         reil_arg->size = convert_operand_size(temp->typ);
-        strncpy(reil_arg->name, ret.c_str(), REIL_MAX_NAME_LEN - 1);
     }
 
+    // register name is needed only for the output
+    sym_snprint(reil_arg->name, REIL_MAX_NAME_LEN, sym);
+
 #ifdef EXPAND_EFLAGS
 
-    if (!strcmp(reil_arg->name, "R_EFLAGS") && !skip_eflags)
+    static const sym_t sym_eflags = sym_reg("EFLAGS");
+
+    if (sym == sym_eflags && !skip_eflags)
     {        
         vector<Stmt *> set_eflags_stmt;
         vector<Stmt *>::iterator it;
@@ -353,10 +364,7 @@ void CReilFromBilTranslator::convert_operand(Exp *exp, reil_arg_t *reil_arg)
 
 Exp *CReilFromBilTranslator::temp_operand(reg_t typ, reil_inum_t inum)
 {
-    char buff[MAX_REG_NAME_LEN];
-    sprintf(buff, "V_REIL_TMP_%d", inum);
-
-    return new Temp(typ, tempreg_get(buff));
+    return new Temp(typ, tempreg_get(sym_reil_tmp(inum)));
 }
 
 void CReilFromBilTranslator::process_reil_inst(reil_inst_t *reil_inst)
@@ -958,7 +966,6 @@ Exp *CReilFromBilTranslator::process_bil_inst(reil_op_t inst, uint64_t inst_flag
     {
         // allocate temporary value to store result
         reg_t tempreg_type;
-        string tempreg_name;
 
         // determinate type for new value by type of result
         if (exp->exp_type == CAST)
@@ -981,8 +988,7 @@ Exp *CReilFromBilTranslator::process_bil_inst(reil_op_t inst, uint64_t inst_flag
             reil_assert(0, "invaid expression");
         }        
         
-        tempreg_name = tempreg_get_name(tempreg_alloc());
-        c = new Temp(tempreg_type, tempreg_name);
+        c = new Temp(tempreg_type, sym_reil_temp(tempreg_alloc()));
     }            
 
     // make REIL operands from BIL expressions
@@ -1045,7 +1051,7 @@ void CReilFromBilTranslator::check_cjmp_false_target(Exp *target)
     Label *label = (Label *)s;
 
     // match next label name with the cjmp target name
-    if (label->label != name->name)
+    if (label->sym != name->sym)
     {
         reil_assert(0, "check_cjmp_false_target(): unexpected label");   
     }
@@ -1071,7 +1077,7 @@ void CReilFromBilTranslator::process_bil_stmt(Stmt *s, uint64_t inst_flags)
 
 #ifdef DBG_BAP
 
-            printf("// BAP label %s at 0x%llx.%.2x\n", label->label.c_str(), 
+            printf("// BAP label %s at 0x%llx.%.2x\n", label->label().c_str(), 
                 label_addr, label_inum);
 #endif
             break;
@@ -1102,7 +1108,7 @@ void CReilFromBilTranslator::process_bil_stmt(Stmt *s, uint64_t inst_flags)
                 reil_addr_t addr = 0;
 
                 // find jump destination address by label name
-                if (!get_bil_label(name->name, &addr))
+                if (!get_bil_label(name->sym, &addr))
                 {
                     reil_assert(0, "get_bil_label() fails");
                 }
@@ -1134,7 +1140,7 @@ void CReilFromBilTranslator::process_bil_stmt(Stmt *s, uint64_t inst_flags)
                 reil_addr_t addr = 0;
 
                 // find true target destination address by label name
-                if (!get_bil_label(name->name, &addr))
+                if (!get_bil_label(name->sym, &addr))
                 {
                     reil_assert(0, "get_bil_label() fails");
                 }
@@ -1240,7 +1246,7 @@ void CReilFromBilTranslator::process_unknown_insn(void)
 #ifdef DBG_BAP
 
             Temp *temp = *it;
-            printf("%s ", temp->name.c_str());
+            printf("%s ", temp->name().c_str());
 #endif
             arg_all.push_back(*it);
         }
@@ -1265,7 +1271,7 @@ void CReilFromBilTranslator::process_unknown_insn(void)
 #ifdef DBG_BAP
 
             Temp *temp = *it;
-            printf("%s ", temp->name.c_str());
+            printf("%s ", temp->name().c_str());
 #endif
             arg_all.push_back(*it);
         }
@@ -1325,16 +1331,14 @@ void CReilFromBilTranslator::process_unknown_insn(void)
     }
 }
 
-bool CReilFromBilTranslator::get_bil_label(string name, reil_addr_t *addr)
+bool CReilFromBilTranslator::get_bil_label(sym_t sym, reil_addr_t *addr)
 {
     reil_addr_t ret = 0;
-    const char *c_name = name.c_str();
 
-    if (!strncmp(c_name, "pc_0x", 5))
+    if (SYM_KIND(sym) == SYM_PC)
     {
-        // get code pointer from label text
-        ret = strtoll(c_name + 5, NULL, 16);
-        reil_assert(errno != EINVAL, "invalid pc value");
+        // get code pointer from label symbol
+        ret = SYM_VAL(sym);
 
         if (addr)
         {
@@ -1379,14 +1383,14 @@ bool CReilFromBilTranslator::get_bil_label(string name, reil_addr_t *addr)
                 Label *label = (Label *)s;
 
                 // find label by name
-                if (label->label == name)
+                if (label->sym == sym)
                 {
                     if (inst_flags & IOPT_ASM_END)
                     {
                         // label belongs to the next instruction
                         ret = current_raw_info->addr + current_raw_info->size;
 #ifdef DBG_BAP
-                        printf("// %s -> 0x%llx\n", name.c_str(), ret);
+                        printf("// %s -> 0x%llx\n", sym_to_string(sym).c_str(), ret);
 #endif
                     }
                     else
@@ -1508,58 +1512,808 @@ _end:
     return;
 }
 
-CReilTranslator::CReilTranslator(VexArch arch, reil_inst_handler_t handler, void *context)
+CReilTranslator::CReilTranslator(VexArch arch, reil_inst_handler_t handler, void *context, int flags)
 {
     // initialize libasmir
-    translate_init();
+    asmir_ctx = asmir_ctx_new();
+    assert(asmir_ctx);
+
+    if (flags & REIL_FLAG_RELEASE)
+    {
+        // free VEX IR memory after translation of large instructions
+        asmir_ctx->arena.release_size = REIL_ARENA_RELEASE_SIZE;
+    }
 
     guest = arch;
-    translator = new CReilFromBilTranslator(arch, handler, context);
+    this->flags = flags;
+
+    inst_handler = handler;
+    inst_handler_context = context;
+
+    cache_record = NULL;
+    cache_probe = false;
+
+    disk_cache = NULL;
+
+    optimizer = NULL;
+    optimizer_record = NULL;
+
+    if (flags & REIL_FLAG_OPTIMIZE)
+    {
+        optimizer = new CReilOptimizer();
+        assert(optimizer);
+    }
+
+    eflags_optimizer = NULL;
+    eflags_count = eflags_ret = 0;
+
+    if ((flags & REIL_FLAG_DEAD_EFLAGS) && arch == VexArchX86)
+    {
+        // only temps that was used by removed instructions must be eliminated
+        eflags_optimizer = new CReilOptimizer(
+            REIL_PASS_DEAD_TEMP | ((flags & REIL_FLAG_OPTIMIZE) ? REIL_PASS_RENUMBER : 0));
+        assert(eflags_optimizer);
+    }
+
+    memset(&stats, 0, sizeof(stats));
+
+    // all of the generated IR goes to the user handler through inst_handler_proxy()
+    translator = new CReilFromBilTranslator(arch, inst_handler_proxy, this);
     assert(translator);
 }
 
 CReilTranslator::~CReilTranslator()
 {
     delete translator;
+
+    if (optimizer)
+    {
+        delete optimizer;
+    }
+
+    if (eflags_optimizer)
+    {
+        delete eflags_optimizer;
+    }
+
+    if (disk_cache)
+    {
+        delete disk_cache;
+    }
+
+    asmir_ctx_free(asmir_ctx);
 }
 
-int CReilTranslator::process_inst(address_t addr, uint8_t *data, int size)
+void CReilTranslator::set_inst_handler(reil_inst_handler_t handler, void *context)
+{
+    // pending IR code belongs to the old handler
+    flush();
+
+    inst_handler = handler;
+    inst_handler_context = context;
+}
+
+void CReilTranslator::get_stats(reil_stats_t *stats)
+{
+    memcpy(stats, &this->stats, sizeof(reil_stats_t));
+
+    stats->cache_entries = cache.size();
+
+    stats->arena_last = asmir_ctx->arena.peak_last;
+    stats->arena_peak = asmir_ctx->arena.peak;
+    stats->arena_size = asmir_ctx->arena.size;
+}
+
+bool CReilTranslator::set_disk_cache(const char *path, unsigned long long max_size)
+{
+    if (disk_cache)
+    {
+        delete disk_cache;
+        disk_cache = NULL;
+    }
+
+    if (path == NULL)
+    {
+        return true;
+    }
+
+    CReilDiskCache *cache = new CReilDiskCache(path, max_size);
+    assert(cache);
+
+    if (!cache->check())
+    {
+        delete cache;
+        return false;
+    }
+
+    /*
+        Cached IR code depends on target architecture, translator version, flags 
+        that are changing IR code and the way how address dependent constants are 
+        relocated, entries made with different values of any of them are never used.
+    */
+    uint32_t prefix[] = { REIL_TRANSLATOR_VERSION, (uint32_t)guest, 
+                          (uint32_t)(flags & REIL_FLAG_OPTIMIZE),
+                          sizeof(reil_inst_t), REIL_CACHE_PROBE_DELTA };
+
+    disk_cache_prefix = string((char *)prefix, sizeof(prefix));
+    disk_cache = cache;
+
+    return true;
+}
+
+int CReilTranslator::inst_handler_proxy(reil_inst_t *inst, void *context)
+{
+    CReilTranslator *self = (CReilTranslator *)context;
+
+    if (self->optimizer_record)
+    {
+        // IR code will be passed further after the optimization
+        self->optimizer_record->push_back(*inst);
+        return 0;
+    }
+
+    if (self->cache_record)
+    {
+        // save IR instruction into the translation cache
+        self->cache_record->push_back(*inst);
+    }
+
+    if (!self->cache_probe)
+    {
+        return self->deliver_inst(inst);
+    }
+
+    return 0;
+}
+
+int CReilTranslator::deliver_inst(reil_inst_t *inst)
+{
+    if (eflags_optimizer)
+    {
+        // keep IR code until the end of the basic block
+        eflags_record(inst);
+        return 0;
+    }
+
+    if (inst_handler)
+    {
+        // call user-specified REIL instruction handler
+        return inst_handler(inst, inst_handler_context);
+    }
+
+    return 0;
+}
+
+void CReilTranslator::eflags_record(reil_inst_t *inst)
+{
+    reil_inst_t copy = *inst;
+
+    if (inst->inum == 0)
+    {
+        // pointers that was passed by translator are valid only during handler call
+        eflags_raw.push_back(string((char *)inst->raw_info.data, inst->raw_info.size));
+        copy.raw_info.data = (unsigned char *)eflags_raw.back().data();
+
+        eflags_raw.push_back(string(inst->raw_info.str_mnem));
+        copy.raw_info.str_mnem = (char *)eflags_raw.back().c_str();
+
+        eflags_raw.push_back(string(inst->raw_info.str_op));
+        copy.raw_info.str_op = (char *)eflags_raw.back().c_str();
+    }
+
+    eflags_insts.push_back(copy);
+
+    if (inst->flags & IOPT_ASM_END)
+    {
+        eflags_count += 1;
+
+        if (inst->op == I_JCC || inst->op == I_UNK || eflags_count >= REIL_EFLAGS_MAX_INSNS)
+        {
+            // end of the basic block, error is reported by the next flush() call
+            eflags_ret = flush();
+        }
+    }
+}
+
+#define EFLAGS_BIT(_reg_) (1 << ((_reg_) - REIL_X86_CF))
+#define EFLAGS_ALL (EFLAGS_BIT(REIL_X86_OF + 1) - 1)
+
+static int eflags_arg_bits(reil_arg_t *arg)
+{
+    if (arg->type != A_REG)
+    {
+        return 0;
+    }
+
+    if (arg->reg >= REIL_X86_CF && arg->reg <= REIL_X86_OF)
+    {
+        return EFLAGS_BIT(arg->reg);
+    }
+
+    // read of R_EFLAGS needs all of the flags
+    return arg->reg == REIL_X86_EFLAGS ? EFLAGS_ALL : 0;
+}
+
+void CReilTranslator::eflags_optimize(void)
+{
+    int n = (int)eflags_insts.size(), live = EFLAGS_ALL;
+    vector<bool> dead(n, false);
+    bool removed = false;
+
+    // backward liveness analysis, all flags are live at the end of the block
+    for (int i = n - 1; i >= 0; i--)
+    {
+        reil_inst_t *inst = &eflags_insts[i];
+
+        if (inst->op == I_JCC || inst->op == I_UNK)
+        {
+            // flags are live at jump destination or might be used by unknown instruction
+            live = EFLAGS_ALL;
+        }
+        else if (inst->op != I_NONE && inst->op != I_STM)
+        {
+            int bits = eflags_arg_bits(&inst->c);
+
+            if (bits != 0 && bits != EFLAGS_ALL)
+            {
+                if (!(live & bits))
+                {
+                    // flag is redefined before it will be used
+                    dead[i] = removed = true;
+                    continue;
+                }
+
+                live &= ~bits;
+            }
+        }
+
+        live |= eflags_arg_bits(&inst->a) | eflags_arg_bits(&inst->b);
+
+        if (inst->op == I_STM || inst->op == I_JCC)
+        {
+            live |= eflags_arg_bits(&inst->c);
+        }
+    }
+
+    if (!removed)
+    {
+        return;
+    }
+
+    vector<reil_inst_t> insts, group;
+    int first = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (!(eflags_insts[i].flags & IOPT_ASM_END))
+        {
+            continue;
+        }
+
+        // IR code of the machine instruction is in range first .. i
+        reil_raw_t raw_info = eflags_insts[first].raw_info;
+
+        group.clear();
+
+        for (int k = first; k <= i; k++)
+        {
+            if (!dead[k]) group.push_back(eflags_insts[k]);
+        }
+
+        if ((int)group.size() < i - first + 1)
+        {
+            if (group.size() == 0)
+            {
+                // machine instruction must have at least one IR instruction
+                reil_inst_t inst;
+                memset(&inst, 0, sizeof(inst));
+
+                inst.raw_info = raw_info;
+                inst.op = I_NONE;
+                group.push_back(inst);
+            }
+
+            group.back().flags |= IOPT_ASM_END;
+
+            // remove temps that was used only by removed instructions
+            eflags_optimizer->optimize(group);
+
+            for (size_t k = 0; k < group.size(); k++)
+            {
+                // extended information about machine code goes to the first IR instruction
+                group[k].raw_info.data = k == 0 ? raw_info.data : NULL;
+                group[k].raw_info.str_mnem = k == 0 ? raw_info.str_mnem : NULL;
+                group[k].raw_info.str_op = k == 0 ? raw_info.str_op : NULL;
+            }
+        }
+
+        insts.insert(insts.end(), group.begin(), group.end());
+        first = i + 1;
+    }
+
+    // incomplete machine instruction, if any
+    insts.insert(insts.end(), eflags_insts.begin() + first, eflags_insts.end());
+
+    stats.eflags_removed += n - insts.size();
+
+    eflags_insts.swap(insts);
+}
+
+int CReilTranslator::flush(void)
+{
+    int ret = eflags_ret;
+
+    eflags_ret = 0;
+
+    if (eflags_insts.size() == 0)
+    {
+        return ret;
+    }
+
+    eflags_optimize();
+
+    for (size_t i = 0; i < eflags_insts.size() && ret != REIL_ERROR; i++)
+    {
+        if (inst_handler)
+        {
+            // call user-specified REIL instruction handler, stop on error
+            ret = inst_handler(&eflags_insts[i], inst_handler_context) == REIL_ERROR ? REIL_ERROR : 0;
+        }
+    }
+
+    eflags_insts.clear();
+    eflags_raw.clear();
+    eflags_count = 0;
+
+    return ret;
+}
+
+int CReilTranslator::get_inst_size(uint8_t *data)
+{
+    string str_mnem, str_op;
+
+    // use libasmir state of this instance in the current thread
+    asmir_ctx_set(asmir_ctx);
+
+    // returns -1 on invalid instruction
+    return disasm_insn(guest, data, str_mnem, str_op);
+}
+
+static reil_const_t cache_arg_mask(reil_size_t size)
+{
+    switch (size)
+    {
+    case U1: return 0x1;
+    case U8: return 0xff;
+    case U16: return 0xffff;
+    case U32: return 0xffffffff;
+    case U64: return 0xffffffffffffffffULL;
+    }
+
+    assert(0);
+}
+
+// returns -1 when arguments are different, 1 when argument must be relocated
+static int cache_arg_reloc(reil_arg_t *arg, reil_arg_t *arg_probe)
+{
+    if (arg->type != arg_probe->type || arg->size != arg_probe->size)
+    {
+        return -1;
+    }
+
+    if (arg->type == A_CONST)
+    {
+        reil_const_t mask = cache_arg_mask(arg->size);
+
+        if ((arg->val & mask) == (arg_probe->val & mask))
+        {
+            return 0;
+        }
+
+        // only pointer sized constants can hold the instruction address
+        if ((arg->size == U32 || arg->size == U64) && 
+            ((arg_probe->val - arg->val) & mask) == (REIL_CACHE_PROBE_DELTA & mask))
+        {
+            return 1;
+        }
+
+        return -1;
+    }
+
+    return strcmp(arg->name, arg_probe->name) ? -1 : 0;
+}
+
+static bool cache_has_pointers(vector<reil_inst_t> &insts)
+{
+    for (vector<reil_inst_t>::iterator it = insts.begin(); it != insts.end(); ++it)
+    {
+        reil_arg_t *args[] = { &it->a, &it->b, &it->c };
+
+        for (int i = 0; i < 3; i++)
+        {
+            // only pointer sized constants can hold the instruction address
+            if (args[i]->type == A_CONST && (args[i]->size == U32 || args[i]->size == U64))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool CReilTranslator::cache_relocs(reil_cache_entry *entry, vector<reil_inst_t> &probe)
+{
+    if (entry->insts.size() != probe.size())
+    {
+        return false;
+    }
+
+    entry->relocs.resize(probe.size());
+
+    for (size_t i = 0; i < probe.size(); i++)
+    {
+        reil_inst_t *inst = &entry->insts[i], *inst_probe = &probe[i];
+
+        if (inst->inum != inst_probe->inum || inst->op != inst_probe->op ||
+            inst->flags != inst_probe->flags || inst->raw_info.size != inst_probe->raw_info.size)
+        {
+            return false;
+        }
+
+        int reloc_a = cache_arg_reloc(&inst->a, &inst_probe->a);
+        int reloc_b = cache_arg_reloc(&inst->b, &inst_probe->b);
+        int reloc_c = cache_arg_reloc(&inst->c, &inst_probe->c);
+
+        if (reloc_a == -1 || reloc_b == -1 || reloc_c == -1)
+        {
+            return false;
+        }
+
+        entry->relocs[i] = (reloc_a ? REIL_RELOC_A : 0) | 
+                           (reloc_b ? REIL_RELOC_B : 0) | 
+                           (reloc_c ? REIL_RELOC_C : 0);
+    }
+
+    return true;
+}
+
+int CReilTranslator::cache_update(reil_cache_entry *entry, address_t addr, uint8_t *data, int size)
 {
+    vector<reil_inst_t> probe;
+    bool probe_ok = false;
     int ret = 0;
+
+    entry->insts.clear();
+    entry->addr = addr;
+
+    try
+    {
+        // translate instruction and save it's IR code
+        cache_record = &entry->insts;        
+        ret = translate_inst(addr, data, size);
+
+        cache_record = NULL;
+
+        if (cache_has_pointers(entry->insts))
+        {
+            /*
+                Translate the same instruction at different address to find IR constants 
+                that depends on instruction address (relative jumps, return addresses, etc.)
+            */
+            cache_record = &probe;
+            cache_probe = true;
+            translate_inst(addr + REIL_CACHE_PROBE_DELTA, data, size);
+        }
+        else
+        {
+            // IR code is position independent
+            probe = entry->insts;
+        }
+
+        probe_ok = true;
+    }
+    catch (...)
+    {
+        if (!cache_probe)
+        {
+            cache_record = NULL;
+            entry->state = REIL_CACHE_BAD;
+            entry->insts.clear();
+
+            throw;
+        }
+    }
+
+    cache_record = NULL;
+    cache_probe = false;
+
+    if (probe_ok && cache_relocs(entry, probe))
+    {
+        entry->state = REIL_CACHE_OK;
+    }
+    else
+    {
+        entry->state = REIL_CACHE_BAD;
+        entry->insts.clear();
+        entry->relocs.clear();
+
+        stats.cache_uncacheable += 1;
+    }
+
+    return ret;
+}
+
+void CReilTranslator::cache_replay(reil_cache_entry *entry, reil_raw_t *raw_info)
+{
+    reil_const_t delta = raw_info->addr - entry->addr;
+
+    if (entry->insts.size() > 0 && entry->insts[0].op == I_UNK)
+    {
+        // the same warning as CReilFromBilTranslator::process_bil() prints
+        fprintf(stderr, "WARNING: 0x%llx was not translated\n", raw_info->addr);
+    }
+
+    for (size_t i = 0; i < entry->insts.size(); i++)
+    {
+        reil_inst_t inst = entry->insts[i];
+        uint8_t relocs = entry->relocs[i];
+
+        inst.raw_info.addr = raw_info->addr;
+
+        if (inst.inum == 0)
+        {
+            // first IR instruction must contain extended information about machine code
+            inst.raw_info.data = raw_info->data;
+            inst.raw_info.str_mnem = raw_info->str_mnem;
+            inst.raw_info.str_op = raw_info->str_op;
+        }
+
+        if (relocs & REIL_RELOC_A) inst.a.val = (inst.a.val + delta) & cache_arg_mask(inst.a.size);
+        if (relocs & REIL_RELOC_B) inst.b.val = (inst.b.val + delta) & cache_arg_mask(inst.b.size);
+        if (relocs & REIL_RELOC_C) inst.c.val = (inst.c.val + delta) & cache_arg_mask(inst.c.size);
+
+        deliver_inst(&inst);
+    }
+}
+
+reil_cache_entry *CReilTranslator::cache_insert(string &key)
+{
+    if (cache.size() >= REIL_CACHE_MAX_ENTRIES)
+    {
+        // remove the oldest entry
+        map<string, reil_cache_entry>::iterator it = cache.find(cache_order.front());
+        if (it != cache.end())
+        {
+            if (it->second.state == REIL_CACHE_BAD)
+            {
+                stats.cache_uncacheable -= 1;
+            }
+
+            cache.erase(it);
+        }
+
+        cache_order.pop_front();
+    }
+
+    reil_cache_entry *entry = &cache[key];
+    entry->state = REIL_CACHE_SEEN;
+    entry->addr = 0;
+
+    cache_order.push_back(key);
+
+    return entry;
+}
+
+void CReilTranslator::cache_replay(reil_cache_entry *entry, address_t addr, uint8_t *data, int size, 
+                                   string &str_mnem, string &str_op)
+{
     reil_raw_t raw_info;
+
+    stats.cache_hits += 1;
+
     memset(&raw_info, 0, sizeof(raw_info));
+    raw_info.addr = addr;
+    raw_info.size = size;
+    raw_info.data = data;
+
+    // cast to char* is needed for successful work with cython
+    raw_info.str_mnem = (char *)str_mnem.c_str();
+    raw_info.str_op = (char *)str_op.c_str();
+
+    cache_replay(entry, &raw_info);
+}
+
+int CReilTranslator::process_inst(address_t addr, uint8_t *data, int size)
+{
+    // use libasmir state of this instance in the current thread
+    asmir_ctx_set(asmir_ctx);
+
+    if (flags & REIL_FLAG_NO_CACHE)
+    {
+        return translate_inst(addr, data, size);
+    }
+
+    string str_mnem, str_op;
+
+    int inst_size = disasm_insn(guest, data, str_mnem, str_op);
+    if (inst_size <= 0)
+    {
+        // let the translator to handle an error
+        return translate_inst(addr, data, size);
+    }
+
+    string key((char *)data, inst_size);
+    map<string, reil_cache_entry>::iterator it = cache.find(key);
+
+    if (it == cache.end() && disk_cache)
+    {
+        string disk_key = disk_cache_prefix + key;
+        reil_cache_entry *entry = cache_insert(key);
+
+        if (disk_cache->load(disk_key, &entry->addr, entry->insts, entry->relocs))
+        {
+            stats.disk_hits += 1;
+
+            entry->state = REIL_CACHE_OK;
+            cache_replay(entry, addr, data, inst_size, str_mnem, str_op);
+            
+            return inst_size;
+        }
+
+        stats.cache_misses += 1;
+
+        // entry will be saved when instruction occurs again and it's IR code is verified
+        return translate_inst(addr, data, size);
+    }
+
+    if (it == cache.end())
+    {
+        stats.cache_misses += 1;
+
+        // remember the instruction, it will be cached when it occurs again
+        cache_insert(key);
+
+        return translate_inst(addr, data, size);
+    }
+
+    reil_cache_entry *entry = &it->second;
+
+    switch (entry->state)
+    {
+    case REIL_CACHE_OK:
+
+        cache_replay(entry, addr, data, inst_size, str_mnem, str_op);
+        return inst_size;
+
+    case REIL_CACHE_SEEN:
+        {
+            stats.cache_misses += 1;
+
+            int ret = cache_update(entry, addr, data, size);
+
+            if (entry->state == REIL_CACHE_OK && disk_cache)
+            {
+                string disk_key = disk_cache_prefix + key;
+
+                stats.disk_stores += 1;
+
+                disk_cache->store(disk_key, entry->addr, entry->insts, entry->relocs);
+            }
+
+            return ret;
+        }
+
+    default:
+
+        stats.cache_misses += 1;
+        return translate_inst(addr, data, size);
+    }
+}
+
+int CReilTranslator::translate_inst(address_t addr, uint8_t *data, int size)
+{
+    int ret = 0;
+
+    // use libasmir state of this instance in the current thread
+    asmir_ctx_set(asmir_ctx);
     
-    // translate to VEX
-    bap_block_t *block = generate_vex_ir(guest, data, addr);
+    bap_block_t *block = NULL;
+
+    if (flags & REIL_FLAG_DIRECT)
+    {
+        // translate to VEX and BAP without copying of VEX IR
+        block = generate_bap_ir_direct(guest, data, addr, false);
+
+        assert(block);
+        assert(block->inst_size != 0 && block->inst_size != -1);
+
+        ret = block->inst_size;
+    }
+    else
+    {
+        // translate to VEX
+        block = generate_vex_ir(guest, data, addr);
     
-    assert(block);
-    assert(block->inst_size != 0 && block->inst_size != -1);
+        assert(block);
+        assert(block->inst_size != 0 && block->inst_size != -1);
 
-    ret = block->inst_size;
+        ret = block->inst_size;
 
-    // tarnslate to BAP
-    generate_bap_ir_block(guest, block);  
+        // tarnslate to BAP
+        generate_bap_ir_block(guest, block);  
+    }
+
+    translate_block(block, data);
+    
+    // free VEX memory
+    // asmir_close() is also doing that
+    vx_FreeAll();
+    
+    return ret;
+}
+
+void CReilTranslator::translate_block(bap_block_t *block, uint8_t *data)
+{
+    reil_raw_t raw_info;
+    memset(&raw_info, 0, sizeof(raw_info));
 
 #ifdef DBG_BAP
 
     printf(
         "// %.8llx: %s %s ; len = %d\n",
-        addr, block->str_mnem.c_str(), block->str_op.c_str(), 
+        block->inst, block->str_mnem.c_str(), block->str_op.c_str(), 
         block->inst_size
     );              
     
 #endif
 
-    raw_info.addr = addr;
-    raw_info.size = ret;
+    raw_info.addr = block->inst;
+    raw_info.size = block->inst_size;
     raw_info.data = data;
 
     // cast to char* is needed for successful work with cython
     raw_info.str_mnem = (char *)block->str_mnem.c_str();
     raw_info.str_op = (char *)block->str_op.c_str();
 
-    // generate REIL
-    translator->process_bil(&raw_info, block);
+    if (optimizer)
+    {
+        vector<reil_inst_t> insts;
+
+        // collect IR code of the machine instruction
+        optimizer_record = &insts;
+
+        try
+        {
+            translator->process_bil(&raw_info, block);
+        }
+        catch (...)
+        {
+            optimizer_record = NULL;
+            throw;
+        }
+
+        optimizer_record = NULL;
+
+        stats.opt_removed += optimizer->optimize(insts);
+
+        for (size_t i = 0; i < insts.size(); i++)
+        {
+            reil_inst_t *inst = &insts[i];
+
+            // extended information about machine code goes to the first IR instruction
+            inst->raw_info.data = i == 0 ? raw_info.data : NULL;
+            inst->raw_info.str_mnem = i == 0 ? raw_info.str_mnem : NULL;
+            inst->raw_info.str_op = i == 0 ? raw_info.str_op : NULL;
+
+            inst_handler_proxy(inst, this);
+        }
+    }
+    else
+    {
+        // generate REIL
+        translator->process_bil(&raw_info, block);
+    }
 
     for (int i = 0; i < block->bap_ir->size(); i++)
     {
@@ -1569,11 +2323,64 @@ int CReilTranslator::process_inst(address_t addr, uint8_t *data, int size)
     }
 
     delete block->bap_ir;
-    delete block;        
-    
+    delete block;
+}
+
+int CReilTranslator::process_insns(address_t addr, uint8_t *data, int size, int *insns_count)
+{
+    // use libasmir state of this instance in the current thread
+    asmir_ctx_set(asmir_ctx);
+
+    // VEX may read all of the instructions that we asked for
+    int max_insns = min(REIL_BLOCK_MAX_INSNS, size / MAX_INST_LEN);
+
+    if (!(flags & REIL_FLAG_BLOCK) || max_insns < 2)
+    {
+        *insns_count = 1;
+        return process_inst(addr, data, size);
+    }
+
+    // translate to VEX and BAP, REIL_FLAG_BLOCK doesn't use translation cache
+    vector<bap_block_t *> blocks = generate_bap_ir_insns(
+        guest, data, addr, max_insns, (flags & REIL_FLAG_DIRECT) != 0
+    );
+
+    if (blocks.size() == 0)
+    {
+        *insns_count = 1;
+        return process_inst(addr, data, size);
+    }
+
+    int ret = 0;
+
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        bap_block_t *block = blocks.at(i);
+        int inst_size = block->inst_size;
+
+        assert(block->inst == addr + ret);
+
+        try
+        {
+            // generate REIL, block is freed by translate_block()
+            translate_block(block, data + ret);
+        }
+        catch (...)
+        {
+            // free this and the rest of untranslated blocks
+            blocks.erase(blocks.begin(), blocks.begin() + i);
+            free_bap_blocks(blocks);
+
+            throw;
+        }
+
+        ret += inst_size;
+    }
+
     // free VEX memory
-    // asmir_close() is also doing that
     vx_FreeAll();
-    
+
+    *insns_count = blocks.size();
+
     return ret;
 }
@@ -0,0 +1,1054 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+
+using namespace std;
+
+// libasmir includes
+#include "libvex.h"
+
+// OpenREIL includes
+#include "libopenreil.h"
+#include "reil_vm.h"
+#include "reil_jit.h"
+
+static int vm_arg_bits(reil_size_t size)
+{
+    switch (size)
+    {
+    case U1: return 1;
+    case U8: return 8;
+    case U16: return 16;
+    case U32: return 32;
+    case U64: return 64;
+    }
+
+    assert(0);
+}
+
+static inline reil_const_t vm_mask(int bits)
+{
+    return bits >= 64 ? 0xffffffffffffffffULL : ((1ULL << bits) - 1);
+}
+
+static inline reil_const_t vm_sign_extend(reil_const_t val, int bits)
+{
+    if (bits >= 64)
+    {
+        return val;
+    }
+
+    reil_const_t sign = 1ULL << (bits - 1);
+
+    return ((val & vm_mask(bits)) ^ sign) - sign;
+}
+
+CReilVm::CReilVm(VexArch arch, reil_vm_mem_handler_t handler, void *context, int flags)
+{
+    guest = arch;
+
+    mem_handler = handler;
+    mem_handler_context = context;
+    strict = (flags & REIL_VM_FLAG_STRICT) != 0;
+    jit = NULL;
+
+    if (flags & REIL_VM_FLAG_JIT)
+    {
+        jit = new CReilJit();
+        assert(jit);
+
+        if (!jit->is_ready())
+        {
+            // use interpreter only
+            delete jit;
+            jit = NULL;
+        }
+    }
+
+    memset(page_cache, 0, sizeof(page_cache));
+    snap_base = NULL;
+
+    // instruction pointer is updated before each machine instruction
+    reg_ip = guest == VexArchX86 ? reg_index("R_EIP", U32) : -1;
+}
+
+CReilVm::~CReilVm()
+{
+    mem_clear();
+
+    if (jit)
+    {
+        delete jit;
+    }
+}
+
+int CReilVm::reg_index(const char *name, reil_size_t size)
+{
+    map<string, int>::iterator it = regs_index.find(name);
+    if (it != regs_index.end())
+    {
+        return it->second;
+    }
+
+    reil_vm_reg_info reg;
+    reg.name = name;
+    reg.size = size;
+    reg.mask = vm_mask(vm_arg_bits(size));
+
+    regs.push_back(reg);
+    regs_val.push_back(0);
+
+    return regs_index[name] = regs.size() - 1;
+}
+
+void CReilVm::convert_arg(reil_arg_t *arg, reil_vm_arg *vm_arg)
+{
+    memset(vm_arg, 0, sizeof(reil_vm_arg));
+
+    vm_arg->type = arg->type;
+    vm_arg->size = arg->size;
+    vm_arg->bits = vm_arg_bits(arg->size);
+    vm_arg->mask = vm_mask(vm_arg->bits);
+
+    switch (arg->type)
+    {
+    case A_REG:
+
+        vm_arg->reg = reg_index(arg->name, arg->size);
+        break;
+
+    case A_TEMP:
+        {
+            char name[REIL_MAX_NAME_LEN + 8];
+
+            // temps are local to machine instruction and can have different sizes
+            snprintf(name, sizeof(name), "%s:%d", arg->name, vm_arg->bits);
+
+            vm_arg->reg = reg_index(name, arg->size);
+            break;
+        }
+
+    case A_CONST:
+
+        vm_arg->val = arg->val & vm_arg->mask;
+        break;
+
+    default:
+
+        vm_arg->bits = 1;
+        break;
+    }
+}
+
+void CReilVm::add_code(reil_inst_t *insts, int count)
+{
+    assert(count > 0);
+
+    reil_addr_t addr = insts[0].raw_info.addr;
+    map<reil_addr_t, reil_vm_insn>::iterator it = code.find(addr);
+
+    if (it != code.end())
+    {
+        // old code is replaced in place, so, next links of other instructions are still valid
+        jit_invalidate(&it->second);
+
+        it->second.insts.clear();
+    }
+
+    reil_vm_insn *entry = &code[addr];
+    entry->addr = addr;
+    entry->size = insts[0].raw_info.size;
+    entry->next = NULL;
+    entry->bb_end = false;
+    entry->jit_block = NULL;
+    entry->jit_skip = false;
+
+    map<reil_addr_t, vector<reil_inum_t> >::iterator brk = breaks.find(addr);
+
+    for (int i = 0; i < count; i++)
+    {
+        reil_vm_inst inst;
+
+        inst.op = insts[i].op;
+        inst.inum = insts[i].inum;
+        inst.brk = false;
+
+        convert_arg(&insts[i].a, &inst.a);
+        convert_arg(&insts[i].b, &inst.b);
+        convert_arg(&insts[i].c, &inst.c);
+
+        if (insts[i].flags & (IOPT_BB_END | IOPT_CALL))
+        {
+            // calls are not ending basic blocks but the rest of the code is unreachable
+            entry->bb_end = true;
+        }
+
+        if (brk != breaks.end())
+        {
+            vector<reil_inum_t> &inums = brk->second;
+
+            inst.brk = find(inums.begin(), inums.end(), inst.inum) != inums.end();
+        }
+
+        entry->insts.push_back(inst);
+    }
+}
+
+void CReilVm::clear_code(void)
+{
+    code.clear();
+
+    if (jit)
+    {
+        jit->flush();
+    }
+}
+
+void CReilVm::set_break(reil_addr_t addr, reil_inum_t inum)
+{
+    breaks[addr].push_back(inum);
+
+    // compiled code might contain this instruction
+    jit_flush();
+
+    map<reil_addr_t, reil_vm_insn>::iterator it = code.find(addr);
+    if (it != code.end())
+    {
+        vector<reil_vm_inst> &insts = it->second.insts;
+
+        for (size_t i = 0; i < insts.size(); i++)
+        {
+            if (insts[i].inum == inum) insts[i].brk = true;
+        }
+    }
+}
+
+void CReilVm::clear_break(void)
+{
+    breaks.clear();
+    jit_flush();
+
+    for (map<reil_addr_t, reil_vm_insn>::iterator it = code.begin(); it != code.end(); ++it)
+    {
+        vector<reil_vm_inst> &insts = it->second.insts;
+
+        for (size_t i = 0; i < insts.size(); i++)
+        {
+            insts[i].brk = false;
+        }
+    }
+}
+
+reil_vm_page *CReilVm::mem_page(reil_addr_t addr, bool alloc)
+{
+    addr &= ~(reil_addr_t)(REIL_VM_PAGE_SIZE - 1);
+
+    reil_vm_page_cache *cache = &page_cache[(addr >> REIL_VM_PAGE_BITS) & (REIL_VM_PAGE_CACHE - 1)];
+
+    if (cache->page && cache->addr == addr)
+    {
+        return cache->page;
+    }
+
+    reil_vm_page *page = NULL;
+    map<reil_addr_t, reil_vm_page *>::iterator it = pages.find(addr);
+
+    if (it != pages.end())
+    {
+        page = it->second;
+    }
+    else if (alloc)
+    {
+        page = (reil_vm_page *)calloc(1, sizeof(reil_vm_page));
+        assert(page);
+
+        page->refs = 1;
+        pages[addr] = page;
+        pages_dirty.insert(addr);
+    }
+    else
+    {
+        return NULL;
+    }
+
+    cache->page = page;
+    cache->addr = addr;
+
+    return page;
+}
+
+reil_vm_page *CReilVm::mem_page_write(reil_addr_t addr, bool alloc)
+{
+    reil_vm_page *page = mem_page(addr, alloc);
+
+    if (page == NULL || page->refs == 1)
+    {
+        return page;
+    }
+
+    // page is shared with snapshot, make a private copy
+    reil_vm_page *copy = (reil_vm_page *)malloc(sizeof(reil_vm_page));
+    assert(copy);
+
+    memcpy(copy, page, sizeof(reil_vm_page));
+    copy->refs = 1;
+    page->refs -= 1;
+
+    addr &= ~(reil_addr_t)(REIL_VM_PAGE_SIZE - 1);
+
+    pages[addr] = copy;
+    pages_dirty.insert(addr);
+
+    // mem_page() call above has put the page into the cache
+    page_cache[(addr >> REIL_VM_PAGE_BITS) & (REIL_VM_PAGE_CACHE - 1)].page = copy;
+
+    return copy;
+}
+
+void CReilVm::mem_page_release(reil_vm_page *page)
+{
+    if (--page->refs == 0)
+    {
+        free(page);
+    }
+}
+
+void CReilVm::mem_alloc(reil_addr_t addr, int size, uint8_t *data)
+{
+    for (int i = 0; i < size; i++)
+    {
+        reil_vm_page *page = mem_page_write(addr + i, true);
+        int offset = (addr + i) & (REIL_VM_PAGE_SIZE - 1);
+
+        page->data[offset] = data ? data[i] : 0;
+        page->valid[offset / 8] |= 1 << (offset % 8);
+    }
+}
+
+static inline bool page_valid(reil_vm_page *page, int offset, int size)
+{
+    for (int i = offset; i < offset + size; i++)
+    {
+        if (!(page->valid[i / 8] & (1 << (i % 8))))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CReilVm::mem_read(reil_addr_t addr, int size, uint8_t *buff)
+{
+    int offset = addr & (REIL_VM_PAGE_SIZE - 1);
+
+    if (offset + size <= REIL_VM_PAGE_SIZE)
+    {
+        // access within single page
+        reil_vm_page *page = mem_page(addr, false);
+
+        if (page == NULL || !page_valid(page, offset, size))
+        {
+            return false;
+        }
+
+        memcpy(buff, page->data + offset, size);
+        return true;
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        reil_vm_page *page = mem_page(addr + i, false);
+        int offset = (addr + i) & (REIL_VM_PAGE_SIZE - 1);
+
+        if (page == NULL || !(page->valid[offset / 8] & (1 << (offset % 8))))
+        {
+            return false;
+        }
+
+        buff[i] = page->data[offset];
+    }
+
+    return true;
+}
+
+bool CReilVm::mem_write(reil_addr_t addr, int size, uint8_t *buff)
+{
+    int offset = addr & (REIL_VM_PAGE_SIZE - 1);
+
+    if (offset + size <= REIL_VM_PAGE_SIZE)
+    {
+        // access within single page
+        reil_vm_page *page = mem_page_write(addr, false);
+
+        if (page == NULL || !page_valid(page, offset, size))
+        {
+            return false;
+        }
+
+        memcpy(page->data + offset, buff, size);
+        return true;
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        reil_vm_page *page = mem_page(addr + i, false);
+        int offset = (addr + i) & (REIL_VM_PAGE_SIZE - 1);
+
+        if (page == NULL || !(page->valid[offset / 8] & (1 << (offset % 8))))
+        {
+            return false;
+        }
+    }
+
+    mem_alloc(addr, size, buff);
+
+    return true;
+}
+
+void CReilVm::mem_clear(void)
+{
+    for (map<reil_addr_t, reil_vm_page *>::iterator it = pages.begin(); it != pages.end(); ++it)
+    {
+        mem_page_release(it->second);
+    }
+
+    pages.clear();
+    pages_dirty.clear();
+    snap_base = NULL;
+
+    memset(page_cache, 0, sizeof(page_cache));
+}
+
+reil_vm_snap *CReilVm::snapshot(void)
+{
+    reil_vm_snap *snap = new reil_vm_snap;
+    assert(snap);
+
+    // share all of the memory pages with the snapshot
+    for (map<reil_addr_t, reil_vm_page *>::iterator it = pages.begin(); it != pages.end(); ++it)
+    {
+        it->second->refs += 1;
+    }
+
+    snap->pages = pages;
+    snap->regs_val = regs_val;
+
+    pages_dirty.clear();
+    snap_base = snap;
+
+    return snap;
+}
+
+void CReilVm::restore(reil_vm_snap *snap)
+{
+    if (snap == snap_base)
+    {
+        // revert only pages that were modified since the snapshot
+        for (set<reil_addr_t>::iterator it = pages_dirty.begin(); it != pages_dirty.end(); ++it)
+        {
+            map<reil_addr_t, reil_vm_page *>::iterator page = pages.find(*it);
+            map<reil_addr_t, reil_vm_page *>::iterator page_snap = snap->pages.find(*it);
+
+            if (page != pages.end())
+            {
+                mem_page_release(page->second);
+                pages.erase(page);
+            }
+
+            if (page_snap != snap->pages.end())
+            {
+                page_snap->second->refs += 1;
+                pages[*it] = page_snap->second;
+            }
+        }
+    }
+    else
+    {
+        for (map<reil_addr_t, reil_vm_page *>::iterator it = pages.begin(); it != pages.end(); ++it)
+        {
+            mem_page_release(it->second);
+        }
+
+        for (map<reil_addr_t, reil_vm_page *>::iterator it = snap->pages.begin(); it != snap->pages.end(); ++it)
+        {
+            it->second->refs += 1;
+        }
+
+        pages = snap->pages;
+    }
+
+    pages_dirty.clear();
+    snap_base = snap;
+
+    memset(page_cache, 0, sizeof(page_cache));
+
+    for (size_t i = 0; i < regs_val.size(); i++)
+    {
+        // registers that was created after the snapshot are zeroed
+        regs_val[i] = i < snap->regs_val.size() ? snap->regs_val[i] : 0;
+    }
+}
+
+void CReilVm::snapshot_free(reil_vm_snap *snap)
+{
+    for (map<reil_addr_t, reil_vm_page *>::iterator it = snap->pages.begin(); it != snap->pages.end(); ++it)
+    {
+        mem_page_release(it->second);
+    }
+
+    if (snap == snap_base)
+    {
+        snap_base = NULL;
+    }
+
+    delete snap;
+}
+
+bool CReilVm::mem_load(reil_addr_t addr, int size, reil_const_t *val)
+{
+    uint8_t buff[sizeof(reil_const_t)];
+
+    if (!mem_read(addr, size, buff))
+    {
+        if (mem_handler == NULL)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < size;)
+        {
+            reil_vm_page *page = mem_page(addr + i, false);
+            int offset = (addr + i) & (REIL_VM_PAGE_SIZE - 1);
+
+            if (page && page_valid(page, offset, 1))
+            {
+                // byte is already known, it might be modified by guest code
+                i += 1;
+                continue;
+            }
+
+            int count = 1;
+
+            // find the range of unknown bytes
+            while (i + count < size)
+            {
+                page = mem_page(addr + i + count, false);
+                offset = (addr + i + count) & (REIL_VM_PAGE_SIZE - 1);
+
+                if (page && page_valid(page, offset, 1))
+                {
+                    break;
+                }
+
+                count += 1;
+            }
+
+            // ask the user for the memory contents
+            if (mem_handler(addr + i, count, buff + i, mem_handler_context) != 0)
+            {
+                return false;
+            }
+
+            mem_alloc(addr + i, count, buff + i);
+            i += count;
+        }
+
+        if (!mem_read(addr, size, buff))
+        {
+            return false;
+        }
+    }
+
+    *val = 0;
+
+    // guest memory is little endian
+    for (int i = size - 1; i >= 0; i--)
+    {
+        *val = (*val << 8) | buff[i];
+    }
+
+    return true;
+}
+
+bool CReilVm::mem_store(reil_addr_t addr, int size, reil_const_t val)
+{
+    uint8_t buff[sizeof(reil_const_t)];
+
+    for (int i = 0; i < size; i++)
+    {
+        buff[i] = (uint8_t)(val >> (i * 8));
+    }
+
+    if (!mem_write(addr, size, buff))
+    {
+        uint8_t temp[sizeof(reil_const_t)];
+
+        // memory that is known to the user can be allocated on write
+        if (strict && (mem_handler == NULL || mem_handler(addr, size, temp, mem_handler_context) != 0))
+        {
+            return false;
+        }
+
+        mem_alloc(addr, size, buff);
+    }
+
+    return true;
+}
+
+int CReilVm::jit_mem_load(reil_jit_ctx *ctx, reil_addr_t addr, int size, reil_const_t *val)
+{
+    CReilVm *vm = (CReilVm *)ctx->vm;
+    int ret = vm->mem_load(addr, size, val) ? 1 : 0;
+
+    // memory handler might add new registers and reallocate register file
+    ctx->regs = &vm->regs_val[0];
+
+    return ret;
+}
+
+int CReilVm::jit_mem_store(reil_jit_ctx *ctx, reil_addr_t addr, int size, reil_const_t val)
+{
+    CReilVm *vm = (CReilVm *)ctx->vm;
+    int ret = vm->mem_store(addr, size, val) ? 1 : 0;
+
+    // memory handler might add new registers and reallocate register file
+    ctx->regs = &vm->regs_val[0];
+
+    return ret;
+}
+
+void CReilVm::jit_compile(reil_vm_insn *first)
+{
+    vector<reil_vm_insn *> insns;
+    reil_vm_insn *insn = first;
+    reil_const_t ip_mask = reg_ip == -1 ? 0 : regs[reg_ip].mask;
+
+    // collect machine instructions of the basic block
+    while (insn && insns.size() < REIL_JIT_MAX_INSNS && CReilJit::can_compile(insn))
+    {
+        insns.push_back(insn);
+
+        if (insn->bb_end)
+        {
+            break;
+        }
+
+        map<reil_addr_t, reil_vm_insn>::iterator it = code.find(insn->addr + insn->size);
+        insn = it == code.end() ? NULL : &it->second;
+    }
+
+    if (insns.size() == 0)
+    {
+        // instruction must be executed by interpreter
+        first->jit_skip = true;
+        return;
+    }
+
+    void *block = jit->compile(insns, reg_ip, ip_mask);
+    if (block == NULL)
+    {
+        // code cache is full
+        jit_flush();
+
+        block = jit->compile(insns, reg_ip, ip_mask);
+    }
+
+    first->jit_block = block;
+
+    if (block)
+    {
+        for (size_t i = 0; i < insns.size(); i++)
+        {
+            vector<reil_addr_t> &refs = insns[i]->jit_refs;
+
+            // block might be compiled again after invalidation
+            if (find(refs.begin(), refs.end(), first->addr) == refs.end())
+            {
+                refs.push_back(first->addr);
+            }
+        }
+    }
+}
+
+void CReilVm::jit_invalidate(reil_vm_insn *insn)
+{
+    if (jit == NULL)
+    {
+        return;
+    }
+
+    // remove all of the compiled blocks that contain this instruction
+    for (size_t i = 0; i < insn->jit_refs.size(); i++)
+    {
+        map<reil_addr_t, reil_vm_insn>::iterator it = code.find(insn->jit_refs[i]);
+        if (it != code.end())
+        {
+            it->second.jit_block = NULL;
+        }
+
+        jit->invalidate(insn->jit_refs[i]);
+    }
+
+    insn->jit_refs.clear();
+}
+
+void CReilVm::jit_flush(void)
+{
+    if (jit == NULL)
+    {
+        return;
+    }
+
+    for (map<reil_addr_t, reil_vm_insn>::iterator it = code.begin(); it != code.end(); ++it)
+    {
+        it->second.jit_block = NULL;
+        it->second.jit_skip = false;
+        it->second.jit_refs.clear();
+    }
+
+    jit->flush();
+}
+
+#define VM_ARG(_arg_) ((_arg_).type == A_CONST ? (_arg_).val : (regs_val[(_arg_).reg] & (_arg_).mask))
+
+int CReilVm::run(reil_addr_t addr, reil_vm_exit_t *exit)
+{
+    map<reil_addr_t, reil_vm_insn>::iterator it = code.find(addr);
+    reil_vm_insn *current = it == code.end() ? NULL : &it->second;
+    reil_vm_inst *inst = NULL, *end = NULL;
+    reil_jit_ctx ctx;
+
+    memset(exit, 0, sizeof(reil_vm_exit_t));
+    memset(&ctx, 0, sizeof(ctx));
+
+    ctx.mem_load = jit_mem_load;
+    ctx.mem_store = jit_mem_store;
+    ctx.vm = this;
+
+    while (current)
+    {
+        bool jump = false;
+
+        if (jit && current->jit_block == NULL && !current->jit_skip)
+        {
+            jit_compile(current);
+        }
+
+        if (jit && current->jit_block)
+        {
+            ctx.regs = &regs_val[0];
+
+            // execute compiled code until it will need the dispatcher
+            jit->exec(current->jit_block, &ctx);
+
+            if (ctx.reason != REIL_VM_NO_CODE)
+            {
+                exit->reason = ctx.reason;
+                exit->addr = ctx.addr;
+                exit->inum = ctx.inum;
+                exit->mem_addr = ctx.mem_addr;
+
+                return exit->reason;
+            }
+
+            addr = ctx.addr;
+            it = code.find(addr);
+            current = it == code.end() ? NULL : &it->second;
+            continue;
+        }
+
+        inst = &current->insts[0];
+        end = inst + current->insts.size();
+
+        if (reg_ip != -1)
+        {
+            regs_val[reg_ip] = current->addr & regs[reg_ip].mask;
+        }
+
+        for (; inst < end; inst++)
+        {
+            if (inst->brk)
+            {
+                exit->reason = REIL_VM_STOP;
+                goto _stop;
+            }
+
+            reil_const_t a = VM_ARG(inst->a), b = VM_ARG(inst->b), ret = 0;
+
+            // operands are promoted to the widest of them, one bit values are bytes
+            int bits = max(max(inst->a.bits, inst->b.bits), 8);
+
+            switch (inst->op)
+            {
+            case I_NONE:
+
+                continue;
+
+            case I_JCC:
+
+                if (a != 0)
+                {
+                    addr = VM_ARG(inst->c);
+                    jump = true;
+                    goto _end;
+                }
+
+                continue;
+
+            case I_STM:
+
+                if (!mem_store(VM_ARG(inst->c), vm_arg_bits(inst->a.size) / 8, a))
+                {
+                    exit->reason = REIL_VM_MEM_WRITE;
+                    exit->mem_addr = VM_ARG(inst->c);
+                    goto _stop;
+                }
+
+                continue;
+
+            case I_LDM:
+
+                if (!mem_load(a, vm_arg_bits(inst->c.size) / 8, &ret))
+                {
+                    exit->reason = REIL_VM_MEM_READ;
+                    exit->mem_addr = a;
+                    goto _stop;
+                }
+
+                regs_val[inst->c.reg] = ret & inst->c.mask;
+                continue;
+
+            case I_STR: ret = a; break;
+            case I_ADD: ret = a + b; break;
+            case I_SUB: ret = a - b; break;
+            case I_NEG: ret = -a; break;
+            case I_MUL: ret = a * b; break;
+            case I_AND: ret = a & b; break;
+            case I_OR:  ret = a | b; break;
+            case I_XOR: ret = a ^ b; break;
+            case I_NOT: ret = ~a; break;
+            case I_EQ:  ret = a == b ? 1 : 0; break;
+            case I_LT:  ret = a < b ? 1 : 0; break;
+            case I_DIV: ret = b == 0 ? 0 : a / b; break;
+            case I_MOD: ret = b == 0 ? 0 : a % b; break;
+            case I_SHL: ret = b >= (reil_const_t)bits ? 0 : a << b; break;
+            case I_SHR: ret = b >= (reil_const_t)bits ? 0 : a >> b; break;
+
+            case I_SMUL:
+            case I_SDIV:
+            case I_SMOD:
+                {
+                    // signed operands, one bit values are never negative
+                    int64_t sa = inst->a.bits == 1 ? a : vm_sign_extend(a, inst->a.bits);
+                    int64_t sb = inst->b.bits == 1 ? b : vm_sign_extend(b, inst->b.bits);
+                    int64_t sret = 0;
+
+                    if (inst->op == I_SMUL)
+                    {
+                        sret = (int64_t)((reil_const_t)sa * (reil_const_t)sb);
+                    }
+                    else if (sb != 0 && !(sb == -1 && sa == (int64_t)(1ULL << 63)))
+                    {
+                        // the same rounding as python integers have
+                        int64_t q = sa / sb, r = sa % sb;
+
+                        if (r != 0 && ((r < 0) != (sb < 0)))
+                        {
+                            q -= 1;
+                            r += sb;
+                        }
+
+                        sret = inst->op == I_SDIV ? q : r;
+                    }
+
+                    // negative result is sign extended to the destination size
+                    ret = vm_sign_extend(sret, bits);
+                    break;
+                }
+
+            default:
+
+                exit->reason = REIL_VM_INVALID;
+                goto _stop;
+            }
+
+            if (inst->op != I_STR && inst->op != I_SMUL &&
+                inst->op != I_SDIV && inst->op != I_SMOD)
+            {
+                ret &= vm_mask(bits);
+            }
+
+            if (inst->a.bits == 1 && inst->b.bits == 1)
+            {
+                // one bit expression
+                ret &= 1;
+            }
+
+            regs_val[inst->c.reg] = ret & inst->c.mask;
+        }
+_end:
+        if (jump)
+        {
+            it = code.find(addr);
+            current = it == code.end() ? NULL : &it->second;
+        }
+        else
+        {
+            addr = current->addr + current->size;
+
+            if (current->next == NULL)
+            {
+                it = code.find(addr);
+
+                // chain code of the next machine instruction
+                current->next = it == code.end() ? NULL : &it->second;
+            }
+
+            current = current->next;
+        }
+    }
+
+    exit->reason = REIL_VM_NO_CODE;
+    exit->addr = addr;
+
+    return exit->reason;
+
+_stop:
+
+    exit->addr = current->addr;
+    exit->inum = inst->inum;
+
+    return exit->reason;
+}
+
+extern "C" reil_vm_t reil_vm_init(reil_arch_t arch, reil_vm_mem_handler_t handler, void *context, int flags)
+{
+    VexArch guest;
+
+    switch (arch)
+    {
+    case ARCH_X86:
+
+        guest = VexArchX86;
+        break;
+
+    default:
+
+        assert(0);
+    }
+
+    CReilVm *vm = new CReilVm(guest, handler, context, flags);
+    assert(vm);
+
+    return vm;
+}
+
+extern "C" void reil_vm_close(reil_vm_t vm)
+{
+    delete (CReilVm *)vm;
+}
+
+extern "C" int reil_vm_code(reil_vm_t vm, reil_inst_t *insts, int count)
+{
+    if (count <= 0)
+    {
+        return REIL_ERROR;
+    }
+
+    ((CReilVm *)vm)->add_code(insts, count);
+
+    return 0;
+}
+
+extern "C" void reil_vm_code_clear(reil_vm_t vm)
+{
+    ((CReilVm *)vm)->clear_code();
+}
+
+extern "C" void reil_vm_break(reil_vm_t vm, reil_addr_t addr, reil_inum_t inum)
+{
+    ((CReilVm *)vm)->set_break(addr, inum);
+}
+
+extern "C" void reil_vm_break_clear(reil_vm_t vm)
+{
+    ((CReilVm *)vm)->clear_break();
+}
+
+extern "C" int reil_vm_run(reil_vm_t vm, reil_addr_t addr, reil_vm_exit_t *exit)
+{
+    return ((CReilVm *)vm)->run(addr, exit);
+}
+
+extern "C" int reil_vm_reg(reil_vm_t vm, const char *name, reil_size_t size)
+{
+    return ((CReilVm *)vm)->reg_index(name, size);
+}
+
+extern "C" int reil_vm_reg_count(reil_vm_t vm)
+{
+    return ((CReilVm *)vm)->reg_count();
+}
+
+extern "C" const char *reil_vm_reg_name(reil_vm_t vm, int reg)
+{
+    return ((CReilVm *)vm)->reg_info(reg)->name.c_str();
+}
+
+extern "C" reil_size_t reil_vm_reg_size(reil_vm_t vm, int reg)
+{
+    return ((CReilVm *)vm)->reg_info(reg)->size;
+}
+
+extern "C" reil_const_t reil_vm_get(reil_vm_t vm, int reg)
+{
+    return ((CReilVm *)vm)->reg_get(reg);
+}
+
+extern "C" void reil_vm_set(reil_vm_t vm, int reg, reil_const_t val)
+{
+    ((CReilVm *)vm)->reg_set(reg, val);
+}
+
+extern "C" void reil_vm_mem_alloc(reil_vm_t vm, reil_addr_t addr, int size, unsigned char *data)
+{
+    ((CReilVm *)vm)->mem_alloc(addr, size, data);
+}
+
+extern "C" int reil_vm_mem_read(reil_vm_t vm, reil_addr_t addr, int size, unsigned char *buff)
+{
+    return ((CReilVm *)vm)->mem_read(addr, size, buff) ? 0 : REIL_ERROR;
+}
+
+extern "C" int reil_vm_mem_write(reil_vm_t vm, reil_addr_t addr, int size, unsigned char *buff)
+{
+    return ((CReilVm *)vm)->mem_write(addr, size, buff) ? 0 : REIL_ERROR;
+}
+
+extern "C" void reil_vm_mem_clear(reil_vm_t vm)
+{
+    ((CReilVm *)vm)->mem_clear();
+}
+
+extern "C" reil_vm_snapshot_t reil_vm_snapshot(reil_vm_t vm)
+{
+    return (reil_vm_snapshot_t)((CReilVm *)vm)->snapshot();
+}
+
+extern "C" void reil_vm_restore(reil_vm_t vm, reil_vm_snapshot_t snap)
+{
+    ((CReilVm *)vm)->restore((reil_vm_snap *)snap);
+}
+
+extern "C" void reil_vm_snapshot_free(reil_vm_t vm, reil_vm_snapshot_t snap)
+{
+    ((CReilVm *)vm)->snapshot_free((reil_vm_snap *)snap);
+}
@@ -1,4 +1,4 @@
-import json, base64, unittest, copy
+import os, json, base64, struct, marshal, mmap, unittest, copy
 from abc import ABCMeta, abstractmethod
 from sets import Set
 
@@ -58,6 +58,20 @@ def get_arch(arch):
         raise Error('Architecture #%d is unknown' % arch)
 
 
+def get_arch_id(arch):
+
+    # storages are keeping either architecture ID or module returned by get_arch()
+    if isinstance(arch, (int, long)): return arch
+
+    try: 
+
+        return { x86: ARCH_X86 }[ arch ]
+
+    except KeyError: 
+
+        raise Error('Architecture %s is unknown' % arch)
+
+
 class Arg(object):
 
     def __init__(self, t = None, size = None, name = None, val = None):
@@ -1286,10 +1300,65 @@ class CFGraph(Graph):
     NODE = CFGraphNode
     EDGE = CFGraphEdge
 
+    def __init__(self):
+
+        super(CFGraph, self).__init__()
+
+        # node of the first basic block, set by CFGraphBuilder
+        self.entry_node = None
+
     def eliminate_dead_code(self):
 
         pass    
 
+    def _analyze(self):
+
+        import translator
+
+        keys = sorted(self.nodes.keys())
+        index = dict([ ( keys[n], n ) for n in range(len(keys)) ])
+
+        succ = [ [ index[edge.node_to.key()] for edge in self.nodes[key].out_edges ] for key in keys ]
+
+        # dominators and loops are computed by native code
+        return keys, translator.Dominators().build(succ, index[self.entry_node.key()])
+
+    def dominators(self):
+
+        '''
+            Returns dict with immediate dominator key for each basic block key,
+            None for entry basic block.
+        '''
+
+        keys, info = self._analyze()
+        idom = info[0]
+
+        return dict([ ( keys[n], None if idom[n] == -1 else keys[idom[n]] ) for n in range(len(keys)) ])
+
+    def post_dominators(self):
+
+        '''
+            Returns dict with immediate post-dominator key for each basic block 
+            key, None if basic block is post-dominated only by function exit.
+        '''
+
+        keys, info = self._analyze()
+        ipdom = info[1]
+
+        return dict([ ( keys[n], None if ipdom[n] == -1 else keys[ipdom[n]] ) for n in range(len(keys)) ])
+
+    def loops(self):
+
+        '''
+            Returns list of natural loops as ( header, parent, depth, keys ) tuples,
+            where parent is index of enclosing loop in this list or None.
+        '''
+
+        keys, info = self._analyze()
+
+        return [ ( keys[header], None if parent == -1 else parent, depth, [ keys[n] for n in bbs ] )
+                 for header, parent, depth, bbs in info[2] ]
+
 
 class CFGraphBuilder(object):
 
@@ -1366,7 +1435,9 @@ class CFGraphBuilder(object):
 
             # query IR for basic block
             bb = self.get_bb(ir_addr)
-            cfg.add_node(bb)
+            node = cfg.add_node(bb)
+
+            if cfg.entry_node is None: cfg.entry_node = node
 
             _process_node(bb, state, context)
 
@@ -1432,6 +1503,52 @@ class TestCFGraphBuilder(unittest.TestCase):
         assert len(cfg.nodes) == 3
         assert len(cfg.edges) == 3
 
+    def test_loops(self):
+
+        #
+        #     jmp _outer
+        #     nop
+        # _outer:
+        #     xor edx, edx
+        #     jmp _inner
+        #     nop
+        # _inner:
+        #     inc edx
+        #     cmp edx, 10
+        #     jne _inner
+        #     inc ecx
+        #     cmp ecx, 10
+        #     jne _outer
+        #     ret
+        #
+        reader = ReaderRaw(self.arch, '\xEB\x01\x90\x31\xD2\xEB\x01\x90\x42\x83\xFA\x0A\x75\xFA' + \
+                                      '\x41\x83\xF9\x0A\x75\xEF\xC3')
+
+        cfg = CFGraphBuilder(CodeStorageTranslator(reader)).traverse(0)
+
+        assert cfg.entry_node.key() == ( 0, 0 )
+
+        # jne is going to its target through the separate IR basic block
+        assert cfg.dominators() == { ( 0x00, 0 ): None,       ( 0x03, 0 ): ( 0x00, 0 ),
+                                     ( 0x08, 0 ): ( 0x03, 0 ), ( 0x0c, 3 ): ( 0x08, 0 ),
+                                     ( 0x0e, 0 ): ( 0x08, 0 ), ( 0x12, 3 ): ( 0x0e, 0 ),
+                                     ( 0x14, 0 ): ( 0x0e, 0 ) }
+
+        assert cfg.post_dominators() == { ( 0x00, 0 ): ( 0x03, 0 ), ( 0x03, 0 ): ( 0x08, 0 ),
+                                          ( 0x08, 0 ): ( 0x0e, 0 ), ( 0x0c, 3 ): ( 0x08, 0 ),
+                                          ( 0x0e, 0 ): ( 0x14, 0 ), ( 0x12, 3 ): ( 0x03, 0 ),
+                                          ( 0x14, 0 ): None }
+
+        loops = cfg.loops()
+
+        # outer loop goes first
+        assert len(loops) == 2
+        assert loops[0][:3] == ( ( 0x03, 0 ), None, 1 )
+        assert loops[1][:3] == ( ( 0x08, 0 ), 0, 2 )
+
+        assert sorted(loops[0][3]) == [ ( 0x03, 0 ), ( 0x08, 0 ), ( 0x0c, 3 ), ( 0x0e, 0 ), ( 0x12, 3 ) ]
+        assert sorted(loops[1][3]) == [ ( 0x08, 0 ), ( 0x0c, 3 ) ]
+
 
 class DFGraphNode(GraphNode):    
 
@@ -1937,11 +2054,14 @@ class DFGraph(Graph):
 
 class DFGraphBuilder(object):
 
-    def __init__(self, storage):
+    def __init__(self, storage, native = True):
 
         self.arch = storage.arch
         self.storage = storage    
 
+        # use native reaching definitions analysis
+        self.native = native
+
     def _process_state(self, bb, state):
 
         updated = False
@@ -2016,13 +2136,53 @@ class DFGraphBuilder(object):
 
         return self._process_state(bb, state)
 
+    def _traverse_native(self, ir_addr):
+
+        import translator
+
+        dfg = DFGraph()
+        cfg = CFGraphBuilder(self.storage).traverse(ir_addr)
+
+        insn_list, bb_list, index = [], [], {}
+        nodes = cfg.nodes.values()
+
+        for node in nodes: index[node.key()] = len(index)
+
+        for node in nodes:
+
+            # basic block instructions and successors
+            succ = [ index[edge.node_to.key()] for edge in node.out_edges ]
+            bb_list.append(( len(insn_list), len(node.item), succ ))
+
+            insn_list += node.item
+
+        # compute def-use edges for IR code of all basic blocks
+        edges = translator.DataFlow(get_arch_id(self.arch)).build(insn_list, bb_list, index[ir_addr])
+
+        for insn in insn_list: dfg.add_node(insn)
+
+        for def_insn, use_insn, name in edges:
+
+            node_from = dfg.entry_node if def_insn == -1 else dfg.node(insn_list[def_insn].ir_addr())
+            node_to = dfg.exit_node if use_insn == -1 else dfg.node(insn_list[use_insn].ir_addr())
+
+            dfg.add_edge(node_from, node_to, name)
+
+        return dfg
+
     def traverse(self, ir_addr, state = None):                
 
         stack = []
-        state = {} if state is None else state
         
         ir_addr = ir_addr if isinstance(ir_addr, tuple) else (ir_addr, 0)                
 
+        if state is None and self.native:
+
+            # the same DFG without iterating python sets until fixpoint
+            return self._traverse_native(ir_addr)
+
+        state = {} if state is None else state
+
         dfg = DFGraph()
         cfg = CFGraphBuilder(self.storage).traverse(ir_addr)
 
@@ -2081,6 +2241,23 @@ class TestDFGraphBuilder(unittest.TestCase):
         edges = Set(map(lambda e: str(e), dfg.exit_node.in_edges))
         assert edges.issuperset(Set([ 'R_ESP', 'R_EDI', 'R_ESI', 'R_ECX' ]))        
 
+    def test_native(self):
+
+        # add test data to the storage
+        self.storage.clear()
+        self.storage.put_insn(self.tr.to_reil(self.asm.compile('rep movsb'), addr = 0L))
+        self.storage.put_insn(self.tr.to_reil(self.asm.compile('add ecx, edx'), addr = 2L))
+        self.storage.put_insn(self.tr.to_reil(self.asm.compile('ret'), addr = 4L))
+
+        _edges = lambda dfg: Set(map(lambda e: ( e.node_from.key(), e.node_to.key(), e.name ), dfg.edges))
+
+        # native and python analysis must give the same DFG
+        dfg = DFGraphBuilder(self.storage).traverse(0)
+        dfg_py = DFGraphBuilder(self.storage, native = False).traverse(0)
+
+        assert Set(dfg.nodes.keys()) == Set(dfg_py.nodes.keys())
+        assert _edges(dfg) == _edges(dfg_py)
+
     def test_optimizations(self):
 
         # add test data to the storage
@@ -2193,6 +2370,9 @@ class CodeStorage(object):
 
     reader = None
 
+    # modification counter, None if storage doesn't track it
+    version = None
+
     @abstractmethod
     def get_insn(self, ir_addr): pass
 
@@ -2210,7 +2390,7 @@ class CodeStorageMem(CodeStorage):
 
     def __init__(self, arch, insn_list = None, from_file = None): 
 
-        self.arch = arch
+        self.arch, self.version = arch, 0
         self.clear()
         
         if insn_list is not None: self.put_insn(insn_list)
@@ -2238,15 +2418,19 @@ class CodeStorageMem(CodeStorage):
 
     def _del_insn(self, ir_addr):
 
+        self.version += 1
+
         try: return self.items.pop(ir_addr)
         except KeyError: raise StorageError(*ir_addr)
 
     def _put_insn(self, insn):
 
+        self.version += 1
         self.items[self._get_key(insn)] = insn        
     
     def clear(self): 
 
+        self.version += 1
         self.items = {}
 
     def size(self): 
@@ -2422,6 +2606,370 @@ class TestCodeStorageMem(unittest.TestCase):
 
         assert self.storage.size() == 0
 
+    def test_array(self):
+
+        addr = 0x1000
+        data = self.asm.compile(( 'push ebp', 'mov ebp, esp', 'ret' ))
+
+        # translate all instructions at once
+        arr = self.tr.to_reil_array(data, addr = addr)
+
+        assert arr.asm_count() == 3
+        assert arr.asm_info(1)[:2] == ( addr + 1, 2 )
+
+        insn_list = []
+
+        for n in range(arr.asm_count()):
+
+            # translate the same instructions one by one
+            insn_addr, size, first, count = arr.asm_info(n)
+            insn_list += self.tr.to_reil(data[insn_addr - addr :], addr = insn_addr)
+
+        assert len(arr) == len(insn_list) and list(arr) == insn_list
+        assert self.tr.to_reil_range(data, addr = addr) == insn_list
+
+        self.storage.put_insn(list(arr))
+        assert len(self.storage.get_insn(addr + 1)) == arr.asm_info(1)[3]
+
+    def test_range_threads(self):
+
+        import threading, translator
+
+        addr = 0x1000
+        data = self.asm.compile(( 'push ebp', 'mov ebp, esp', 'xor eax, eax', 
+                                  'add eax, ecx', 'pop ebp' ) * 0x100 + ( 'ret', ))
+
+        # reference output of the single thread
+        insn_list = self.tr.to_reil_range(data, addr = addr)
+        results = [ None ] * 4
+
+        def translate(n):
+
+            # each thread must use its own translator instance
+            tr = translator.Translator(self.arch)
+
+            results[n] = [ tr.to_reil_range(data, addr = addr) for i in range(4) ]
+
+        threads = [ threading.Thread(target = translate, args = ( n, )) for n in range(len(results)) ]
+
+        # translate the same code in several threads at once
+        for thread in threads: thread.start()
+        for thread in threads: thread.join()
+
+        for ret in results:
+
+            assert ret is not None
+            assert all([ item == insn_list for item in ret ])
+
+
+class CodeStorageBin(CodeStorageMem):
+
+    '''
+        Read-only storage for binary file created by CodeStorageBin.save().
+        File is mapped into the memory and instructions are unpacked only 
+        on access, so, loading doesn't depend on the file size.
+
+        File layout (little endian):
+
+          header
+          register names table: '\\0' separated names of A_REG/A_TEMP args
+          index: (addr, inum, record) entries sorted by (addr, inum)
+          records: fixed width instruction records
+          heap: length prefixed asm strings, instruction bytes and other attributes
+    '''
+
+    MAGIC = 'REILBIN\0'
+    VERSION = 1
+
+    # magic, version, arch, records count, names offset, names size, 
+    # index offset, records offset, heap offset, heap size
+    HEADER = struct.Struct('<8sIIIQQQQQQ')
+
+    # addr, inum, record number
+    INDEX = struct.Struct('<QHxxI')
+
+    # addr, inum, size, op, flags, 3 x (arg type, arg size, arg value or name), 
+    # heap offsets of asm, bin and other attributes (zero if not present)
+    RECORD = struct.Struct('<QHHBxI' + 'BBQ' * 3 + 'III')
+
+    HEAP_ITEM = struct.Struct('<I')
+
+    def __init__(self, path):
+
+        self.path, self.version = path, 0
+
+        with open(path, 'rb') as fd:
+
+            self.data = mmap.mmap(fd.fileno(), 0, access = mmap.ACCESS_READ)
+
+        if len(self.data) < self.HEADER.size:
+
+            raise Error('Invalid binary storage file')
+
+        magic, version, self.arch, self.count, names_off, names_size, \
+        self.index_off, self.records_off, self.heap_off, self.heap_size = \
+            self.HEADER.unpack_from(self.data, 0)
+
+        if magic != self.MAGIC or version != self.VERSION:
+
+            raise Error('Invalid binary storage file')
+
+        # register names are the only thing that is loaded at once
+        self.names = self.data[names_off : names_off + names_size].split('\0')
+
+        # position of the last found index entry
+        self.last = None
+
+    def __iter__(self):
+
+        for n in range(self.count): 
+
+            yield Insn(self._get_record(self._get_index(n)[2]))
+
+    def _get_index(self, n):
+
+        return self.INDEX.unpack_from(self.data, self.index_off + n * self.INDEX.size)
+
+    def _find(self, ir_addr):
+
+        n = None if self.last is None else self.last + 1
+
+        # sequential access is the most common case
+        if n is None or n >= self.count or self._get_index(n)[:2] != ir_addr:
+
+            lo, hi = 0, self.count
+
+            # binary search in the sorted index
+            while lo < hi:
+
+                n = (lo + hi) / 2
+                if self._get_index(n)[:2] < ir_addr: lo = n + 1
+                else: hi = n
+
+            n = lo
+            if n >= self.count or self._get_index(n)[:2] != ir_addr:
+
+                return None
+
+        self.last = n
+        return self._get_index(n)[2]
+
+    def _get_heap(self, offset):
+
+        offset += self.heap_off
+        size, = self.HEAP_ITEM.unpack_from(self.data, offset)
+        offset += self.HEAP_ITEM.size
+
+        return self.data[offset : offset + size]
+
+    def _get_arg(self, t, size, val):
+
+        if t == A_NONE: return ()
+        elif t == A_CONST: return t, size, val
+        else: return t, size, self.names[val]
+
+    def _get_record(self, n):
+
+        rec = self.RECORD.unpack_from(self.data, self.records_off + n * self.RECORD.size)
+
+        addr, inum, size, op, flags = rec[0 : 5]
+        asm, data, other = rec[14 : 17]
+
+        attr = {}
+
+        if flags != 0: attr[IATTR_FLAGS] = flags
+        if asm != 0: attr[IATTR_ASM] = tuple(self._get_heap(asm).split('\0'))
+        if data != 0: attr[IATTR_BIN] = self._get_heap(data)
+        if other != 0: attr.update(marshal.loads(self._get_heap(other)))
+
+        args = ( self._get_arg(*rec[5 : 8]), 
+                 self._get_arg(*rec[8 : 11]), 
+                 self._get_arg(*rec[11 : 14]) )
+
+        return ( addr, size ), inum, op, args, attr
+
+    def _get_insn(self, ir_addr):
+
+        n = self._find(ir_addr)
+        if n is None: raise StorageError(*ir_addr)
+
+        return self._get_record(n)
+
+    def _del_insn(self, ir_addr):
+
+        raise Error('Binary storage is read only')
+
+    def _put_insn(self, insn):
+
+        raise Error('Binary storage is read only')
+
+    def clear(self):
+
+        raise Error('Binary storage is read only')
+
+    def size(self): 
+
+        return self.count
+
+    def close(self):
+
+        self.data.close()
+
+    @classmethod
+    def save(cls, path, arch, insn_list):
+
+        '''
+            Write instructions from CodeStorageMem or any other iterable 
+            of Insn objects or raw instruction tuples into the binary file.
+        '''
+
+        names, names_list = {}, []
+        heap, heap_list, heap_size = {}, [ '\0' ], [ 1 ]
+        records, index, packed = {}, [], []
+
+        def _name(name):
+
+            # intern register name
+            if not names.has_key(name):
+
+                names[name] = len(names_list)
+                names_list.append(name)
+
+            return names[name]
+
+        def _heap(data):
+
+            if data is None: return 0
+
+            # equal items are stored only once
+            if not heap.has_key(data):
+
+                heap[data] = heap_size[0]
+                heap_list.append(cls.HEAP_ITEM.pack(len(data)) + data)
+                heap_size[0] += len(heap_list[-1])
+
+            return heap[data]
+
+        for insn in insn_list:
+
+            insn = insn.serialize() if isinstance(insn, Insn) else insn
+            records[Insn_ir_addr(insn)] = insn
+
+        keys = records.keys()
+        keys.sort()
+
+        for n in range(len(keys)):
+
+            insn = records[keys[n]]
+            attr = Insn_attr(insn).copy()
+            args = []
+
+            for arg in Insn_args(insn):
+
+                if len(arg) == 0: 
+
+                    args += [ A_NONE, 0, 0 ]
+
+                elif Arg_type(arg) == A_CONST: 
+
+                    args += [ A_CONST, Arg_size(arg), Arg_val(arg) & 0xffffffffffffffff ]
+
+                else:
+
+                    args += [ Arg_type(arg), Arg_size(arg), _name(Arg_name(arg)) ]
+
+            flags = attr.pop(IATTR_FLAGS, 0)
+            asm = attr.pop(IATTR_ASM, None)
+            data = attr.pop(IATTR_BIN, None)
+
+            offsets = [ _heap(None if asm is None else '\0'.join(asm)), 
+                        _heap(None if data is None else str(data)), 
+                        _heap(marshal.dumps(attr) if len(attr) > 0 else None) ]
+
+            index.append(cls.INDEX.pack(Insn_addr(insn), Insn_inum(insn), n))
+            packed.append(cls.RECORD.pack(Insn_addr(insn), Insn_inum(insn), Insn_size(insn), 
+                                          Insn_op(insn), flags, *(args + offsets)))
+
+        names_data = '\0'.join(names_list)
+        heap_data = ''.join(heap_list)
+
+        names_off = cls.HEADER.size
+        index_off = names_off + len(names_data)
+        records_off = index_off + cls.INDEX.size * len(index)
+        heap_off = records_off + cls.RECORD.size * len(packed)
+
+        with open(path, 'wb') as fd:
+
+            fd.write(cls.HEADER.pack(cls.MAGIC, cls.VERSION, arch, len(keys), 
+                                     names_off, len(names_data), index_off, records_off, 
+                                     heap_off, len(heap_data)))
+            
+            fd.write(names_data)
+            fd.write(''.join(index))
+            fd.write(''.join(packed))
+            fd.write(heap_data)
+
+        return len(keys)
+
+
+class TestCodeStorageBin(unittest.TestCase):
+
+    arch = ARCH_X86
+
+    def setUp(self):
+
+        import translator
+        self.tr = translator.Translator(self.arch)
+
+        from pyopenreil.utils import asm
+        self.asm = asm.Compiler(self.arch)
+
+        self.path = 'test_storage.bin'
+
+    def tearDown(self):
+
+        if os.path.isfile(self.path): os.unlink(self.path)
+
+    def test(self):
+
+        addr = 0x1000
+        data = self.asm.compile(( 'push ebp', 'mov ebp, esp', 'mov eax, 1', 
+                                  'rdtsc', 'leave', 'ret' ))
+
+        storage = CodeStorageMem(self.arch, self.tr.to_reil_range(data, addr = addr))
+
+        # instruction with other than default attributes
+        insn = storage.get_insn(( addr, 0 ))
+        insn.set_attr(IATTR_NEXT, ( addr + 1, 0 ))
+        storage.put_insn(insn)
+
+        assert CodeStorageBin.save(self.path, self.arch, storage) == storage.size()
+
+        storage_bin = CodeStorageBin(self.path)
+
+        assert storage_bin.arch == self.arch
+        assert storage_bin.size() == storage.size()
+
+        for insn in storage:
+
+            insn_bin = storage_bin.get_insn(insn.ir_addr())
+
+            assert insn_bin == insn and insn_bin.size == insn.size
+            assert insn_bin.attr == insn.attr
+
+        assert list(storage_bin) == list(storage)
+        assert len(storage_bin.get_insn(addr + 1)) == len(storage.get_insn(addr + 1))
+
+        # query missing instruction
+        try: 
+
+            storage_bin.get_insn(( addr + 1, 100 ))
+            assert False
+
+        except StorageError: pass
+
+        storage_bin.close()
+
 
 class CodeStorageTranslator(CodeStorage):
 
@@ -2437,7 +2985,7 @@ class CodeStorageTranslator(CodeStorage):
 
             CFGraphBuilder.traverse(self, ir_addr)
 
-    def __init__(self, reader = None, storage = None):        
+    def __init__(self, reader = None, storage = None, flags = 0, cache_dir = None):        
 
         arch = None
 
@@ -2447,7 +2995,10 @@ class CodeStorageTranslator(CodeStorage):
         else: raise Error('Storage or reader instance must be specified')
 
         import translator
-        self.translator = translator.Translator(arch)
+        self.translator = translator.Translator(arch, flags)
+
+        # persistent translation cache
+        if cache_dir is not None: self.translator.set_disk_cache(cache_dir)
         
         self.arch = get_arch(arch)        
         self.storage = CodeStorageMem(arch) if storage is None else storage
@@ -2494,6 +3045,9 @@ class CodeStorageTranslator(CodeStorage):
 
         return [ unk_insn.serialize() ]
 
+    # storage is modified when new instructions are translated
+    version = property(lambda self: self.storage.version)
+
     def clear(self): 
 
         self.storage.clear()
@@ -2668,6 +3222,88 @@ class TestCodeStorageTranslator(unittest.TestCase):
         assert _check_args(insn.get_attr(IATTR_SRC), [ 'R_ECX', 'R_LDT' ])
         assert not insn.has_attr(IATTR_DST)
 
+    def test_disk_cache(self):
+
+        import tempfile, shutil
+        path = tempfile.mkdtemp()
+
+        reader = ReaderRaw(ARCH_X86, '\x33\xC0\xE8\x00\x00\x00\x00\xC3')
+        insn_list = CodeStorageTranslator(reader).get_func(0)
+
+        try:
+
+            for hits in [ 0, 3 ]:
+
+                # the second translator must load all instructions from the cache
+                tr = CodeStorageTranslator(reader, cache_dir = path)
+                assert tr.get_func(0) == insn_list
+
+                # entries are saved when instructions are translated again
+                tr.clear()
+                assert tr.get_func(0) == insn_list
+
+                stats = tr.translator.get_stats()
+                assert stats['disk_hits'] == hits and stats['disk_stores'] == 3 - hits
+
+        finally:
+
+            shutil.rmtree(path)
+
+    def test_func_array(self):
+
+        import translator
+
+        # test eax, eax / jz _l / inc eax / _l: ret
+        reader = ReaderRaw(ARCH_X86, '\x85\xC0\x74\x01\x40\xC3')
+        func = CodeStorageTranslator(reader).get_func(0)
+
+        # translate the same function with native CFG builder
+        arr = translator.Translator(ARCH_X86).to_reil_func(reader, 0)
+
+        assert set([ Insn(insn).ir_addr() for insn in arr ]) == \
+               set([ insn.ir_addr() for insn in func ])
+
+        assert [ arr.bb_info(n)[:2] for n in range(arr.bb_count()) ] == \
+               sorted([ bb.first.ir_addr() for bb in func.bb_list ])
+
+        assert arr.entry == 0 and arr.asm_count() == 4
+        assert arr.bb_succ(0) == [ 1, 3 ] and arr.bb_succ(2) == [ 3 ] and arr.bb_succ(3) == []
+        assert arr.bb_find(5) == 3 and arr.bb_find(3) is None
+
+        try:
+
+            # must raise TranslationError if instruction can't be read
+            translator.Translator(ARCH_X86).to_reil_func(reader, 0x100)
+            assert False
+
+        except translator.TranslationError as e: assert e.addr == 0x100
+
+    def test_func_ssa(self):
+
+        import translator
+
+        # test eax, eax / jz _l / inc eax / _l: ret
+        reader = ReaderRaw(ARCH_X86, '\x85\xC0\x74\x01\x40\xC3')
+
+        arr = translator.Translator(ARCH_X86).to_reil_func(reader, 0)
+        insts, phis = translator.SSA(ARCH_X86).build_array(arr)
+
+        assert len(insts) == len(arr)
+
+        defs = [ var for uses, dst in insts for var in dst ] + \
+               [ ( name, version ) for bb, name, version, args in phis ]
+
+        # each version must be defined only once
+        assert len(defs) == len(set(defs))
+
+        # value of EAX at ret is either the original one or the result of inc
+        assert len(phis) == 1 and phis[0][:2] == ( 3, 'R_EAX' )
+        assert phis[0][3] == [ ( 0, 0 ), ( 2, 1 ) ]
+
+        uses, dst = insts[arr.bb_info(3)[2]]
+
+        assert uses == [ ( 'R_ESP', 0 ) ]
+
     def test_get_insn(self):
 
         print '\n', self.tr.get_insn(0)
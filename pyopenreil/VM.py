@@ -1,4 +1,4 @@
-import sys, os, struct, random
+import sys, os, struct, random, copy
 import numpy
 
 from REIL import *
@@ -70,13 +70,21 @@ class Mem(object):
     # REIL type to struct format map
     map_format = { U8: 'B', U16: 'H', U32: 'I', U64: 'Q' }    
 
+    # guest memory page size
+    PAGE_BITS = 12
+    PAGE_SIZE = 1 << PAGE_BITS
+    PAGE_MASK = PAGE_SIZE - 1
+
     def __init__(self, data = None, reader = None, strict = True):
 
-        self.data = {} if data is None else None
+        self.pages = {}
         self.reader, self.strict = reader, strict
         self.alloc_base = self.DEF_ALLOC_BASE
         self.alloc_last = self.alloc_base
 
+        # pages that were modified since the last snapshot or restore of snap_base
+        self.dirty, self.snap_base = set(), None
+
     def pack(self, size, val):
 
         return struct.pack(self.map_format[size], val)
@@ -87,37 +95,125 @@ class Mem(object):
 
     def clear(self):
 
-        self.data = {}
+        self.pages = {}
+        self.dirty, self.snap_base = set(), None
+
+    def _page_data(self):
+
+        # contents of the new memory page
+        return bytearray(self.PAGE_SIZE)
+
+    def _page(self, addr, create = False, write = False):
+
+        num = addr >> self.PAGE_BITS
+        page = self.pages.get(num)
+
+        if page is None:
+
+            if not create: return None
+
+            # page data and map of allocated bytes
+            page = self.pages[num] = ( self._page_data(), bytearray(self.PAGE_SIZE) )
+            self.dirty.add(num)
+
+        elif write and not num in self.dirty:
+
+            # page is shared with snapshot, make a private copy
+            page = self.pages[num] = ( page[0][:], page[1][:] )
+            self.dirty.add(num)
+
+        return page
+
+    def _chunks(self, addr, size):
+
+        # split memory range by page boundaries
+        pos = 0
+        while pos < size:
+
+            offs = (addr + pos) & self.PAGE_MASK
+            count = min(self.PAGE_SIZE - offs, size - pos)
+
+            yield addr + pos, offs, pos, count
+
+            pos += count
+
+    def _valid(self, addr, size):
+
+        for ptr, offs, pos, count in self._chunks(addr, size):
+
+            page = self._page(ptr)
+            if page is None or page[1].find('\0', offs, offs + count) != -1:
+
+                return False
+
+        return True
 
     def _read(self, addr, size):
 
-        ret = []
+        offs = addr & self.PAGE_MASK
 
-        for i in range(size):
+        if offs + size <= self.PAGE_SIZE:
 
-            if not self.data.has_key(addr + i):
+            # memory range is within the single page
+            page = self._page(addr)
+            if page is None or page[1].find('\0', offs, offs + size) != -1:
 
                 raise MemReadError(addr)
 
-            ret.append(self.data[addr + i])
+            return page[0][offs : offs + size]
+
+        if not self._valid(addr, size):
+
+            raise MemReadError(addr)
+
+        ret = self.pages[addr >> self.PAGE_BITS][0][offs :]
+
+        for ptr, offs, pos, count in self._chunks(addr, size):
+
+            if pos > 0: ret += self.pages[ptr >> self.PAGE_BITS][0][offs : offs + count]
 
         return ret
 
     def _write(self, addr, size, data):
 
-        for i in range(size):
+        offs = addr & self.PAGE_MASK
+
+        if offs + size <= self.PAGE_SIZE and len(data) == size:
 
-            if self.strict and not self.data.has_key(addr + i):
+            # memory range is within the single page
+            page = self._page(addr, create = not self.strict, write = True)
+            if page is None or (self.strict and page[1].find('\0', offs, offs + size) != -1):
 
                 raise MemWriteError(addr)
 
-            self.data[addr + i] = data[i]
+            page[0][offs : offs + size] = data
+            if not self.strict: page[1][offs : offs + size] = '\1' * size
+
+            return
+
+        if self.strict and not self._valid(addr, size):
+
+            raise MemWriteError(addr)
+
+        self._fill(addr, size, data)
+
+    def _fill(self, addr, size, data):
+
+        for ptr, offs, pos, count in self._chunks(addr, size):
+
+            page_data, page_valid = self._page(ptr, create = True, write = True)
+            chunk = '' if data is None else data[pos : pos + count]
+
+            # copy the data and pad it with zeros
+            page_data[offs : offs + len(chunk)] = chunk
+            page_data[offs + len(chunk) : offs + count] = '\0' * (count - len(chunk))
+            page_valid[offs : offs + count] = '\1' * count
 
     def read(self, addr, size):
 
         try:
 
-            return ''.join(self._read(addr, size))
+            return str(self._read(addr, size))
 
         except MemReadError:
 
@@ -137,7 +233,7 @@ class Mem(object):
 
         try:
 
-            self._write(addr, size, list(data))
+            self._write(addr, size, data)
 
         except MemWriteError:
 
@@ -153,6 +249,31 @@ class Mem(object):
             # allocate memory at adderss that was not available
             self.alloc(addr, data = data)
 
+    def snapshot(self):
+
+        # memory pages are shared with the snapshot until modification
+        self.dirty, self.snap_base = set(), ( self.pages.copy(), self.alloc_last )
+
+        return self.snap_base
+
+    def restore(self, snap):
+
+        pages, self.alloc_last = snap
+
+        if snap is self.snap_base:
+
+            # revert only pages that were modified since the snapshot
+            for num in self.dirty:
+
+                if pages.has_key(num): self.pages[num] = pages[num]
+                else: self.pages.pop(num, None)
+
+        else:
+
+            self.pages = pages.copy()
+
+        self.dirty, self.snap_base = set(), snap
+
     def alloc_addr(self, size):
 
         ret = self.alloc_last
@@ -165,11 +286,8 @@ class Mem(object):
         size = len(data) if size is None and not data is None else size
         addr = self.alloc_addr(size) if addr is None else addr
 
-        for i in range(0, size):
-
-            # fill target memory range with specified data (or zeros)
-            byte = '\0' if data is None or i >= len(data) else data[i]
-            self.data[addr + i] = byte
+        # fill target memory range with specified data (or zeros)
+        self._fill(addr, size, data)
 
         return addr
 
@@ -223,14 +341,56 @@ class TestMem(unittest.TestCase):
         mem.store(0, U16, 0x4444)
         mem.store(0, U8, 0x88)
         
-        assert mem.data == { 0: chr(0x88), 1: chr(0x44), 2: chr(0x22), 3: chr(0x22),
-                             4: chr(0x11), 5: chr(0x11), 6: chr(0x11), 7: chr(0x11) }
+        assert mem.read(0, 8) == '\x88\x44\x22\x22\x11\x11\x11\x11'
         
         assert mem.load(0, U64) == val and \
                mem.load(0, U32) == val & 0xffffffff and \
                mem.load(0, U16) == val & 0xffff and \
                mem.load(0, U8) == val & 0xff
 
+    def test_pages(self):
+
+        mem = Mem(strict = True)
+        addr = Mem.PAGE_SIZE - 2
+
+        # allocate memory range that crosses page boundary
+        mem.alloc(addr, size = 6, data = 'ABC')
+        assert mem.read(addr, 6) == 'ABC\0\0\0'
+
+        mem.store(addr, U32, 0x44332211)
+        assert mem.load(addr, U32) == 0x44332211
+
+        # access to not allocated bytes of allocated page
+        self.assertRaises(MemReadError, mem.read, addr - 1, 2)
+        self.assertRaises(MemWriteError, mem.store, addr + 4, U32, 0)
+
+        mem.clear()
+        self.assertRaises(MemReadError, mem.read, addr, 1)
+
+    def test_snapshot(self):
+
+        mem = Mem(strict = True)
+        addr = mem.alloc(size = Mem.PAGE_SIZE * 2, data = 'A' * 4)
+        snap = mem.snapshot()
+
+        mem.store(addr, U32, 0x42424242)
+        buff = mem.alloc(size = 4, data = 'C' * 4)
+
+        snap_2 = mem.snapshot()
+        mem.store(addr + Mem.PAGE_SIZE, U32, 0x43434343)
+
+        mem.restore(snap)
+        assert mem.read(addr, 4) == 'AAAA'
+        assert mem.read(addr + Mem.PAGE_SIZE, 4) == '\0\0\0\0'
+        self.assertRaises(MemReadError, mem.read, buff, 4)
+
+        # allocated address is also restored
+        assert mem.alloc(size = 4) == buff
+
+        mem.restore(snap_2)
+        assert mem.read(addr, 4) == 'BBBB' and mem.read(buff, 4) == 'CCCC'
+        assert mem.read(addr + Mem.PAGE_SIZE, 4) == '\0\0\0\0'
+
 
 class Math(object):
 
@@ -343,6 +503,19 @@ class Reg(object):
         return hex(self.get_val() if val is None else val)
 
 
+class CpuBlock(object):
+
+    def __init__(self, addr, gen):
+
+        self.addr, self.gen = addr, gen
+
+        # decoded IR code of machine instructions: ( addr, [ ( insn, handler, a, b, c ), ... ] )
+        self.insns = []
+
+        # fall-through address and already known successors by address
+        self.next, self.succ = None, {}
+
+
 class Cpu(object):
 
     DEF_REG = Reg
@@ -350,11 +523,24 @@ class Cpu(object):
 
     DEF_R_DFLAG = 1L
 
+    # max. number of machine instructions in decoded basic block
+    MAX_BB_INSNS = 0x100
+
     def __init__(self, arch, mem = None, math = None):
 
         self.mem = Mem() if mem is None else mem
         self.math = Math() if math is None else math
         self.arch = get_arch(arch)
+
+        self.handlers = { I_NONE: self.insn_none,
+                           I_JCC: self.insn_jcc,
+                           I_STM: self.insn_stm,
+                           I_LDM: self.insn_ldm }
+
+        # subclass that overrides execute() gets it called for each instruction
+        self.execute_hook = type(self).execute.im_func is not Cpu.execute.im_func
+
+        self.bb_clear()
         self.reset()
 
     def set_storage(self, storage = None):
@@ -381,6 +567,20 @@ class Cpu(object):
 
             self.mem = mem
 
+    def snapshot(self):
+
+        # registers are copied, memory pages are shared with the snapshot
+        regs = dict([ (name, copy.copy(reg)) for name, reg in self.regs.items() ])
+
+        return regs, self.mem.snapshot()
+
+    def restore(self, snap):
+
+        regs, mem = snap
+
+        self.regs = dict([ (name, copy.copy(reg)) for name, reg in regs.items() ])
+        self.mem.restore(mem)
+
     def reset_temp(self):
 
         for name, reg in self.regs.items():
@@ -465,31 +665,35 @@ class Cpu(object):
         self.reg(insn.c, self.math.eval(insn.op, a, b))
         return None
 
-    def execute(self, insn):        
+    def arg_handle(self, arg):
+
+        # constants are evaluated once, registers are looked up on each execution
+        return arg if arg.type in [ A_REG, A_TEMP ] else self.arg(arg)
+
+    def decode(self, insn):
+
+        # opcode-specific handler, None for invalid opcode
+        handler = self.handlers.get(insn.op, self.insn_other) if insn.op in REIL_INSN else None
+
+        return insn, handler, self.arg_handle(insn.a), self.arg_handle(insn.b), self.arg_handle(insn.c)
+
+    def execute_decoded(self, insn, handler, a, b, c):
 
         # get arguments values
-        a, b, c = self.arg(insn.a), self.arg(insn.b), self.arg(insn.c)
-        
-        if not insn.op in REIL_INSN:
+        if a.__class__ is Arg: a = self.reg(a)
+        if b.__class__ is Arg: b = self.reg(b)
+        if c.__class__ is Arg: c = self.reg(c)
+
+        if handler is None:
 
             # invalid opcode
             raise CpuInstructionError(insn.addr, insn.inum)
 
-        try:
-            
-            return {
-
-                I_NONE: self.insn_none,
-                 I_JCC: self.insn_jcc,
-                 I_STM: self.insn_stm,
-                 I_LDM: self.insn_ldm
+        return handler(insn, a, b, c)
 
-            # call opcode-specific handler
-            }[insn.op](insn, a, b, c)
-
-        except KeyError:
+    def execute(self, insn):        
 
-            return self.insn_other(insn, a, b, c)
+        return self.execute_decoded(*self.decode(insn))
 
     def get_ip(self):
 
@@ -499,28 +703,76 @@ class Cpu(object):
 
         self.reg(self.arch.Registers.ip, val)
 
-    def run(self, storage, addr = 0L, stop_at = None):
+    def bb_clear(self):
+
+        # decoded basic blocks by address
+        self.bb_cache, self.bb_gen = {}, getattr(self, 'bb_gen', 0) + 1
+        self.bb_storage = self.bb_version = None
 
+    def bb_decode(self, storage, addr):
+
+        bb = CpuBlock(addr, self.bb_gen)
         next = addr
 
-        # use specified storage instance
-        self.set_storage(storage)                
+        while next is not None and len(bb.insns) < self.MAX_BB_INSNS:
 
-        while True:
-            
             try:
 
-                # query list of IR instructions from storage                
+                # query list of IR instructions from storage
                 insn_list = storage.get_insn(next)
 
             except StorageError:
 
-                raise CpuReadError(next)
+                # code after the first instruction is decoded on demand
+                if len(bb.insns) == 0: raise CpuReadError(next)
+                break
 
-            for insn in insn_list:
+            bb.insns.append(( next, map(self.decode, insn_list) ))
+
+            last = insn_list[-1]
+            bb.next = next = None if last.next() is None else last.next()[0]
+
+            # stop on the end of basic block
+            if last.has_flag(IOPT_BB_END): break
+
+        return bb
+
+    def bb_get(self, storage, addr):
+
+        version = getattr(storage, 'version', None)
+        if version is None:
+
+            # storage doesn't track modifications, caching is not possible
+            return self.bb_decode(storage, addr)
+
+        if storage is not self.bb_storage or version != self.bb_version:
+
+            # storage was changed, decoded code is not valid anymore
+            self.bb_clear()
+            self.bb_storage = storage
+
+        try: 
+
+            return self.bb_cache[addr]
+
+        except KeyError:
+
+            bb = self.bb_cache[addr] = self.bb_decode(storage, addr)
+
+            # decoding only adds new code to the storage
+            self.bb_version = storage.version
+
+            return bb
+
+    def bb_execute(self, bb, stop_at = None):
+
+        for addr, insn_list in bb.insns:
+
+            self.set_ip(addr)
+
+            for insn, handler, a, b, c in insn_list:
 
                 self.insn = insn
-                self.set_ip(insn.addr)
 
                 if stop_at is not None and \
                    (insn.addr in stop_at or insn.ir_addr() in stop_at):
@@ -528,15 +780,49 @@ class Cpu(object):
                     raise CpuStop(insn.addr, insn.inum)
 
                 # execute single instruction
-                next = self.execute(insn)
+                if self.execute_hook: next = self.execute(insn)
+                else: next = self.execute_decoded(insn, handler, a, b, c)
 
                 # check if JCC was taken
-                if next is not None: break
-                else: next, _ = insn.next()
+                if next is not None: 
+
+                    self.reset_temp()
+                    return next
 
             # remove temp registers
             self.reset_temp()
 
+        return bb.next
+
+    def run(self, storage, addr = 0L, stop_at = None):
+
+        next, bb = addr, None
+
+        # use specified storage instance
+        self.set_storage(storage)                
+
+        while True:
+
+            if next is None:
+
+                # end of the code
+                raise CpuReadError(bb.insns[-1][0])
+
+            if bb is not None and bb.gen == self.bb_gen and \
+               self.bb_version is not None and getattr(storage, 'version', None) == self.bb_version:
+
+                # use already known successor
+                succ = bb.succ.get(next)
+                if succ is None: succ = bb.succ[next] = self.bb_get(storage, next)
+
+            else:
+
+                succ = self.bb_get(storage, next)
+
+            # execute basic block and get address of the next one
+            bb = succ
+            next = self.bb_execute(bb, stop_at = stop_at)
+
         self.set_storage()
 
     def dump(self, show_flags = True, show_temp = False, show_all = False):
@@ -580,6 +866,10 @@ class TestCpu(unittest.TestCase):
 
     arch = ARCH_X86
 
+    def get_cpu(self):
+
+        return Cpu(self.arch)
+
     def test(self):     
 
         code = ( 'mov eax, edx',
@@ -592,7 +882,7 @@ class TestCpu(unittest.TestCase):
         from pyopenreil.utils import asm
         tr = CodeStorageTranslator(asm.Reader(self.arch, code, addr = addr))
         
-        cpu = Cpu(self.arch)
+        cpu = self.get_cpu()
 
         # set up stack pointer and input args
         cpu.reg('esp', stack)
@@ -623,7 +913,7 @@ class TestCpu(unittest.TestCase):
         from pyopenreil.utils import asm
         tr = CodeStorageTranslator(asm.Reader(self.arch, code, addr = addr))
 
-        cpu = Cpu(ARCH_X86)
+        cpu = self.get_cpu()
 
         # set up stack pointer
         cpu.reg('esp', stack)
@@ -638,6 +928,325 @@ class TestCpu(unittest.TestCase):
         # check for correct return value
         assert cpu.reg('eax').val == 0x90909090
 
+    def test_snapshot(self):
+
+        addr, stack, buff = 0x41414141, 0x42424242, 0x43434340
+
+        code = ( 'add dword [%Xh], ecx' % buff,
+                 'inc ecx',
+                 'ret' )
+
+        # create reader and translator
+        from pyopenreil.utils import asm
+        tr = CodeStorageTranslator(asm.Reader(self.arch, code, addr = addr))
+
+        cpu = self.get_cpu()
+
+        # set up stack pointer, input args and memory
+        cpu.reg('esp', stack)
+        cpu.reg('ecx', 1)
+        cpu.mem.alloc(buff, data = '\x01\x00\x00\x00')
+
+        snap = cpu.snapshot()
+
+        for i in range(3):
+
+            # run untill ret
+            try: cpu.run(tr, addr)
+            except MemReadError as e:
+
+                # exception on accessing to the stack
+                if e.addr != stack: raise
+
+            assert cpu.reg('ecx').val == 2 and cpu.mem.load(buff, U32) == 2
+
+            # revert registers and memory to the initial state
+            cpu.restore(snap)
+
+            assert cpu.reg('ecx').val == 1 and cpu.mem.load(buff, U32) == 1
+
+    def test_code_change(self):
+
+        addr, stack = 0x41414141, 0x42424242
+
+        from pyopenreil.utils import asm
+        tr = CodeStorageTranslator(asm.Reader(self.arch, ( 'mov eax, 1', 'ret' ), addr = addr))
+
+        cpu = self.get_cpu()
+
+        for val in [ 1, 2 ]:
+
+            cpu.reg('esp', stack)
+
+            # run untill ret
+            try: cpu.run(tr, addr)
+            except MemReadError as e:
+
+                # exception on accessing to the stack
+                if e.addr != stack: raise
+
+            assert cpu.reg('eax').val == val
+
+            # replace the code, decoded instructions must be discarded
+            tr.clear()
+            tr.reader = asm.Reader(self.arch, ( 'mov eax, 2', 'ret' ), addr = addr)
+
+    def test_execute(self):
+
+        addr, stack = 0x41414141, 0x42424242
+
+        class TraceCpu(Cpu):
+
+            def execute(self, insn):
+
+                # log each executed IR instruction
+                self.trace.append(insn.ir_addr())
+
+                return super(TraceCpu, self).execute(insn)
+
+        from pyopenreil.utils import asm
+        tr = CodeStorageTranslator(asm.Reader(self.arch, ( 'mov eax, 1', 'ret' ), addr = addr))
+
+        cpu = TraceCpu(self.arch)
+        cpu.trace = []
+
+        cpu.reg('esp', stack)
+
+        # run untill ret
+        try: cpu.run(tr, addr)
+        except MemReadError as e:
+
+            # exception on accessing to the stack
+            if e.addr != stack: raise
+
+        # overridden execute() must be called for each instruction
+        assert cpu.trace[0] == ( addr, 0 ) and cpu.reg('eax').val == 1
+
+
+class NativeMem(Mem):
+
+    def __init__(self, arch, reader = None, strict = True, jit = False):
+
+        import translator
+        self.vm = translator.Vm(arch, strict = strict, jit = jit)
+
+        super(NativeMem, self).__init__(reader = reader, strict = strict)
+
+    # memory reader is called by native interpreter
+    reader = property(lambda self: self.vm.reader, 
+                      lambda self, reader: setattr(self.vm, 'reader', reader))
+
+    def clear(self):
+
+        self.vm.mem_clear()
+
+    def _read(self, addr, size):
+
+        data = self.vm.mem_read(addr, size)
+        if data is None:
+
+            raise MemReadError(addr)
+
+        return data
+
+    def _write(self, addr, size, data):
+
+        data = ''.join(data)
+
+        if not self.vm.mem_write(addr, data):
+
+            if self.strict: raise MemWriteError(addr)
+
+            self.vm.mem_alloc(addr, size, data)
+
+    def alloc(self, addr = None, size = None, data = None):
+
+        size = len(data) if size is None and not data is None else size
+        addr = self.alloc_addr(size) if addr is None else addr
+
+        # fill target memory range with specified data (or zeros)
+        self.vm.mem_alloc(addr, size, data)
+
+        return addr
+
+    def snapshot(self):
+
+        # native snapshot also keeps values of VM registers
+        return self.vm.snapshot(), self.alloc_last
+
+    def restore(self, snap):
+
+        snap, self.alloc_last = snap
+
+        self.vm.restore(snap)
+
+
+class NativeReg(Reg):
+
+    def __init__(self, vm, index, size, name, temp = False):
+
+        self.vm, self.index = vm, index
+        self.size, self.name, self.temp = size, name, temp
+
+    # register value is stored by native interpreter
+    val = property(lambda self: self.vm.reg_get(self.index), 
+                   lambda self, val: self.vm.reg_set(self.index, long(val)))
+
+
+class NativeCpu(Cpu):
+    
+    def __init__(self, arch, mem = None, math = None, jit = False):
+
+        # JIT compiler is used when code is executed by the native interpreter
+        mem = NativeMem(arch, jit = jit) if mem is None else mem
+
+        # breakpoints that was set by the last run
+        self.brk_list = None
+
+        super(NativeCpu, self).__init__(arch, mem = mem, math = math)
+
+    def reset(self, regs = None, mem = None):
+
+        if mem is not None:
+
+            # registers are stored together with memory
+            self.mem = mem
+
+            # code and breakpoints of the old interpreter instance are not valid
+            self.bb_clear()
+            self.brk_list = None
+
+        assert isinstance(self.mem, NativeMem)
+
+        self.vm = self.mem.vm
+        self.regs = {}
+
+        # native registers can't be removed, set them to the default value
+        for index in range(self.vm.reg_count()): 
+
+            self.vm.reg_set(index, self.DEF_REG_VAL)
+
+        super(NativeCpu, self).reset(regs = regs)
+
+    def reset_temp(self):
+
+        pass
+
+    def reg(self, name, val = None, size = None):
+
+        if isinstance(name, Arg):
+
+            assert not name.type in [ A_NONE, A_CONST ]
+
+            # find register by instruction argument
+            name, size, temp = name.name, name.size, name.type == A_TEMP          
+
+        else:
+
+            # find register by name
+            size = self.arch.size if size is None else size
+            temp = False
+
+        if not name[:2] in [ 'R_', 'V_' ]:
+
+            # make canonical register name
+            name = '%s_%s' % ( 'V' if temp else 'R', name.upper() )
+
+        if not self.regs.has_key(name):
+
+            # temp registers of native interpreter have size suffix
+            key = '%s:%s' % (name, REIL_NAMES_SIZE[size]) if temp else name
+            index = self.vm.reg(key, size)
+
+            self.regs[name] = NativeReg(self.vm, index, self.vm.reg_size(index), name, temp = temp)
+
+        reg = self.regs[name]
+
+        if val is not None: reg.val = val
+
+        return reg
+
+    def run(self, storage, addr = 0L, stop_at = None):
+
+        import translator
+
+        # use specified storage instance
+        self.set_storage(storage)
+
+        version = getattr(storage, 'version', None)
+        if storage is not self.bb_storage or version is None or version != self.bb_version:
+
+            # storage contents was changed since the last run
+            self.vm.code_clear()
+            self.bb_storage, self.bb_version = storage, version
+
+        brk_list = [] if stop_at is None else list(stop_at)
+        if brk_list != self.brk_list:
+
+            self.vm.brk_clear()
+            self.brk_list = brk_list
+
+            for item in brk_list:
+
+                # IR address or address of the machine instruction
+                if isinstance(item, tuple): self.vm.brk(*item)
+                else: self.vm.brk(item, 0)
+
+        next = addr
+
+        while True:
+
+            reason, addr, inum, mem_addr = self.vm.run(next)
+
+            if reason == translator.VM_NO_CODE:
+
+                try:
+
+                    # query list of IR instructions from storage
+                    self.vm.code(storage.get_insn(addr))
+
+                except StorageError:
+
+                    raise CpuReadError(addr)
+
+                # decoding only adds new code to the storage
+                self.bb_version = version = getattr(storage, 'version', None)
+
+                next = addr
+
+            elif reason == translator.VM_STOP: raise CpuStop(addr, inum)
+            elif reason == translator.VM_MEM_READ: raise MemReadError(mem_addr)
+            elif reason == translator.VM_MEM_WRITE: raise MemWriteError(mem_addr)
+            else: raise CpuInstructionError(addr, inum)
+
+        self.set_storage()
+
+    def dump(self, show_flags = True, show_temp = False, show_all = False):
+
+        for index in range(self.vm.reg_count()):
+
+            name = self.vm.reg_name(index)
+
+            # get all of the registers that was used by native code
+            if not ':' in name: self.reg(name, size = self.vm.reg_size(index))
+
+        super(NativeCpu, self).dump(show_flags = show_flags, show_temp = show_temp, 
+                                    show_all = show_all)
+
+
+class TestNativeCpu(TestCpu):
+
+    def get_cpu(self):
+
+        return NativeCpu(self.arch)
+
+
+class TestNativeCpuJit(TestCpu):
+
+    def get_cpu(self):
+
+        return NativeCpu(self.arch, jit = True)
+
 
 class Stack(object):
 
@@ -43,12 +43,17 @@ cdef extern from "libopenreil.h":
 
     cdef enum _reil_size_t: U1, U8, U16, U32, U64
 
+    ctypedef unsigned short reil_reg_t
+
     cdef struct _reil_arg_t:
     
         _reil_type_t type
         _reil_size_t size
         reil_const_t val
         char name[REIL_MAX_NAME_LEN]
+        reil_reg_t reg        # register ID (A_REG only)
+        reil_reg_t parent     # full-width register that holds it
+        unsigned char offset  # .. and bit offset inside of the parent
 
     cdef struct _reil_raw_t:
 
@@ -74,6 +79,217 @@ cdef extern from "libopenreil.h":
     ctypedef _reil_inst_t reil_inst_t
     ctypedef _reil_arch_t reil_arch_t
 
+    cdef struct _reil_stats_t:
+
+        unsigned long long cache_hits
+        unsigned long long cache_misses
+        int cache_entries
+        int cache_uncacheable
+        unsigned long long arena_last
+        unsigned long long arena_peak
+        unsigned long long arena_size
+        unsigned long long opt_removed
+        unsigned long long eflags_removed
+        unsigned long long disk_hits
+        unsigned long long disk_stores
+
+    ctypedef _reil_stats_t reil_stats_t
+
+    cdef struct _reil_batch_insn_t:
+
+        reil_addr_t addr
+        int size
+        int first
+        int count
+
+    ctypedef _reil_batch_insn_t reil_batch_insn_t
+
+    cdef struct _reil_batch_t:
+
+        reil_inst_t *insts
+        int insts_max
+        reil_batch_insn_t *index
+        int index_max
+        int insts_count
+        int index_count
+        int translated
+
+    ctypedef _reil_batch_t reil_batch_t
+
+    ctypedef int (* reil_reader_t)(reil_addr_t addr, unsigned char *buff, int size, void *context)
+
+    cdef struct _reil_func_bb_t:
+
+        reil_addr_t addr
+        reil_inum_t inum
+        int first
+        int count
+        int succ
+        int succ_count
+
+    ctypedef _reil_func_bb_t reil_func_bb_t
+
+    cdef struct _reil_func_t:
+
+        reil_inst_t *insts
+        int insts_count
+        reil_func_bb_t *bbs
+        int bbs_count
+        int entry
+        int *succ
+        int succ_count
+        reil_addr_t error_addr
+
+    ctypedef _reil_func_t reil_func_t
+
     int reil_translate_insn(reil_t reil, reil_addr_t addr, unsigned char *buff, int len)
+    int reil_translate_batch(reil_t reil, reil_addr_t addr, unsigned char *buff, int len, reil_batch_t *batch) nogil
+    int reil_translate_func(reil_t reil, reil_addr_t addr, reil_reader_t reader, void *context, reil_func_t *func)
     reil_t reil_init(reil_arch_t arch, reil_inst_handler_t handler, void *context)
+    reil_t reil_init_ex(reil_arch_t arch, reil_inst_handler_t handler, void *context, int flags)
+    void reil_get_stats(reil_t reil, reil_stats_t *stats)
+    int reil_set_disk_cache(reil_t reil, const char *path, unsigned long long max_size)
     void reil_close(reil_t reil)    
+
+    ctypedef void* reil_dfg_t
+
+    cdef enum: REIL_DFG_ENTRY, REIL_DFG_EXIT
+
+    cdef struct _reil_dfg_edge_t:
+
+        int def_inst
+        int use_inst
+        int var
+
+    ctypedef _reil_dfg_edge_t reil_dfg_edge_t
+
+    reil_dfg_t reil_dfg_init(reil_arch_t arch)
+    void reil_dfg_close(reil_dfg_t dfg)
+    int reil_dfg_build(reil_dfg_t dfg, reil_func_t *func, reil_dfg_edge_t **edges)
+    int reil_dfg_var_count(reil_dfg_t dfg)
+    const char *reil_dfg_var_name(reil_dfg_t dfg, int var)
+
+    ctypedef void* reil_ssa_t
+
+    cdef enum: REIL_SSA_ENTRY, REIL_SSA_NONE
+
+    cdef enum: REIL_SSA_ARG_A, REIL_SSA_ARG_B, REIL_SSA_ARG_C, REIL_SSA_ARG_CALL
+
+    cdef struct _reil_ssa_ref_t:
+
+        int var
+        int version
+        int arg
+
+    ctypedef _reil_ssa_ref_t reil_ssa_ref_t
+
+    cdef struct _reil_ssa_inst_t:
+
+        int uses
+        int uses_count
+        int defs
+        int defs_count
+
+    ctypedef _reil_ssa_inst_t reil_ssa_inst_t
+
+    cdef struct _reil_ssa_phi_t:
+
+        int bb
+        int var
+        int version
+        int args
+        int args_count
+
+    ctypedef _reil_ssa_phi_t reil_ssa_phi_t
+
+    cdef struct _reil_ssa_phi_arg_t:
+
+        int bb
+        int version
+
+    ctypedef _reil_ssa_phi_arg_t reil_ssa_phi_arg_t
+
+    cdef struct _reil_ssa_func_t:
+
+        reil_ssa_inst_t *insts
+        int insts_count
+        reil_ssa_ref_t *refs
+        int refs_count
+        reil_ssa_phi_t *phis
+        int phis_count
+        reil_ssa_phi_arg_t *phi_args
+        int phi_args_count
+        int *idom
+        int *versions
+        int vars_count
+
+    ctypedef _reil_ssa_func_t reil_ssa_func_t
+
+    reil_ssa_t reil_ssa_init(reil_arch_t arch)
+    void reil_ssa_close(reil_ssa_t ssa)
+    int reil_ssa_build(reil_ssa_t ssa, reil_func_t *func, reil_ssa_func_t *ssa_func)
+    const char *reil_ssa_var_name(reil_ssa_t ssa, int var)
+
+    ctypedef void* reil_dom_t
+
+    cdef struct _reil_loop_t:
+
+        int header
+        int parent
+        int depth
+        int bbs
+        int bbs_count
+
+    ctypedef _reil_loop_t reil_loop_t
+
+    cdef struct _reil_dom_func_t:
+
+        int *idom
+        int *ipdom
+        reil_loop_t *loops
+        int loops_count
+        int *loop_bbs
+        int loop_bbs_count
+        int *bb_loop
+
+    ctypedef _reil_dom_func_t reil_dom_func_t
+
+    reil_dom_t reil_dom_init()
+    void reil_dom_close(reil_dom_t dom)
+    int reil_dom_build(reil_dom_t dom, reil_func_t *func, reil_dom_func_t *dom_func)
+
+    ctypedef void* reil_vm_t
+    ctypedef void* reil_vm_snapshot_t
+    ctypedef int (* reil_vm_mem_handler_t)(reil_addr_t addr, int size, unsigned char *buff, void *context)
+
+    cdef enum: REIL_VM_NO_CODE, REIL_VM_STOP, REIL_VM_MEM_READ, REIL_VM_MEM_WRITE, REIL_VM_INVALID
+
+    cdef struct _reil_vm_exit_t:
+
+        int reason
+        reil_addr_t addr        # address and inum of the IR instruction
+        reil_inum_t inum
+        reil_addr_t mem_addr    # address for REIL_VM_MEM_READ and REIL_VM_MEM_WRITE
+
+    ctypedef _reil_vm_exit_t reil_vm_exit_t
+
+    reil_vm_t reil_vm_init(reil_arch_t arch, reil_vm_mem_handler_t handler, void *context, int flags)
+    void reil_vm_close(reil_vm_t vm)
+    int reil_vm_code(reil_vm_t vm, reil_inst_t *insts, int count)
+    void reil_vm_code_clear(reil_vm_t vm)
+    void reil_vm_break(reil_vm_t vm, reil_addr_t addr, reil_inum_t inum)
+    void reil_vm_break_clear(reil_vm_t vm)
+    int reil_vm_run(reil_vm_t vm, reil_addr_t addr, reil_vm_exit_t *exit)
+    int reil_vm_reg(reil_vm_t vm, const char *name, _reil_size_t size)
+    int reil_vm_reg_count(reil_vm_t vm)
+    const char *reil_vm_reg_name(reil_vm_t vm, int reg)
+    _reil_size_t reil_vm_reg_size(reil_vm_t vm, int reg)
+    reil_const_t reil_vm_get(reil_vm_t vm, int reg)
+    void reil_vm_set(reil_vm_t vm, int reg, reil_const_t val)
+    void reil_vm_mem_alloc(reil_vm_t vm, reil_addr_t addr, int size, unsigned char *data)
+    int reil_vm_mem_read(reil_vm_t vm, reil_addr_t addr, int size, unsigned char *buff)
+    int reil_vm_mem_write(reil_vm_t vm, reil_addr_t addr, int size, unsigned char *buff)
+    void reil_vm_mem_clear(reil_vm_t vm)
+    reil_vm_snapshot_t reil_vm_snapshot(reil_vm_t vm)
+    void reil_vm_restore(reil_vm_t vm, reil_vm_snapshot_t snap)
+    void reil_vm_snapshot_free(reil_vm_t vm, reil_vm_snapshot_t snap)
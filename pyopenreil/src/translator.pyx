@@ -1,7 +1,33 @@
+import sys
+
+from libc.stdlib cimport malloc, realloc, free
+from libc.string cimport memset, memcpy, strncpy, strlen
+from cpython.buffer cimport PyBUF_WRITABLE
+
 cimport libopenreil
 
 ARCH_X86 = 0
 
+# translator flags
+FLAG_NO_CACHE = 0x00000001
+FLAG_RELEASE = 0x00000002
+FLAG_DIRECT = 0x00000004
+FLAG_OPTIMIZE = 0x00000010
+
+# works for to_reil_array(), to_reil_range() and to_reil_func(), but not for to_reil()
+FLAG_DEAD_EFLAGS = 0x00000020
+
+# native VM flags
+VM_FLAG_STRICT = 0x00000001
+VM_FLAG_JIT = 0x00000002
+
+# native VM exit reasons
+VM_NO_CODE = 0
+VM_STOP = 1
+VM_MEM_READ = 2
+VM_MEM_WRITE = 3
+VM_INVALID = 4
+
 # IR instruction attributes
 IATTR_ASM = 0
 IATTR_BIN = 1
@@ -26,7 +52,7 @@ cdef process_arg(libopenreil._reil_arg_t arg):
 
         return ( arg.type, arg.size, arg.val )
 
-cdef int process_insn(libopenreil.reil_inst_t* inst, object context):
+cdef process_insn_tuple(libopenreil.reil_inst_t* inst):
 
     attr = {}    
 
@@ -58,8 +84,45 @@ cdef int process_insn(libopenreil.reil_inst_t* inst, object context):
     raw_info = ( inst.raw_info.addr, inst.raw_info.size )    
     args = ( process_arg(inst.a), process_arg(inst.b), process_arg(inst.c) )
     
+    return ( raw_info, inst.inum, inst.op, args, attr )
+
+cdef convert_arg(arg, libopenreil.reil_arg_t *c_arg):
+
+    # convert Arg instance to the reil_arg_t
+    c_arg.type = <libopenreil._reil_type_t>(<int>arg.type)
+
+    if arg.type == libopenreil.A_NONE:
+
+        # size of unused argument is None
+        return
+
+    c_arg.size = <libopenreil._reil_size_t>(<int>arg.size)
+
+    if arg.type == libopenreil.A_REG or arg.type == libopenreil.A_TEMP:
+
+        strncpy(c_arg.name, arg.name, sizeof(c_arg.name) - 1)
+
+    elif arg.type == libopenreil.A_CONST:
+
+        c_arg.val = arg.val & 0xffffffffffffffff
+
+cdef convert_insn(insn, libopenreil.reil_inst_t *inst):
+
+    # convert Insn instance to the reil_inst_t
+    inst.raw_info.addr = insn.addr
+    inst.raw_info.size = insn.size
+    inst.inum = insn.inum
+    inst.op = <libopenreil._reil_op_t>(<int>insn.op)
+    inst.flags = insn.get_attr(IATTR_FLAGS)
+
+    convert_arg(insn.a, &inst.a)
+    convert_arg(insn.b, &inst.b)
+    convert_arg(insn.c, &inst.c)
+
+cdef int process_insn(libopenreil.reil_inst_t* inst, object context):
+
     # put instruction into the list
-    context.insert(0, ( raw_info, inst.inum, inst.op, args, attr ))
+    context.append(process_insn_tuple(inst))
 
     return 1
     
@@ -90,15 +153,21 @@ cdef class Translator:
 
     cdef libopenreil.reil_t reil
     cdef libopenreil.reil_arch_t reil_arch
-    translated = []
+    cdef list translated
+    cdef public object reader
+    cdef public object exc_info
 
-    def __init__(self, arch):
+    def __init__(self, arch, flags = 0):
     
         self.reil_arch = self.get_reil_arch(arch)
+        self.translated = []
+        self.reader = self.exc_info = None
 
         # initialize translator
-        self.reil = libopenreil.reil_init(self.reil_arch, 
-            <libopenreil.reil_inst_handler_t>process_insn, <void*>self.translated)
+        self.reil = libopenreil.reil_init_ex(self.reil_arch, 
+            <libopenreil.reil_inst_handler_t>process_insn, <void*>self.translated, flags)
+
+        if self.reil == NULL: raise Error('Unable to initialize translator')
 
     def __del__(self):
 
@@ -114,6 +183,34 @@ cdef class Translator:
 
             raise Error('Unknown architecture')
 
+    def get_stats(self):
+
+        cdef libopenreil.reil_stats_t stats
+
+        libopenreil.reil_get_stats(self.reil, &stats)
+
+        return { 'cache_hits': stats.cache_hits, 'cache_misses': stats.cache_misses,
+                 'cache_entries': stats.cache_entries, 'cache_uncacheable': stats.cache_uncacheable,
+                 'arena_last': stats.arena_last, 'arena_peak': stats.arena_peak, 
+                 'arena_size': stats.arena_size, 'opt_removed': stats.opt_removed,
+                 'eflags_removed': stats.eflags_removed, 'disk_hits': stats.disk_hits,
+                 'disk_stores': stats.disk_stores }
+
+    def set_disk_cache(self, path, max_size = 0):
+
+        cdef char* c_path = NULL
+        c_name = path
+
+        if path is not None:
+
+            c_name = path.encode('utf-8') if isinstance(path, unicode) else path
+            c_path = c_name
+
+        # use persistent translation cache that can be shared between processes
+        if libopenreil.reil_set_disk_cache(self.reil, c_path, max_size) == -1:
+
+            raise Error('Unable to use translation cache directory %s' % path)
+
     def to_reil(self, data, addr = 0):
 
         ret = []
@@ -127,6 +224,1104 @@ cdef class Translator:
             raise TranslationError(addr)
 
         # collect translated instructions
-        while len(self.translated) > 0: ret.append(self.translated.pop())
+        ret = self.translated[:]
+        del self.translated[:]
+
+        return ret
+
+    def to_reil_array(self, data, addr = 0):
+
+        cdef InsnArray ret = InsnArray()
+        cdef libopenreil.reil_addr_t c_addr = addr
+        cdef unsigned char* c_data
+        cdef int c_size, c_pos = 0, code
+
+        # buffer must stay unchanged while GIL is released
+        data = bytes(data)
+        c_data = data
+        c_size = len(data)
+
+        # whole buffer is translated without GIL, so other Python threads
+        # can run while translation is in progress
+        with nogil:
+
+            code = ret.translate(self.reil, c_addr, c_data, c_size, &c_pos)
+
+        if code == -2:
+
+            raise MemoryError()
+
+        elif code == -1:
+
+            raise TranslationError(addr + c_pos)
+
+        return ret
+
+    def to_reil_range(self, data, addr = 0):
+
+        cdef InsnArray arr = self.to_reil_array(data, addr)
+        cdef int i
+
+        # the same tuples as to_reil() returns, but for all instructions of the buffer
+        return [ process_insn_tuple(&arr.insts[i]) for i in range(arr.insts_count) ]
+
+    def to_reil_func(self, reader, addr):
+
+        cdef FuncArray ret = FuncArray()
+        cdef libopenreil.reil_func_t func
+
+        self.reader, self.exc_info = reader, None
+
+        try:
+
+            # translate all instructions of the function and build it's CFG
+            code = libopenreil.reil_translate_func(self.reil, addr, 
+                <libopenreil.reil_reader_t>func_reader, <void *>self, &func)
+
+        finally:
+
+            self.reader = None
+
+        if self.exc_info is not None:
+
+            # memory reader has failed
+            exc_info, self.exc_info = self.exc_info, None
+            raise exc_info[0], exc_info[1], exc_info[2]
+
+        if code == -1:
+
+            raise TranslationError(func.error_addr)
+
+        if ret.load(&func) != 0:
+
+            raise MemoryError()
+
         return ret
 
+
+# initial size of InsnArray buffers and min. number of free IR instructions in it
+DEF INSN_ARRAY_SIZE = 0x1000
+
+cdef class InsnArray:
+
+    '''
+        IR instructions that was translated by Translator.to_reil_array(), items 
+        are converted to the same tuples as returned by Translator.to_reil() only 
+        on access. Native reil_inst_t records are available without copying
+        with buffer protocol or as numpy structured array.
+    '''
+
+    cdef libopenreil.reil_inst_t *insts
+    cdef int insts_count, insts_max
+
+    # machine instructions index
+    cdef libopenreil.reil_batch_insn_t *index
+    cdef int index_count, index_max
+
+    # instruction bytes and strings
+    cdef char *heap
+    cdef size_t heap_used, heap_max
+
+    cdef Py_ssize_t buff_shape[1]
+    cdef Py_ssize_t buff_strides[1]
+
+    def __cinit__(self):
+
+        self.insts = NULL
+        self.index = NULL
+        self.heap = NULL
+        self.insts_count = self.insts_max = self.index_count = self.index_max = 0
+        self.heap_used = self.heap_max = 0
+
+    def __dealloc__(self):
+
+        free(self.insts)
+        free(self.index)
+        free(self.heap)
+
+    cdef int reserve(self) nogil:
+
+        cdef void *ptr
+
+        if self.insts_max - self.insts_count < INSN_ARRAY_SIZE:
+
+            ptr = realloc(self.insts, (self.insts_max + INSN_ARRAY_SIZE) * sizeof(libopenreil.reil_inst_t))
+            if ptr == NULL: return -1
+
+            self.insts = <libopenreil.reil_inst_t *>ptr
+            self.insts_max += INSN_ARRAY_SIZE
+
+        if self.index_max - self.index_count < INSN_ARRAY_SIZE:
+
+            ptr = realloc(self.index, (self.index_max + INSN_ARRAY_SIZE) * sizeof(libopenreil.reil_batch_insn_t))
+            if ptr == NULL: return -1
+
+            self.index = <libopenreil.reil_batch_insn_t *>ptr
+            self.index_max += INSN_ARRAY_SIZE
+
+        return 0
+
+    cdef int heap_reserve(self, size_t size) nogil:
+
+        cdef void *ptr
+
+        if self.heap_used + size > self.heap_max:
+
+            ptr = realloc(self.heap, self.heap_max * 2 + size)
+            if ptr == NULL: return -1
+
+            self.heap = <char *>ptr
+            self.heap_max = self.heap_max * 2 + size
+
+        return 0
+
+    cdef size_t heap_put(self, void *data, size_t size) nogil:
+
+        cdef size_t ret
+
+        if data == NULL: 
+
+            return 0
+
+        # space must be allocated by heap_reserve()
+        memcpy(self.heap + self.heap_used, data, size)
+        ret = self.heap_used
+        self.heap_used += size
+
+        # offset + 1, zero is used for NULL pointer
+        return ret + 1
+
+    cdef int append(self, libopenreil.reil_batch_t *batch) nogil:
+
+        cdef libopenreil.reil_inst_t *inst
+        cdef size_t size = 0
+        cdef int i
+
+        for i in range(batch.index_count):
+
+            batch.index[i].first += self.insts_count
+
+        for i in range(batch.insts_count):
+
+            inst = &batch.insts[i]
+
+            if inst.inum == 0:
+
+                size += inst.raw_info.size
+                if inst.raw_info.str_mnem != NULL: size += strlen(inst.raw_info.str_mnem) + 1
+                if inst.raw_info.str_op != NULL: size += strlen(inst.raw_info.str_op) + 1
+
+        if self.heap_reserve(size) != 0:
+
+            return -1
+
+        for i in range(batch.insts_count):
+
+            inst = &batch.insts[i]
+
+            if inst.inum == 0:
+
+                # pointers are valid only until the next reil_translate_batch() call,
+                # so, we are keeping heap offsets in them until finalize()
+                inst.raw_info.data = <unsigned char *>self.heap_put(
+                    inst.raw_info.data, inst.raw_info.size)
+
+                inst.raw_info.str_mnem = <char *>self.heap_put(
+                    inst.raw_info.str_mnem, strlen(inst.raw_info.str_mnem) + 1 if inst.raw_info.str_mnem != NULL else 0)
+
+                inst.raw_info.str_op = <char *>self.heap_put(
+                    inst.raw_info.str_op, strlen(inst.raw_info.str_op) + 1 if inst.raw_info.str_op != NULL else 0)
+
+            else:
+
+                inst.raw_info.data = NULL
+                inst.raw_info.str_mnem = NULL
+                inst.raw_info.str_op = NULL
+
+        self.insts_count += batch.insts_count
+        self.index_count += batch.index_count
+
+        return 0
+
+    cdef int finalize(self) nogil:
+
+        cdef libopenreil.reil_inst_t *inst
+        cdef int i
+
+        for i in range(self.insts_count):
+
+            inst = &self.insts[i]
+
+            if inst.inum == 0:
+
+                # convert heap offsets to pointers
+                if inst.raw_info.data != NULL: 
+                    inst.raw_info.data = <unsigned char *>(self.heap + <size_t>inst.raw_info.data - 1)
+
+                if inst.raw_info.str_mnem != NULL: 
+                    inst.raw_info.str_mnem = self.heap + <size_t>inst.raw_info.str_mnem - 1
+
+                if inst.raw_info.str_op != NULL: 
+                    inst.raw_info.str_op = self.heap + <size_t>inst.raw_info.str_op - 1
+
+        return 0
+
+    cdef int translate(self, libopenreil.reil_t reil, libopenreil.reil_addr_t addr, 
+                       unsigned char *data, int size, int *pos) nogil:
+
+        # returns -1 on translation error at *pos and -2 when out of memory
+        cdef libopenreil.reil_batch_t batch
+
+        while pos[0] < size:
+
+            # translated instructions are written directly into the array
+            if self.reserve() != 0:
+
+                return -2
+
+            batch.insts = self.insts + self.insts_count
+            batch.insts_max = self.insts_max - self.insts_count
+            batch.index = self.index + self.index_count
+            batch.index_max = self.index_max - self.index_count
+
+            if libopenreil.reil_translate_batch(reil, addr + pos[0], 
+                                                data + pos[0], size - pos[0], &batch) == -1:
+
+                return -1
+
+            if self.append(&batch) != 0:
+
+                return -2
+
+            pos[0] += batch.translated
+
+        self.finalize()
+        return 0
+
+    def __len__(self):
+
+        return self.insts_count
+
+    def __getitem__(self, n):
+
+        n = n + self.insts_count if n < 0 else n
+        if n < 0 or n >= self.insts_count:
+
+            raise IndexError('Instruction index is out of range')
+
+        return process_insn_tuple(&self.insts[<int>n])
+
+    def asm_count(self):
+
+        # number of translated machine instructions
+        return self.index_count
+
+    def asm_info(self, n):
+
+        cdef libopenreil.reil_batch_insn_t *info
+
+        n = n + self.index_count if n < 0 else n
+        if n < 0 or n >= self.index_count:
+
+            raise IndexError('Instruction index is out of range')
+
+        # address, size, first IR instruction and number of IR instructions
+        info = &self.index[<int>n]
+        return ( info.addr, info.size, info.first, info.count )
+
+    def __getbuffer__(self, Py_buffer *buffer, int flags):
+
+        if flags & PyBUF_WRITABLE:
+
+            raise BufferError('Instructions array is read only')
+
+        # array of reil_inst_t structures as bytes
+        self.buff_shape[0] = self.insts_count * sizeof(libopenreil.reil_inst_t)
+        self.buff_strides[0] = 1
+
+        buffer.buf = <void *>self.insts
+        buffer.obj = self
+        buffer.len = self.buff_shape[0]
+        buffer.readonly = 1
+        buffer.itemsize = 1
+        buffer.format = 'B'
+        buffer.ndim = 1
+        buffer.shape = self.buff_shape
+        buffer.strides = self.buff_strides
+        buffer.suboffsets = NULL
+        buffer.internal = NULL
+
+    def __releasebuffer__(self, Py_buffer *buffer):
+
+        pass
+
+    def dtype(self):
+
+        cdef libopenreil.reil_inst_t inst
+        cdef size_t base = <size_t>&inst
+
+        names, formats, offsets = [], [], []
+        enum_fmt = '=i%d' % sizeof(libopenreil._reil_type_t)
+
+        def field(name, fmt, offset):
+
+            names.append(name)
+            formats.append(fmt)
+            offsets.append(offset - base)
+
+        field('addr', '=u8', <size_t>&inst.raw_info.addr)
+        field('size', '=i4', <size_t>&inst.raw_info.size)
+        field('inum', '=u2', <size_t>&inst.inum)
+        field('op', enum_fmt, <size_t>&inst.op)
+
+        for name, arg in [ ( 'a', <size_t>&inst.a ), ( 'b', <size_t>&inst.b ), ( 'c', <size_t>&inst.c ) ]:
+
+            # arguments fields offsets are the same for all of them
+            field(name + '_type', enum_fmt, arg + <size_t>&inst.a.type - <size_t>&inst.a)
+            field(name + '_size', enum_fmt, arg + <size_t>&inst.a.size - <size_t>&inst.a)
+            field(name + '_val', '=u8', arg + <size_t>&inst.a.val - <size_t>&inst.a)
+            field(name + '_name', 'S%d' % sizeof(inst.a.name), arg + <size_t>&inst.a.name - <size_t>&inst.a)
+            field(name + '_reg', '=u2', arg + <size_t>&inst.a.reg - <size_t>&inst.a)
+
+        field('flags', '=u8', <size_t>&inst.flags)
+
+        import numpy
+
+        # structured type that describes reil_inst_t layout
+        return numpy.dtype({ 'names': names, 'formats': formats, 
+                             'offsets': offsets, 'itemsize': sizeof(libopenreil.reil_inst_t) })
+
+    def to_numpy(self):
+
+        import numpy
+
+        # numpy array that shares memory with this object
+        return numpy.asarray(self).view(self.dtype())
+
+
+cdef class FuncArray(InsnArray):
+
+    '''
+        IR code and control flow graph of the function that was translated by
+        Translator.to_reil_func(). Basic blocks and their successors are kept
+        in native arrays, CFG can be walked by indexes without creating Python 
+        objects for each node.
+    '''
+
+    # basic blocks sorted by IR address
+    cdef libopenreil.reil_func_bb_t *bbs
+    cdef int bbs_count
+
+    # successors of each basic block as indexes in bbs array
+    cdef int *succ
+    cdef int succ_count
+
+    # index of the function entry basic block
+    cdef readonly int entry
+
+    def __cinit__(self):
+
+        self.bbs = NULL
+        self.succ = NULL
+        self.bbs_count = self.succ_count = 0
+        self.entry = -1
+
+    def __dealloc__(self):
+
+        free(self.bbs)
+        free(self.succ)
+
+    cdef int load(self, libopenreil.reil_func_t *func):
+
+        cdef libopenreil.reil_batch_t batch
+        cdef int i, count = 0
+
+        for i in range(func.insts_count):
+
+            if i == 0 or func.insts[i].raw_info.addr != func.insts[i - 1].raw_info.addr:
+
+                count += 1
+
+        # function IR code is valid only until the next reil_translate_func() call
+        self.insts = <libopenreil.reil_inst_t *>malloc((func.insts_count + 1) * sizeof(libopenreil.reil_inst_t))
+        self.index = <libopenreil.reil_batch_insn_t *>malloc((count + 1) * sizeof(libopenreil.reil_batch_insn_t))
+        self.bbs = <libopenreil.reil_func_bb_t *>malloc((func.bbs_count + 1) * sizeof(libopenreil.reil_func_bb_t))
+        self.succ = <int *>malloc((func.succ_count + 1) * sizeof(int))
+
+        if self.insts == NULL or self.index == NULL or self.bbs == NULL or self.succ == NULL:
+
+            return -1
+
+        self.insts_max, self.index_max = func.insts_count, count
+
+        memcpy(self.insts, func.insts, func.insts_count * sizeof(libopenreil.reil_inst_t))
+        memcpy(self.bbs, func.bbs, func.bbs_count * sizeof(libopenreil.reil_func_bb_t))
+        memcpy(self.succ, func.succ, func.succ_count * sizeof(int))
+
+        self.bbs_count, self.succ_count, self.entry = func.bbs_count, func.succ_count, func.entry
+
+        count = 0
+
+        for i in range(func.insts_count):
+
+            # IR code of the machine instructions is contiguous
+            if i == 0 or self.insts[i].raw_info.addr != self.insts[i - 1].raw_info.addr:
+
+                self.index[count].addr = self.insts[i].raw_info.addr
+                self.index[count].size = self.insts[i].raw_info.size
+                self.index[count].first = i
+                self.index[count].count = 0
+                count += 1
+
+            self.index[count - 1].count += 1
+
+        batch.insts = self.insts
+        batch.insts_count = func.insts_count
+        batch.index = self.index
+        batch.index_count = count
+
+        # copy instruction bytes and strings into our own heap
+        if self.append(&batch) != 0:
+
+            return -1
+
+        return self.finalize()
+
+    def bb_count(self):
+
+        return self.bbs_count
+
+    def bb_info(self, n):
+
+        cdef libopenreil.reil_func_bb_t *bb
+
+        n = n + self.bbs_count if n < 0 else n
+        if n < 0 or n >= self.bbs_count:
+
+            raise IndexError('Basic block index is out of range')
+
+        # address, inum, first IR instruction and number of IR instructions
+        bb = &self.bbs[<int>n]
+        return ( bb.addr, bb.inum, bb.first, bb.count )
+
+    def bb_succ(self, n):
+
+        cdef libopenreil.reil_func_bb_t *bb
+
+        n = n + self.bbs_count if n < 0 else n
+        if n < 0 or n >= self.bbs_count:
+
+            raise IndexError('Basic block index is out of range')
+
+        # indexes of successors, fall-through goes first
+        bb = &self.bbs[<int>n]
+        return [ self.succ[bb.succ + i] for i in range(bb.succ_count) ]
+
+    def bb_find(self, addr, inum = 0):
+
+        cdef int lo = 0, hi = self.bbs_count - 1, mid
+
+        # binary search by IR address of the first instruction
+        while lo <= hi:
+
+            mid = (lo + hi) // 2
+
+            if ( self.bbs[mid].addr, self.bbs[mid].inum ) < ( addr, inum ): lo = mid + 1
+            elif ( self.bbs[mid].addr, self.bbs[mid].inum ) > ( addr, inum ): hi = mid - 1
+            else: return mid
+
+        return None
+
+    def cfg_to_numpy(self):
+
+        cdef libopenreil.reil_func_bb_t bb
+        cdef size_t base = <size_t>&bb
+
+        import numpy
+
+        names = [ 'addr', 'inum', 'first', 'count', 'succ', 'succ_count' ]
+        formats = [ '=u8', '=u2', '=i4', '=i4', '=i4', '=i4' ]
+        offsets = [ <size_t>&bb.addr - base, <size_t>&bb.inum - base, <size_t>&bb.first - base, 
+                    <size_t>&bb.count - base, <size_t>&bb.succ - base, <size_t>&bb.succ_count - base ]
+
+        dtype = numpy.dtype({ 'names': names, 'formats': formats, 
+                              'offsets': offsets, 'itemsize': sizeof(libopenreil.reil_func_bb_t) })
+
+        # CSR-style graph: basic blocks array and successors array
+        bbs = numpy.frombuffer((<char *>self.bbs)[: self.bbs_count * sizeof(libopenreil.reil_func_bb_t)], dtype)
+        succ = numpy.frombuffer((<char *>self.succ)[: self.succ_count * sizeof(int)], '=i4') \
+               if self.succ_count > 0 else numpy.zeros(0, '=i4')
+
+        return bbs, succ
+
+
+cdef class DataFlow:
+
+    '''
+        Native reaching definitions analysis, returns def-use edges of the 
+        function IR code as ( def, use, name ) tuples where def and use are
+        indexes of IR instructions or -1 for the function entry and exit.
+    '''
+
+    cdef libopenreil.reil_dfg_t dfg
+
+    def __init__(self, arch):
+
+        arch = { ARCH_X86: libopenreil.ARCH_X86 }.get(arch)
+        if arch is None:
+
+            raise Error('Unknown architecture')
+
+        self.dfg = libopenreil.reil_dfg_init(arch)
+
+    def __dealloc__(self):
+
+        libopenreil.reil_dfg_close(self.dfg)
+
+    cdef process(self, libopenreil.reil_func_t *func, owner):
+
+        cdef libopenreil.reil_dfg_edge_t *edges
+        cdef int i, count
+
+        count = libopenreil.reil_dfg_build(self.dfg, func, &edges)
+
+        names = [ str(libopenreil.reil_dfg_var_name(self.dfg, i)) 
+                  for i in range(libopenreil.reil_dfg_var_count(self.dfg)) ]
+
+        if owner is None:
+
+            return [ ( edges[i].def_inst, edges[i].use_inst, names[edges[i].var] ) for i in range(count) ]
+
+        # convert instruction indexes back
+        return [ ( owner[edges[i].def_inst] if edges[i].def_inst != libopenreil.REIL_DFG_ENTRY else -1, 
+                   owner[edges[i].use_inst] if edges[i].use_inst != libopenreil.REIL_DFG_EXIT else -1, 
+                   names[edges[i].var] ) for i in range(count) ]
+
+    def build(self, insn_list, bb_list, entry = 0):
+
+        '''
+            Analyze Insn instances of all basic blocks, bb_list contains
+            ( first, count, successors ) tuples for each basic block.
+        '''
+
+        cdef libopenreil.reil_func_t func
+        cdef int i, n
+
+        owner, first = [], []
+
+        for n in range(len(insn_list)):
+
+            insn = insn_list[n]
+            first.append(len(owner))
+
+            if insn.op == libopenreil.I_UNK:
+
+                # operands of unknown instruction are stored in attributes,
+                # each of them needs its own reil_inst_t
+                owner += [ n ] * max(len(insn.src()) + len(insn.dst()), 1)
+
+            else:
+
+                owner.append(n)
+
+        first.append(len(owner))
+
+        memset(&func, 0, sizeof(func))
+
+        func.insts_count = len(owner)
+        func.bbs_count = len(bb_list)
+        func.succ_count = sum([ len(bb[2]) for bb in bb_list ])
+        func.entry = entry
+
+        func.insts = <libopenreil.reil_inst_t *>malloc((func.insts_count + 1) * sizeof(libopenreil.reil_inst_t))
+        func.bbs = <libopenreil.reil_func_bb_t *>malloc((func.bbs_count + 1) * sizeof(libopenreil.reil_func_bb_t))
+        func.succ = <int *>malloc((func.succ_count + 1) * sizeof(int))
+
+        try:
+
+            if func.insts == NULL or func.bbs == NULL or func.succ == NULL:
+
+                raise MemoryError()
+
+            memset(func.insts, 0, func.insts_count * sizeof(libopenreil.reil_inst_t))
+
+            for n in range(len(insn_list)):
+
+                insn = insn_list[n]
+                i = first[n]
+
+                if insn.op == libopenreil.I_UNK:
+
+                    # source operands go first
+                    for arg in insn.src():
+
+                        convert_insn(insn, &func.insts[i])
+                        memset(&func.insts[i].c, 0, sizeof(libopenreil.reil_arg_t))
+                        convert_arg(arg, &func.insts[i].a)
+                        i += 1
+
+                    for arg in insn.dst():
+
+                        convert_insn(insn, &func.insts[i])
+                        memset(&func.insts[i].a, 0, sizeof(libopenreil.reil_arg_t))
+                        convert_arg(arg, &func.insts[i].c)
+                        i += 1
+
+                    if i == first[n]: convert_insn(insn, &func.insts[i])
+
+                else:
+
+                    convert_insn(insn, &func.insts[i])
+
+            i = 0
+
+            for n in range(func.bbs_count):
+
+                bb_first, bb_count, bb_succ = bb_list[n]
+
+                func.bbs[n].first = first[bb_first]
+                func.bbs[n].count = first[bb_first + bb_count] - first[bb_first]
+                func.bbs[n].succ = i
+                func.bbs[n].succ_count = len(bb_succ)
+
+                for succ in bb_succ:
+
+                    func.succ[i] = succ
+                    i += 1
+
+            return self.process(&func, owner)
+
+        finally:
+
+            free(func.insts)
+            free(func.bbs)
+            free(func.succ)
+
+    def build_array(self, FuncArray arr):
+
+        cdef libopenreil.reil_func_t func
+
+        # function that was translated by Translator.to_reil_func()
+        memset(&func, 0, sizeof(func))
+
+        func.insts, func.insts_count = arr.insts, arr.insts_count
+        func.bbs, func.bbs_count = arr.bbs, arr.bbs_count
+        func.succ, func.succ_count = arr.succ, arr.succ_count
+        func.entry = arr.entry
+
+        return self.process(&func, None)
+
+
+cdef class SSA:
+
+    '''
+        Native SSA construction, build_array() returns ( insts, phis ) tuple 
+        where insts contains ( uses, defs ) lists of ( name, version ) tuples
+        for each IR instruction and phis contains ( bb, name, version, args )
+        tuples, args is the list of ( bb, version ) tuples for predecessors.
+        Version 0 stands for the value that variable had at the function 
+        entry, instructions of unreachable basic blocks have version -1.
+    '''
+
+    cdef libopenreil.reil_ssa_t ssa
+
+    def __init__(self, arch):
+
+        arch = { ARCH_X86: libopenreil.ARCH_X86 }.get(arch)
+        if arch is None:
+
+            raise Error('Unknown architecture')
+
+        self.ssa = libopenreil.reil_ssa_init(arch)
+
+    def __dealloc__(self):
+
+        libopenreil.reil_ssa_close(self.ssa)
+
+    def build_array(self, FuncArray arr):
+
+        cdef libopenreil.reil_func_t func
+        cdef libopenreil.reil_ssa_func_t ssa_func
+        cdef libopenreil.reil_ssa_inst_t *inst
+        cdef libopenreil.reil_ssa_ref_t *ref
+        cdef libopenreil.reil_ssa_phi_t *phi
+        cdef int i, n
+
+        # function that was translated by Translator.to_reil_func()
+        memset(&func, 0, sizeof(func))
+
+        func.insts, func.insts_count = arr.insts, arr.insts_count
+        func.bbs, func.bbs_count = arr.bbs, arr.bbs_count
+        func.succ, func.succ_count = arr.succ, arr.succ_count
+        func.entry = arr.entry
+
+        if libopenreil.reil_ssa_build(self.ssa, &func, &ssa_func) == -1:
+
+            raise Error('Empty function')
+
+        names = [ str(libopenreil.reil_ssa_var_name(self.ssa, i)) 
+                  for i in range(ssa_func.vars_count) ]
+
+        insts, phis = [], []
+
+        for i in range(ssa_func.insts_count):
+
+            inst = &ssa_func.insts[i]
+            ref = ssa_func.refs
+
+            insts.append(( [ ( names[ref[n].var], ref[n].version ) 
+                             for n in range(inst.uses, inst.uses + inst.uses_count) ],
+                           [ ( names[ref[n].var], ref[n].version ) 
+                             for n in range(inst.defs, inst.defs + inst.defs_count) ] ))
+
+        for i in range(ssa_func.phis_count):
+
+            phi = &ssa_func.phis[i]
+
+            phis.append(( phi.bb, names[phi.var], phi.version, 
+                          [ ( ssa_func.phi_args[n].bb, ssa_func.phi_args[n].version ) 
+                            for n in range(phi.args, phi.args + phi.args_count) ] ))
+
+        return insts, phis
+
+
+cdef class Dominators:
+
+    '''
+        Dominator and post-dominator trees and natural loops of CFG, returns
+        ( idom, ipdom, loops, bb_loop ) tuple where idom and ipdom contains
+        immediate dominator and post-dominator of each basic block (or -1),
+        loops contains ( header, parent, depth, bbs ) tuple for each loop 
+        (enclosing loops are going first) and bb_loop contains index of the
+        innermost loop of each basic block (or -1).
+    '''
+
+    cdef libopenreil.reil_dom_t dom
+
+    def __init__(self):
+
+        self.dom = libopenreil.reil_dom_init()
+
+    def __dealloc__(self):
+
+        libopenreil.reil_dom_close(self.dom)
+
+    cdef process(self, libopenreil.reil_func_t *func):
+
+        cdef libopenreil.reil_dom_func_t dom_func
+        cdef libopenreil.reil_loop_t *loop
+        cdef int i, n
+
+        if libopenreil.reil_dom_build(self.dom, func, &dom_func) == -1:
+
+            raise Error('Empty function')
+
+        loops = []
+
+        for i in range(dom_func.loops_count):
+
+            loop = &dom_func.loops[i]
+
+            loops.append(( loop.header, loop.parent, loop.depth, 
+                           [ dom_func.loop_bbs[n] for n in range(loop.bbs, loop.bbs + loop.bbs_count) ] ))
+
+        return ( [ dom_func.idom[i] for i in range(func.bbs_count) ],
+                 [ dom_func.ipdom[i] for i in range(func.bbs_count) ], loops,
+                 [ dom_func.bb_loop[i] for i in range(func.bbs_count) ] )
+
+    def build(self, bb_succ, entry = 0):
+
+        '''
+            Analyze CFG that is given as list of successors of each basic block.
+        '''
+
+        cdef libopenreil.reil_func_t func
+        cdef int i, n
+
+        if entry < 0 or entry >= len(bb_succ):
+
+            raise Error('Invalid entry basic block')
+
+        memset(&func, 0, sizeof(func))
+
+        func.bbs_count = len(bb_succ)
+        func.succ_count = sum([ len(succ) for succ in bb_succ ])
+        func.entry = entry
+
+        func.bbs = <libopenreil.reil_func_bb_t *>malloc((func.bbs_count + 1) * sizeof(libopenreil.reil_func_bb_t))
+        func.succ = <int *>malloc((func.succ_count + 1) * sizeof(int))
+
+        try:
+
+            if func.bbs == NULL or func.succ == NULL:
+
+                raise MemoryError()
+
+            memset(func.bbs, 0, func.bbs_count * sizeof(libopenreil.reil_func_bb_t))
+
+            i = 0
+
+            for n in range(func.bbs_count):
+
+                func.bbs[n].succ = i
+                func.bbs[n].succ_count = len(bb_succ[n])
+
+                for succ in bb_succ[n]:
+
+                    if succ < 0 or succ >= func.bbs_count:
+
+                        raise Error('Invalid successor of basic block %d' % n)
+
+                    func.succ[i] = succ
+                    i += 1
+
+            return self.process(&func)
+
+        finally:
+
+            free(func.bbs)
+            free(func.succ)
+
+    def build_array(self, FuncArray arr):
+
+        cdef libopenreil.reil_func_t func
+
+        # function that was translated by Translator.to_reil_func()
+        memset(&func, 0, sizeof(func))
+
+        func.insts, func.insts_count = arr.insts, arr.insts_count
+        func.bbs, func.bbs_count = arr.bbs, arr.bbs_count
+        func.succ, func.succ_count = arr.succ, arr.succ_count
+        func.entry = arr.entry
+
+        return self.process(&func)
+
+
+cdef int func_reader(libopenreil.reil_addr_t addr, unsigned char *buff, 
+                     int size, void *context):
+
+    cdef Translator tr = <Translator>context
+    cdef unsigned char *c_data
+    cdef int c_size
+
+    try:
+
+        # ask memory reader for the instruction bytes
+        data = tr.reader.read(addr, size)
+
+    except:
+
+        # exception will be raised after reil_translate_func() exit
+        tr.exc_info = sys.exc_info()
+        return -1
+
+    if data is None or len(data) == 0:
+
+        return -1
+
+    c_data = data
+    c_size = min(len(data), size)
+
+    memcpy(buff, c_data, c_size)
+    return c_size
+
+
+
+cdef class Vm:
+
+    cdef libopenreil.reil_vm_t vm
+    cdef public object reader
+    cdef public object exc_info
+
+    def __init__(self, arch, strict = True, jit = False):
+
+        flags = (VM_FLAG_STRICT if strict else 0) | (VM_FLAG_JIT if jit else 0)
+
+        self.reader = self.exc_info = None
+
+        arch = { ARCH_X86: libopenreil.ARCH_X86 }.get(arch)
+        if arch is None:
+
+            raise Error('Unknown architecture')
+
+        # initialize native interpreter
+        self.vm = libopenreil.reil_vm_init(arch, 
+            <libopenreil.reil_vm_mem_handler_t>vm_mem_handler, <void *>self, flags)
+
+    def __dealloc__(self):
+
+        libopenreil.reil_vm_close(self.vm)
+
+    def code(self, insn_list):
+
+        cdef int i, count = len(insn_list)
+        cdef libopenreil.reil_inst_t *insts
+
+        if count == 0: return
+
+        insts = <libopenreil.reil_inst_t *>malloc(sizeof(libopenreil.reil_inst_t) * count)
+        if insts == NULL: raise MemoryError()
+
+        memset(insts, 0, sizeof(libopenreil.reil_inst_t) * count)
+
+        try:
+
+            for i in range(count):
+
+                convert_insn(insn_list[i], &insts[i])
+
+            # add IR code of the machine instruction
+            libopenreil.reil_vm_code(self.vm, insts, count)
+
+        finally:
+
+            free(insts)
+
+    def code_clear(self):
+
+        libopenreil.reil_vm_code_clear(self.vm)
+
+    def brk(self, addr, inum = 0):
+
+        libopenreil.reil_vm_break(self.vm, addr, inum)
+
+    def brk_clear(self):
+
+        libopenreil.reil_vm_break_clear(self.vm)
+
+    def run(self, addr):
+
+        cdef libopenreil.reil_vm_exit_t exit
+
+        # execute the code until something happens
+        libopenreil.reil_vm_run(self.vm, addr, &exit)
+
+        if self.exc_info is not None:
+
+            # memory handler has failed
+            exc_info, self.exc_info = self.exc_info, None
+            raise exc_info[0], exc_info[1], exc_info[2]
+
+        return exit.reason, exit.addr, exit.inum, exit.mem_addr
+
+    def reg(self, name, size):
+
+        return libopenreil.reil_vm_reg(self.vm, name, <libopenreil._reil_size_t>(<int>size))
+
+    def reg_count(self):
+
+        return libopenreil.reil_vm_reg_count(self.vm)
+
+    def reg_name(self, reg):
+
+        return str(libopenreil.reil_vm_reg_name(self.vm, reg))
+
+    def reg_size(self, reg):
+
+        return libopenreil.reil_vm_reg_size(self.vm, reg)
+
+    def reg_get(self, reg):
+
+        return libopenreil.reil_vm_get(self.vm, reg)
+
+    def reg_set(self, reg, val):
+
+        libopenreil.reil_vm_set(self.vm, reg, val & 0xffffffffffffffff)
+
+    def mem_alloc(self, addr, size, data = None):
+
+        cdef unsigned char *c_data = NULL
+
+        if data is not None:
+
+            # pad data with zeros
+            data = data[: size] + '\0' * (size - len(data))
+            c_data = data
+
+        libopenreil.reil_vm_mem_alloc(self.vm, addr, size, c_data)
+
+    def mem_read(self, addr, size):
+
+        cdef unsigned char *buff = <unsigned char *>malloc(size + 1)
+        if buff == NULL: raise MemoryError()
+
+        try:
+
+            if libopenreil.reil_vm_mem_read(self.vm, addr, size, buff) == -1:
+
+                return None
+
+            return (<char *>buff)[: size]
+
+        finally:
+
+            free(buff)
+
+    def mem_write(self, addr, data):
+
+        cdef unsigned char *c_data = data
+
+        return libopenreil.reil_vm_mem_write(self.vm, addr, len(data), c_data) != -1
+
+    def mem_clear(self):
+
+        libopenreil.reil_vm_mem_clear(self.vm)
+
+    def snapshot(self):
+
+        cdef VmSnapshot snap = VmSnapshot()
+
+        # registers and memory pages are shared with VM until modification
+        snap.vm = self
+        snap.snap = libopenreil.reil_vm_snapshot(self.vm)
+
+        return snap
+
+    def restore(self, VmSnapshot snap):
+
+        if snap.vm is not self:
+
+            raise Error('Snapshot belongs to other VM')
+
+        libopenreil.reil_vm_restore(self.vm, snap.snap)
+
+
+cdef class VmSnapshot:
+
+    cdef Vm vm
+    cdef libopenreil.reil_vm_snapshot_t snap
+
+    def __dealloc__(self):
+
+        if self.vm is not None:
+
+            libopenreil.reil_vm_snapshot_free(self.vm.vm, self.snap)
+
+
+cdef int vm_mem_handler(libopenreil.reil_addr_t addr, int size, 
+                        unsigned char *buff, void *context):
+
+    cdef Vm vm = <Vm>context
+    cdef int i
+
+    if vm.reader is None: 
+
+        return -1
+
+    try:
+
+        # ask memory reader for the data
+        data = vm.reader.read(addr, size)
+
+    except:
+
+        # exception will be raised after reil_vm_run() exit
+        vm.exc_info = sys.exc_info()
+        return -1
+
+    if data is None or len(data) < size: 
+
+        return -1
+
+    for i in range(size): buff[i] = ord(data[i])
+    return 0
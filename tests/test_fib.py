@@ -51,10 +51,42 @@ class TestFib(unittest.TestCase):
 
         assert ret == 144
 
+    def test_optimize(self):
+
+        from pyopenreil import translator
+
+        # translate with native optimization of each machine instruction
+        reader = bin_PE.Reader(self.BIN_PATH)
+        tr = CodeStorageTranslator(reader, flags = translator.FLAG_OPTIMIZE)
+
+        cpu = Cpu(self.ARCH)
+        abi = Abi(cpu, tr)
+
+        assert abi.cdecl(self.PROC_ADDR, 11) == 144
+        assert tr.translator.get_stats()['opt_removed'] > 0
+
+    def test_native(self):
+
+        reader = bin_PE.Reader(self.BIN_PATH)
+        tr = CodeStorageTranslator(reader)
+
+        # run the code with native interpreter
+        cpu = NativeCpu(self.ARCH)
+        abi = Abi(cpu, tr)
+
+        assert abi.cdecl(self.PROC_ADDR, 11) == 144
+
+        # .. and with JIT compiler
+        cpu = NativeCpu(self.ARCH, jit = True)
+        abi = Abi(cpu, tr)
+
+        assert abi.cdecl(self.PROC_ADDR, 11) == 144
+
 
 if __name__ == '__main__':    
 
-    suite = unittest.TestSuite([ TestFib('test') ])
+    suite = unittest.TestSuite([ TestFib('test'), TestFib('test_optimize'),
+                                 TestFib('test_native') ])
     unittest.TextTestRunner(verbosity = 2).run(suite)
 
 #
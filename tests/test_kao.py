@@ -162,6 +162,11 @@ class Mem(VM.Mem):
 
             super(Mem._Val, self).__init__(val = val, exp = exp)            
 
+    def _page_data(self):
+
+        # memory pages are holding _Val instances instead of bytes
+        return [ None ] * self.PAGE_SIZE
+
     def pack(self, size, val):
 
         ret = []
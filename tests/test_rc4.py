@@ -17,7 +17,7 @@ class TestRC4(unittest.TestCase):
     RC4_SET_KEY = 0x004016D5 
     RC4_CRYPT = 0x004017B5
 
-    def test(self):        
+    def test(self, get_cpu = Cpu):        
 
         # test input data for RC4 encryption
         test_key = 'somekey'
@@ -44,7 +44,7 @@ class TestRC4(unittest.TestCase):
         code_optimization(self.RC4_CRYPT)
 
         # create CPU and ABI
-        cpu = Cpu(self.ARCH)
+        cpu = get_cpu(self.ARCH)
         abi = Abi(cpu, tr)
 
         # allocate buffers for arguments of emulated functions
@@ -64,10 +64,21 @@ class TestRC4(unittest.TestCase):
         # check for correct result
         assert val == '\x38\x88\xBC'
 
+    def test_native(self):
+
+        # the same test with native interpreter
+        self.test(get_cpu = NativeCpu)
+
+    def test_native_jit(self):
+
+        # .. and with JIT compiler
+        self.test(get_cpu = lambda arch: NativeCpu(arch, jit = True))
+
 
 if __name__ == '__main__':    
 
-    suite = unittest.TestSuite([ TestRC4('test') ])
+    suite = unittest.TestSuite([ TestRC4('test'), TestRC4('test_native'),
+                                 TestRC4('test_native_jit') ])
     unittest.TextTestRunner(verbosity = 2).run(suite)
 
 #